@@ -168,6 +168,168 @@ int FEMTreeInitializer< Dim , Real >::Initialize( FEMTreeNode& root , InputPoint
 	FEMTree< Dim , Real >::MemoryUsage();
 	return pointCount;
 }
+template< unsigned int Dim , class Real >
+void FEMTreeInitializer< Dim , Real >::_RadixSort( std::vector< std::pair< unsigned long long , int > >& keys , unsigned int bits )
+{
+	static const unsigned int RadixBits = 8;
+	static const unsigned int Radix = 1<<RadixBits;
+	int chunks = omp_get_max_threads();
+	size_t chunkSize = ( keys.size() + chunks - 1 ) / chunks;
+	std::vector< std::pair< unsigned long long , int > > _keys( keys.size() );
+	std::vector< size_t > offsets( chunks * Radix );
+	for( unsigned int shift=0 ; shift<bits ; shift+=RadixBits )
+	{
+		// Count the digits in each chunk
+		for( size_t i=0 ; i<offsets.size() ; i++ ) offsets[i] = 0;
+#pragma omp parallel for
+		for( int c=0 ; c<chunks ; c++ )
+		{
+			size_t end = std::min< size_t >( keys.size() , (c+1)*chunkSize );
+			for( size_t i=c*chunkSize ; i<end ; i++ ) offsets[ c*Radix + ( ( keys[i].first>>shift ) & (Radix-1) ) ]++;
+		}
+		// Turn the counts into offsets, ordering by digit and then by chunk so that the sort is stable
+		size_t sum = 0;
+		for( unsigned int r=0 ; r<Radix ; r++ ) for( int c=0 ; c<chunks ; c++ )
+		{
+			size_t count = offsets[ c*Radix+r ];
+			offsets[ c*Radix+r ] = sum;
+			sum += count;
+		}
+#pragma omp parallel for
+		for( int c=0 ; c<chunks ; c++ )
+		{
+			size_t end = std::min< size_t >( keys.size() , (c+1)*chunkSize );
+			for( size_t i=c*chunkSize ; i<end ; i++ ) _keys[ offsets[ c*Radix + ( ( keys[i].first>>shift ) & (Radix-1) ) ]++ ] = keys[i];
+		}
+		std::swap( keys , _keys );
+	}
+}
+
+template< unsigned int Dim , class Real >
+template< class Data >
+int FEMTreeInitializer< Dim , Real >::MortonInitialize( FEMTreeNode& root , InputPointStreamWithData< Real , Dim , Data >& pointStream , int maxDepth , std::vector< PointSample >& samplePoints , std::vector< Data >& sampleData , bool mergeNodeSamples , Allocator< FEMTreeNode >* nodeAllocator , std::function< void ( FEMTreeNode& ) > NodeInitializer , std::function< Real ( const Point< Real , Dim >& , Data& ) > ProcessData )
+{
+	// The subtrees rooted at this depth are built concurrently
+	static const int TaskDepth = 3;
+	if( Dim*maxDepth>8*sizeof( unsigned long long ) )
+	{
+		fprintf( stderr , "[WARNING] FEMTreeInitializer::MortonInitialize: Depth too large for Morton codes, inserting the points in stream order: %d\n" , maxDepth );
+		return Initialize( root , pointStream , maxDepth , samplePoints , sampleData , mergeNodeSamples , nodeAllocator , NodeInitializer , ProcessData );
+	}
+
+	// Read the points
+	int badData = 0;
+	std::vector< Point< Real , Dim > > points;
+	std::vector< Data > data;
+	std::vector< Real > weights;
+	{
+		Point< Real , Dim > p;
+		Data d;
+		while( pointStream.nextPoint( p , d ) )
+		{
+			Real weight = ProcessData( p , d );
+			if( weight<=0 ){ badData++ ; continue; }
+			points.push_back( p ) , data.push_back( d ) , weights.push_back( weight );
+		}
+		pointStream.reset();
+	}
+
+	// Compute the Morton codes of the leaves containing the points, descending as in Initialize so that the points land in the same leaves
+	std::vector< std::pair< unsigned long long , int > > codes( points.size() );
+	std::vector< char > inBounds( points.size() , 1 );
+#pragma omp parallel for
+	for( int i=0 ; i<points.size() ; i++ )
+	{
+		const Point< Real , Dim >& p = points[i];
+		for( int d=0 ; d<Dim ; d++ ) if( p[d]<0 || p[d]>1 ) inBounds[i] = 0;
+		Point< Real , Dim > center;
+		for( int d=0 ; d<Dim ; d++ ) center[d] = (Real)0.5;
+		Real width = Real(1.0);
+		unsigned long long code = 0;
+		for( int d=0 ; d<maxDepth ; d++ )
+		{
+			int cIndex = FEMTreeNode::ChildIndex( center , p );
+			code = ( code<<Dim ) | cIndex;
+			width /= 2;
+			for( int dd=0 ; dd<Dim ; dd++ )
+				if( (cIndex>>dd) & 1 ) center[dd] += width/2;
+				else                   center[dd] -= width/2;
+		}
+		codes[i] = std::pair< unsigned long long , int >( code , i );
+	}
+	int outOfBoundPoints = 0;
+	{
+		size_t count = 0;
+		for( size_t i=0 ; i<codes.size() ; i++ ) if( inBounds[i] ) codes[count++] = codes[i];
+		outOfBoundPoints = (int)( codes.size() - count );
+		codes.resize( count );
+	}
+	_RadixSort( codes , Dim*maxDepth );
+
+	// Merge the points in the same leaf, in stream order, and record the code of each sample
+	size_t sampleStart = samplePoints.size();
+	std::vector< unsigned long long > sampleCodes;
+	for( size_t i=0 ; i<codes.size() ; i++ )
+	{
+		int idx = codes[i].second;
+		if( !mergeNodeSamples || !sampleCodes.size() || sampleCodes.back()!=codes[i].first )
+		{
+			sampleCodes.push_back( codes[i].first );
+			samplePoints.resize( samplePoints.size()+1 ) , sampleData.resize( sampleData.size()+1 );
+			samplePoints.back().sample = ProjectiveData< Point< Real , Dim > , Real >( points[idx]*weights[idx] , weights[idx] );
+			sampleData.back() = data[idx]*weights[idx];
+		}
+		else
+		{
+			samplePoints.back().sample += ProjectiveData< Point< Real , Dim > , Real >( points[idx]*weights[idx] , weights[idx] );
+			sampleData.back() += data[idx]*weights[idx];
+		}
+	}
+
+	// Build the tree top-down over the sorted codes: the samples in a node's subtree are a contiguous range that splits by the node's digit of the codes.
+	// Nodes are created without initialization, recording the broods, so that the node initializer can be run in a fixed order afterwards.
+	struct Task
+	{
+		FEMTreeNode* node;
+		int depth;
+		size_t begin , end;
+	};
+	std::function< void ( FEMTreeNode* , int , size_t , size_t , std::vector< FEMTreeNode* >& , std::vector< Task >* ) > Build = [&]( FEMTreeNode* node , int depth , size_t begin , size_t end , std::vector< FEMTreeNode* >& broods , std::vector< Task >* tasks )
+	{
+		if( depth==maxDepth ) for( size_t i=begin ; i<end ; i++ ) samplePoints[ sampleStart+i ].node = node;
+		else if( tasks && depth==TaskDepth ) tasks->push_back( { node , depth , begin , end } );
+		else
+		{
+			if( !node->children ) node->initChildren( nodeAllocator , std::function< void ( FEMTreeNode& ) >() ) , broods.push_back( node->children );
+			int shift = Dim * ( maxDepth-depth-1 );
+			for( size_t b=begin ; b<end ; )
+			{
+				int c = (int)( ( sampleCodes[b]>>shift ) & ( (1<<Dim)-1 ) );
+				size_t e = b;
+				while( e<end && (int)( ( sampleCodes[e]>>shift ) & ( (1<<Dim)-1 ) )==c ) e++;
+				Build( node->children+c , depth+1 , b , e , broods , tasks );
+				b = e;
+			}
+		}
+	};
+	std::vector< FEMTreeNode* > broods;
+	std::vector< Task > tasks;
+	Build( &root , 0 , 0 , sampleCodes.size() , broods , &tasks );
+	std::vector< std::vector< FEMTreeNode* > > taskBroods( tasks.size() );
+#pragma omp parallel for
+	for( int t=0 ; t<tasks.size() ; t++ ) Build( tasks[t].node , tasks[t].depth , tasks[t].begin , tasks[t].end , taskBroods[t] , NULL );
+	if( NodeInitializer )
+	{
+		for( int i=0 ; i<broods.size() ; i++ ) for( int c=0 ; c<(1<<Dim) ; c++ ) NodeInitializer( broods[i][c] );
+		for( int t=0 ; t<taskBroods.size() ; t++ ) for( int i=0 ; i<taskBroods[t].size() ; i++ ) for( int c=0 ; c<(1<<Dim) ; c++ ) NodeInitializer( taskBroods[t][i][c] );
+	}
+
+	if( outOfBoundPoints  ) fprintf( stderr , "[WARNING] Found out-of-bound points: %d\n" , outOfBoundPoints );
+	if( badData           ) fprintf( stderr , "[WARNING] Found bad data: %d\n" , badData );
+	FEMTree< Dim , Real >::MemoryUsage();
+	return (int)codes.size();
+}
+
 template< unsigned int Dim , class Real >
 void FEMTreeInitializer< Dim , Real >::Initialize( FEMTreeNode& root , const std::vector< Point< Real , Dim > >& vertices , const std::vector< SimplexIndex< Dim-1 > >& simplices , int maxDepth , std::vector< PointSample >& samples , bool mergeNodeSamples , Allocator< FEMTreeNode >* nodeAllocator , std::function< void ( FEMTreeNode& ) > NodeInitializer )
 {
@@ -229,10 +391,10 @@ int FEMTreeInitializer< Dim , Real >::_AddSimplex( FEMTreeNode& root , Simplex<
 		int d=0;
 		while( d<maxDepth )
 		{
-#pragma omp critical
-			if( !node->children ) node->initChildren( nodeAllocator , NodeInitializer );
+			FEMTreeNode* children = node->acquireChildren();
+			if( !children ) node->template initChildren< true >( nodeAllocator , NodeInitializer ) , children = node->acquireChildren();
 			int cIndex = FEMTreeNode::ChildIndex( center , p );
-			node = node->children + cIndex;
+			node = children + cIndex;
 			d++;
 			width /= 2;
 			for( int d=0 ; d<Dim ; d++ )
@@ -315,8 +477,8 @@ int FEMTreeInitializer< Dim , Real >::_AddSimplex( FEMTreeNode* node , Simplex<
 	else
 	{
 		int sCount = 0;
-#pragma omp critical
-		if( !node->children ) node->initChildren( nodeAllocator , NodeInitializer );
+		FEMTreeNode* children = node->acquireChildren();
+		if( !children ) node->template initChildren< true >( nodeAllocator , NodeInitializer ) , children = node->acquireChildren();
 
 		// Split up the simplex and pass the parts on to the children
 		Point< Real , Dim > center;
@@ -332,7 +494,7 @@ int FEMTreeInitializer< Dim , Real >::_AddSimplex( FEMTreeNode* node , Simplex<
 			for( int c=0 ; c<(1<<d) ; c++ ) for( int i=0 ; i<childSimplices[c].size() ; i++ ) childSimplices[c][i].split( n , center[Dim-d-1] , temp[2*c] , temp[2*c+1] );
 			childSimplices = temp;
 		}
-		for( int c=0 ; c<(1<<Dim) ; c++ ) for( int i=0 ; i<childSimplices[c].size() ; i++ ) if( childSimplices[c][i].measure() ) sCount += _AddSimplex( node->children+c , childSimplices[c][i] , maxDepth , samples , nodeToIndexMap , nodeAllocator , NodeInitializer );
+		for( int c=0 ; c<(1<<Dim) ; c++ ) for( int i=0 ; i<childSimplices[c].size() ; i++ ) if( childSimplices[c][i].measure() ) sCount += _AddSimplex( children+c , childSimplices[c][i] , maxDepth , samples , nodeToIndexMap , nodeAllocator , NodeInitializer );
 		return sCount;
 	}
 }
@@ -226,14 +226,26 @@ void FEMTree< Dim , Real >::_setMultiColorIndices( UIntPack< FEMSigs ... > , int
 		indices[idx].push_back( i - start );
 	}
 }
+template< unsigned int Dim , class Real >
+template< unsigned int ... FEMSigs >
+void FEMTree< Dim , Real >::_setColorOrder( UIntPack< FEMSigs ... > , int start , int end , Pointer( int ) order ) const
+{
+	std::vector< std::vector< int > > indices;
+	_setMultiColorIndices( UIntPack< FEMSigs ... >() , start , end , indices );
+	for( int i=start ; i<end ; i++ ) order[i-start] = -1;
+	int position = start;
+	for( size_t c=0 ; c<indices.size() ; c++ ) for( size_t k=0 ; k<indices[c].size() ; k++ ) order[ indices[c][k] ] = position++;
+	for( int i=start ; i<end ; i++ ) if( order[i-start]==-1 ) order[i-start] = position++;
+}
 
 template< unsigned int Dim , class Real >
-template< unsigned int ... FEMSigs , typename T , typename TDotT , typename SORWeights , unsigned int ... PointDs >
-int FEMTree< Dim , Real >::_solveFullSystemGS( UIntPack< FEMSigs ... > , const typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) prolongedSolution , ConstPointer( T ) constraints , TDotT Dot , int iters , bool coarseToFine , SORWeights sorWeights , _SolverStats& stats , bool computeNorms , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
+template< typename MatrixReal , unsigned int ... FEMSigs , typename T , typename TDotT , typename SORWeights , unsigned int ... PointDs >
+int FEMTree< Dim , Real >::_solveFullSystemGS( UIntPack< FEMSigs ... > , const typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) prolongedSolution , ConstPointer( T ) constraints , TDotT Dot , int iters , bool coarseToFine , SORWeights sorWeights , bool matrixFree , SystemCache* systemCache , _SolverStats& stats , bool computeNorms , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
 {
 	double& systemTime = stats.systemTime;
 	double&  solveTime = stats. solveTime;
 	systemTime = solveTime = 0.;
+	stats.clearSystem();
 
 	CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > > ccStencil;
 	PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > > pcStencils;
@@ -242,41 +254,68 @@ int FEMTree< Dim , Real >::_solveFullSystemGS( UIntPack< FEMSigs ... > , const t
 	double bNorm=0 , inRNorm=0 , outRNorm=0;
 	if( depth>=0 )
 	{
-		SparseMatrix< Real > M;
+		bool cached = systemCache && systemCache->sliceSystems;
+		_SliceSystem< MatrixReal > _system;
+		_SliceSystem< MatrixReal >& system = cached ? systemCache->template slices< MatrixReal >( depth , 1 , 0 , matrixFree )[0] : _system;
+		const CSRSparseMatrix< MatrixReal >& M = system.M;
 		double t = Time();
-		Pointer( Real ) D = AllocPointer< Real >( _sNodesEnd( depth ) - _sNodesBegin( depth ) );
+		Pointer( MatrixReal ) D = AllocPointer< MatrixReal >( _sNodesEnd( depth ) - _sNodesBegin( depth ) );
 		Pointer( T ) _constraints = AllocPointer< T >( _sNodesSize( depth ) );
-		_getSliceMatrixAndProlongationConstraints( UIntPack< FEMSigs ... >() , F , M , D , bsData , depth , _sNodesBegin( depth ) , _sNodesEnd( depth ) , prolongedSolution , _constraints , ccStencil , pcStencils , interpolationInfo... );
+		std::vector< ConstOneRingNeighborKey > neighborKeys( omp_get_max_threads() );
+		for( size_t i=0 ; i<neighborKeys.size() ; i++ ) neighborKeys[i].set( _localToGlobal( depth ) );
+		// Relax with the rows and unknowns in color order, so that every color is streamed through contiguously.
+		// The order is kept with a cached system.
+		Pointer( int ) colorOrder = NullPointer( int );
+		if( !matrixFree )
+		{
+			if( cached ) colorOrder = systemCache->template colorOrder< MatrixReal >( depth );
+			if( !colorOrder )
+			{
+				colorOrder = AllocPointer< int >( _sNodesSize( depth ) );
+				_setColorOrder( UIntPack< FEMSigs ... >() , _sNodesBegin( depth ) , _sNodesEnd( depth ) , colorOrder );
+				if( cached ) systemCache->template colorOrder< MatrixReal >( depth ) = colorOrder;
+			}
+		}
+		_setSliceSystem( UIntPack< FEMSigs ... >() , F , bsData , depth , _sNodesBegin( depth ) , _sNodesEnd( depth ) , prolongedSolution , _constraints , matrixFree , ( ConstPointer( int ) )colorOrder , _sNodesBegin( depth ) , system , ccStencil , pcStencils , interpolationInfo... );
+		ConstPointer( char ) stencilRows = system.stencilRows;
+		auto Position = [&]( int i ){ return colorOrder ? colorOrder[ i - _sNodesBegin(depth) ] - _sNodesBegin(depth) : i - _sNodesBegin(depth); };
+		{
+			Pointer( T ) __constraints = AllocPointer< T >( _sNodesSize( depth ) );
 #pragma omp parallel for
-		for( int i=_sNodesBegin(depth) ; i<_sNodesEnd(depth) ; i++ ) _constraints[ i - _sNodesBegin(depth) ] = constraints[ _sNodes.treeNodes[i]->nodeData.nodeIndex ] - _constraints[ i - _sNodesBegin(depth) ];
+			for( int i=_sNodesBegin(depth) ; i<_sNodesEnd(depth) ; i++ ) __constraints[ Position(i) ] = constraints[ _sNodes.treeNodes[i]->nodeData.nodeIndex ] - _constraints[ i - _sNodesBegin(depth) ];
+			FreePointer( _constraints );
+			_constraints = __constraints;
+		}
 		{
 			int begin = _sNodesBegin( depth ) , end = _sNodesEnd( depth );
-			for( int i=begin ; i<end ; i++ ) if( M.rowSize( i-begin ) ) D[i-begin] *= sorWeights[i];
+			for( int i=begin ; i<end ; i++ )
+			{
+				int j = Position(i);
+				D[j] = ( M.rowSize( j ) || ( stencilRows && stencilRows[j] ) ) ? (MatrixReal)( system.D[j] * sorWeights[i] ) : system.D[j];
+			}
 		}
+		stats.addSystem< MatrixReal , T >( M.rowNum , M.entries() );
 
 		systemTime += Time()-t;
 		// The list of multi-colored indices  for each in-memory slice
-		std::vector< std::vector< int > > mcIndices;
-		_setMultiColorIndices( UIntPack< FEMSigs ... >() , _sNodesBegin( depth ) , _sNodesEnd( depth ) , mcIndices );
+		const std::vector< std::vector< int > >& mcIndices = system.mcIndices;
 
 		ConstPointer( T ) B = _constraints;
 		Pointer( T ) X = GetPointer( &solution[0] + _sNodesBegin( depth ) , _sNodesSize( depth ) );
+		if( colorOrder ) _permuteColorOrder( X , _sNodesSize( depth ) , ( ConstPointer( int ) )colorOrder , _sNodesBegin( depth ) , true );
 		if( computeNorms )
 #pragma omp parallel for reduction( + : bNorm , inRNorm )
 			for( int j=0 ; j<M.rowNum ; j++ )
 			{
-				T temp = {};
-				ConstPointer( MatrixEntry< Real > ) start = M[j];
-				ConstPointer( MatrixEntry< Real > ) end = start + (unsigned long long)M.rowSizes[j];
-				ConstPointer( MatrixEntry< Real > ) e;
-				for( e=start ; e!=end ; e++ ) temp += X[ e->N ] * e->Value;
+				T temp = _rowProduct( UIntPack< FEMSigs ... >() , M , stencilRows , ccStencil , neighborKeys[ omp_get_thread_num() ] , _sNodesBegin( depth ) , j , ( ConstPointer( T ) )X );
 				bNorm += Dot( B[j] , B[j] );
 				inRNorm += Dot( temp - B[j] , temp - B[j] );
 			}
 
 		t = Time();
 		MemoryUsage();
-		for( int i=0 ; i<iters ; i++ ) M.gsIteration( mcIndices , ( ConstPointer( Real ) )D , B , X , coarseToFine , true );
+		if( stencilRows ) for( int i=0 ; i<iters ; i++ ) _gsIteration( UIntPack< FEMSigs ... >() , M , stencilRows , ccStencil , neighborKeys , _sNodesBegin( depth ) , mcIndices , ( ConstPointer( MatrixReal ) )D , B , X , coarseToFine );
+		else              for( int i=0 ; i<iters ; i++ ) M.gsColorIteration( system.colorStarts , ( ConstPointer( MatrixReal ) )D , B , X , coarseToFine , true );
 		FreePointer( D );
 		solveTime += Time() - t;
 
@@ -284,13 +323,11 @@ int FEMTree< Dim , Real >::_solveFullSystemGS( UIntPack< FEMSigs ... > , const t
 #pragma omp parallel for reduction( + : outRNorm )
 			for( int j=0 ; j<M.rowNum ; j++ )
 			{
-				T temp = {};
-				ConstPointer( MatrixEntry< Real > ) start = M[j];
-				ConstPointer( MatrixEntry< Real > ) end = start + (unsigned long long)M.rowSizes[j];
-				ConstPointer( MatrixEntry< Real > ) e;
-				for( e=start ; e!=end ; e++ ) temp += X[ e->N ] * e->Value;
+				T temp = _rowProduct( UIntPack< FEMSigs ... >() , M , stencilRows , ccStencil , neighborKeys[ omp_get_thread_num() ] , _sNodesBegin( depth ) , j , ( ConstPointer( T ) )X );
 				outRNorm += Dot( temp-B[j] , temp-B[j] );
 			}
+		if( colorOrder ) _permuteColorOrder( X , _sNodesSize( depth ) , ( ConstPointer( int ) )colorOrder , _sNodesBegin( depth ) , false );
+		if( !cached ) FreePointer( colorOrder );
 		FreePointer( _constraints );
 	}
 	if( computeNorms ) stats.bNorm2 = bNorm , stats.inRNorm2 = inRNorm , stats.outRNorm2 = outRNorm;
@@ -299,10 +336,10 @@ int FEMTree< Dim , Real >::_solveFullSystemGS( UIntPack< FEMSigs ... > , const t
 	return iters;
 }
 template< unsigned int Dim , class Real >
-template< unsigned int ... FEMSigs , typename T , typename TDotT , typename SORWeights , unsigned int ... PointDs >
-int FEMTree< Dim , Real >::_solveSlicedSystemGS( UIntPack< FEMSigs ... > , const typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) prolongedSolution , ConstPointer( T ) constraints , TDotT Dot , int iters , bool coarseToFine , unsigned int sliceBlockSize , SORWeights sorWeights , _SolverStats& stats , bool computeNorms , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
+template< typename MatrixReal , unsigned int ... FEMSigs , typename T , typename TDotT , typename SORWeights , unsigned int ... PointDs >
+int FEMTree< Dim , Real >::_solveSlicedSystemGS( UIntPack< FEMSigs ... > , const typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) prolongedSolution , ConstPointer( T ) constraints , TDotT Dot , int iters , bool coarseToFine , unsigned int sliceBlockSize , bool concurrentBlocks , SORWeights sorWeights , bool matrixFree , SystemCache* systemCache , _SolverStats& stats , bool computeNorms , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
 {
-	if( sliceBlockSize<=0 ) return _solveFullSystemGS( UIntPack< FEMSigs ... >() , F , bsData , depth , solution , prolongedSolution , constraints , Dot , iters , coarseToFine , sorWeights , stats , computeNorms , interpolationInfo ... );
+	if( sliceBlockSize<=0 ) return _solveFullSystemGS< MatrixReal >( UIntPack< FEMSigs ... >() , F , bsData , depth , solution , prolongedSolution , constraints , Dot , iters , coarseToFine , sorWeights , matrixFree , systemCache , stats , computeNorms , interpolationInfo ... );
 	CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > > ccStencil;
 	PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > > pcStencils;
 	F.template setStencil< false >( ccStencil );
@@ -377,6 +414,7 @@ int FEMTree< Dim , Real >::_solveSlicedSystemGS( UIntPack< FEMSigs ... > , const
 		double& systemTime = stats.systemTime;
 		double&  solveTime = stats. solveTime;
 		systemTime = solveTime = 0.;
+		stats.clearSystem();
 
 		struct BlockWindow
 		{
@@ -401,19 +439,38 @@ int FEMTree< Dim , Real >::_solveSlicedSystemGS( UIntPack< FEMSigs ... > , const
 		bool forward = !coarseToFine;
 		int residualOffset = computeNorms ? OverlapBlockRadius : 0;
 		// Set the number of in-memory blocks required for a temporally blocked solver
-		const int ColorModulus = OverlapBlockRadius;
+		// (Relaxing concurrently, the blocks of a step are one block further apart so that none reads the unknowns of another)
+		const int ColorModulus = OverlapBlockRadius + ( concurrentBlocks ? 1 : 0 );
 		// The number of in-core blocks over which we relax
 		// [WARNING] If the block size is larger than one, we may be able to use fewer blocks
 		int solveBlocks = std::max< int >( 0 , std::min< int >( ColorModulus*iters - ( ColorModulus-1 ) , blockEnd-blockBegin ) );
 		// The number of in-core blocks over which we either solve or compute residuals
 		int matrixBlocks = std::max< int >( 1 , std::min< int >( solveBlocks+2*residualOffset , blockEnd-blockBegin ) );
-		// The list of matrices for each in-memory block
-		Pointer( SparseMatrix< Real > ) _M = NewPointer< SparseMatrix< Real > >( matrixBlocks );
-		Pointer( Pointer( Real ) ) _D = AllocPointer< Pointer( Real ) >( matrixBlocks );
+		// The systems of the blocks, either the cached ones or those of the in-memory blocks
+		Pointer( _SliceSystem< MatrixReal > ) cachedSystems = systemCache && systemCache->sliceSystems ? systemCache->template slices< MatrixReal >( depth , blockEnd-blockBegin , sliceBlockSize , matrixFree ) : NullPointer( _SliceSystem< MatrixReal > );
+		Pointer( _SliceSystem< MatrixReal > ) _systems = cachedSystems ? NullPointer( _SliceSystem< MatrixReal > ) : NewPointer< _SliceSystem< MatrixReal > >( matrixBlocks );
+		// The list of systems for each in-memory block
+		std::vector< _SliceSystem< MatrixReal >* > _S( matrixBlocks , NULL );
+		Pointer( Pointer( MatrixReal ) ) _D = AllocPointer< Pointer( MatrixReal ) >( matrixBlocks );
 		std::vector< Pointer( T ) > _constraints( matrixBlocks );
-		for( int i=0 ; i<matrixBlocks ; i++ ) _D[i] = NullPointer( Real ) , _constraints[i] = NullPointer( T );
-		// The list of multi-colored indices  for each in-memory block
-		Pointer( std::vector< std::vector< int > > ) mcIndices = NewPointer< std::vector< std::vector< int > > >( solveBlocks );
+		for( int i=0 ; i<matrixBlocks ; i++ ) _D[i] = NullPointer( MatrixReal ) , _constraints[i] = NullPointer( T );
+		std::vector< ConstOneRingNeighborKey > neighborKeys( omp_get_max_threads() );
+		for( size_t i=0 ; i<neighborKeys.size() ; i++ ) neighborKeys[i].set( _localToGlobal( depth ) );
+		// Unless rows are applied matrix-free, the unknowns of the depth and the rows of the blocks are stored in color order while relaxing.
+		// The nodes are only reordered within their blocks, so the block windows into the solution are unchanged. The order is kept with cached systems.
+		Pointer( int ) colorOrder = NullPointer( int );
+		if( !matrixFree )
+		{
+			if( cachedSystems ) colorOrder = systemCache->template colorOrder< MatrixReal >( depth );
+			if( !colorOrder )
+			{
+				colorOrder = AllocPointer< int >( _sNodesSize( depth ) );
+				for( int i=0 ; i<_sNodesSize( depth ) ; i++ ) colorOrder[i] = i + _sNodesBegin( depth );
+				for( int b=blockBegin ; b<blockEnd ; b++ ) _setColorOrder( UIntPack< FEMSigs ... >() , _sNodesBegin( depth , BlockFirst( b ) ) , _sNodesEnd( depth , BlockLast( b ) ) , GetPointer( &colorOrder[0] + _sNodesBegin( depth , BlockFirst( b ) ) - _sNodesBegin( depth ) , _sNodesEnd( depth , BlockLast( b ) ) - _sNodesBegin( depth , BlockFirst( b ) ) ) );
+				if( cachedSystems ) systemCache->template colorOrder< MatrixReal >( depth ) = colorOrder;
+			}
+			_permuteColorOrder( GetPointer( &solution[0] + _sNodesBegin( depth ) , _sNodesSize( depth ) ) , _sNodesSize( depth ) , ( ConstPointer( int ) )colorOrder , _sNodesBegin( depth ) , true );
+		}
 		int dir = forward ? 1 : -1 , start = forward ? blockBegin : blockEnd-1 , end = forward ? blockEnd : blockBegin-1;
 		const BlockWindow FullWindow( blockBegin , blockEnd );
 		BlockWindow residualWindow( FullWindow.begin(forward) , FullWindow.begin(forward) - ( ColorModulus*iters - ( ColorModulus-1 ) ) * dir - 2*residualOffset*dir );
@@ -425,8 +482,7 @@ int FEMTree< Dim , Real >::_solveSlicedSystemGS( UIntPack< FEMSigs ... > , const
 		{
 			double t;
 			{
-				int frontSolveBlock =    solveWindow.begin(!forward);
-				int residualBlock   = residualWindow.begin(!forward);
+				int residualBlock = residualWindow.begin(!forward);
 				// Get the leading matrix and compute the constraint norm / initial residual
 				// [WARNNG] This is likely wrong. We probably have to pull this into its own for "for( int _c=0 ; _c<ColorModulus ; _c++ )" loop
 				//          to ensure that adjacent read-only blocks have not been updated yet.
@@ -435,52 +491,62 @@ int FEMTree< Dim , Real >::_solveSlicedSystemGS( UIntPack< FEMSigs ... > , const
 					int b = residualBlock , _b = MOD( b , matrixBlocks );
 
 					t = Time();
+					if( cachedSystems ) _S[_b] = &cachedSystems[ b-blockBegin ];
+					else                _S[_b] = &_systems[_b] , _S[_b]->valid = false;
+					const _SliceSystem< MatrixReal >& system = *_S[_b];
 					FreePointer( _D[_b] );
-					_D[_b] = AllocPointer< Real >( _sNodesEnd( depth , BlockLast( b ) ) - _sNodesBegin( depth , BlockFirst( b ) ) );
+					_D[_b] = AllocPointer< MatrixReal >( _sNodesEnd( depth , BlockLast( b ) ) - _sNodesBegin( depth , BlockFirst( b ) ) );
 					FreePointer( _constraints[_b] );
 					_constraints[_b] = AllocPointer< T >( _sNodesEnd( depth , BlockLast( b ) ) - _sNodesBegin( depth , BlockFirst( b ) ) );
-					_getSliceMatrixAndProlongationConstraints( UIntPack< FEMSigs ... >() , F , _M[_b] , _D[_b] , bsData , depth , _sNodesBegin( depth , BlockFirst( b ) ) , _sNodesEnd( depth , BlockLast( b ) ) , prolongedSolution , _constraints[_b] , ccStencil , pcStencils , interpolationInfo... );
-#pragma omp parallel for
-					for( int i=_sNodesBegin( depth , BlockFirst( b ) ) ; i<_sNodesEnd( depth , BlockLast( b ) ) ; i++ ) _constraints[_b][ i - _sNodesBegin( depth , BlockFirst( b ) ) ] = constraints[i] - _constraints[_b][ i - _sNodesBegin( depth , BlockFirst( b ) ) ];
+					_setSliceSystem( UIntPack< FEMSigs ... >() , F , bsData , depth , _sNodesBegin( depth , BlockFirst( b ) ) , _sNodesEnd( depth , BlockLast( b ) ) , prolongedSolution , _constraints[_b] , matrixFree , ( ConstPointer( int ) )colorOrder , _sNodesBegin( depth ) , *_S[_b] , ccStencil , pcStencils , interpolationInfo... );
 					{
 						int begin = _sNodesBegin( depth , BlockFirst( b ) ) , end = _sNodesEnd( depth , BlockLast( b ) );
-						for( int i=begin ; i<end ; i++ ) if( _M[_b].rowSize( i-begin ) ) _D[_b][i-begin] *= sorWeights[i];
+						auto Position = [&]( int i ){ return colorOrder ? colorOrder[ i - _sNodesBegin( depth ) ] - begin : i - begin; };
+						Pointer( T ) __constraints = AllocPointer< T >( end - begin );
+#pragma omp parallel for
+						for( int i=begin ; i<end ; i++ ) __constraints[ Position(i) ] = constraints[i] - _constraints[_b][ i - begin ];
+						FreePointer( _constraints[_b] );
+						_constraints[_b] = __constraints;
+						for( int i=begin ; i<end ; i++ )
+						{
+							int j = Position(i);
+							_D[_b][j] = ( system.M.rowSize( j ) || ( system.stencilRows && system.stencilRows[j] ) ) ? (MatrixReal)( system.D[j] * sorWeights[i] ) : system.D[j];
+						}
 					}
+					stats.addSystem< MatrixReal , T >( system.M.rowNum , system.M.entries() );
 					systemTime += Time()-t;
 					if( computeNorms )
 					{
 						ConstPointer( T ) B = _constraints[_b];
 						ConstPointer( T ) X = XBlocks( depth , b , solution );
 #pragma omp parallel for reduction( + : bNorm , inRNorm )
-						for( int j=0 ; j<_M[_b].rowNum ; j++ )
+						for( int j=0 ; j<system.M.rowNum ; j++ )
 						{
-							T temp = {};
-							ConstPointer( MatrixEntry< Real > ) start = _M[_b][j];
-							ConstPointer( MatrixEntry< Real > ) end = start + (unsigned long long)_M[_b].rowSizes[j];
-							ConstPointer( MatrixEntry< Real > ) e;
-							for( e=start ; e!=end ; e++ ) temp += X[ e->N ] * e->Value;
+							T temp = _rowProduct( UIntPack< FEMSigs ... >() , system.M , ( ConstPointer( char ) )system.stencilRows , ccStencil , neighborKeys[ omp_get_thread_num() ] , _sNodesBegin( depth , BlockFirst( b ) ) , j , X );
 							bNorm += Dot( B[j] , B[j] );
 							inRNorm += Dot( temp - B[j] , temp - B[j] );
 						}
 					}
 				}
 				t = Time();
-				// Get the leading multi-color indices
-				if( iters && FullWindow.inBlock( frontSolveBlock ) )
-				{
-					int b = frontSolveBlock , _b = MOD( b , matrixBlocks ) , __b = MOD( b , solveBlocks );
-					for( int i=0 ; i<int( mcIndices[__b].size() ) ; i++ ) mcIndices[__b][i].clear();
-					_setMultiColorIndices( UIntPack< FEMSigs ... >() , _sNodesBegin( depth , BlockFirst( b ) ) , _sNodesEnd( depth , BlockLast( b ) ) , mcIndices[__b] );
-				}
 			}
 
 			// Relax the system
-			for( int block=solveWindow.begin(!forward) ; solveWindow.inBlock(block) ; block-=dir*ColorModulus ) if( FullWindow.inBlock( block ) )
+			if( concurrentBlocks )
 			{
-				int b = block , _b = MOD( b , matrixBlocks ) , __b = MOD( b , solveBlocks );
+				std::vector< int > blocks , slots;
+				for( int block=solveWindow.begin(!forward) ; solveWindow.inBlock(block) ; block-=dir*ColorModulus ) if( FullWindow.inBlock( block ) ) blocks.push_back( block ) , slots.push_back( MOD( block , matrixBlocks ) );
+				if( blocks.size() ) _gsSliceBlocksIteration( UIntPack< FEMSigs ... >() , blocks , slots , _S , _D , _constraints , [&]( int b ){ return XBlocks( depth , b , solution ); } , [&]( int b ){ return _sNodesBegin( depth , BlockFirst( b ) ); } , ccStencil , neighborKeys , coarseToFine );
+			}
+			else for( int block=solveWindow.begin(!forward) ; solveWindow.inBlock(block) ; block-=dir*ColorModulus ) if( FullWindow.inBlock( block ) )
+			{
+				int b = block , _b = MOD( b , matrixBlocks );
+				const _SliceSystem< MatrixReal >& system = *_S[_b];
 				ConstPointer( T ) B = _constraints[_b];
 				Pointer( T ) X = XBlocks( depth , b , solution );
-				_M[_b].gsIteration( mcIndices[__b] , ( ConstPointer( Real ) )_D[_b] , B , X , coarseToFine , true );
+				if     ( system.stencilRows          ) _gsIteration( UIntPack< FEMSigs ... >() , system.M , ( ConstPointer( char ) )system.stencilRows , ccStencil , neighborKeys , _sNodesBegin( depth , BlockFirst( b ) ) , system.mcIndices , ( ConstPointer( MatrixReal ) )_D[_b] , B , X , coarseToFine );
+				else if( system.colorStarts.size() ) system.M.gsColorIteration( system.colorStarts , ( ConstPointer( MatrixReal ) )_D[_b] , B , X , coarseToFine , true );
+				else                                 system.M.gsIteration( system.mcIndices , ( ConstPointer( MatrixReal ) )_D[_b] , B , X , coarseToFine , true );
 			}
 			solveTime += Time() - t;
 
@@ -490,16 +556,13 @@ int FEMTree< Dim , Real >::_solveSlicedSystemGS( UIntPack< FEMSigs ... > , const
 				if( computeNorms && FullWindow.inBlock( residualBlock ) )
 				{
 					int b = residualBlock , _b = MOD( b , matrixBlocks );
+					const _SliceSystem< MatrixReal >& system = *_S[_b];
 					ConstPointer( T ) B = _constraints[_b];
 					ConstPointer( T ) X = XBlocks( depth , b , solution );
 #pragma omp parallel for reduction( + : outRNorm )
-					for( int j=0 ; j<_M[_b].rowNum ; j++ )
+					for( int j=0 ; j<system.M.rowNum ; j++ )
 					{
-						T temp = {};
-						ConstPointer( MatrixEntry< Real > ) start = _M[_b][j];
-						ConstPointer( MatrixEntry< Real > ) end = start + (unsigned long long)_M[_b].rowSizes[j];
-						ConstPointer( MatrixEntry< Real > ) e;
-						for( e=start ; e!=end ; e++ ) temp += X[ e->N ] * e->Value;
+						T temp = _rowProduct( UIntPack< FEMSigs ... >() , system.M , ( ConstPointer( char ) )system.stencilRows , ccStencil , neighborKeys[ omp_get_thread_num() ] , _sNodesBegin( depth , BlockFirst( b ) ) , j , X );
 						outRNorm += Dot( temp-B[j] , temp-B[j] );
 					}
 				}
@@ -507,10 +570,11 @@ int FEMTree< Dim , Real >::_solveSlicedSystemGS( UIntPack< FEMSigs ... > , const
 		}
 		for( int i=0 ; i<matrixBlocks ; i++ ) FreePointer( _D[i] );
 		for( int i=0 ; i<matrixBlocks ; i++ ) FreePointer( _constraints[i] );
+		if( colorOrder ) _permuteColorOrder( GetPointer( &solution[0] + _sNodesBegin( depth ) , _sNodesSize( depth ) ) , _sNodesSize( depth ) , ( ConstPointer( int ) )colorOrder , _sNodesBegin( depth ) , false );
+		if( !cachedSystems ) FreePointer( colorOrder );
 
 		if( computeNorms ) stats.bNorm2 = bNorm , stats.inRNorm2 = inRNorm , stats.outRNorm2 = outRNorm;
-		DeletePointer( _M );
-		DeletePointer( mcIndices );
+		DeletePointer( _systems );
 		FreePointer( _D );
 	}
 	MemoryUsage();
@@ -525,11 +589,12 @@ int FEMTree< Dim , Real >::_solveSystemCG( UIntPack< FEMSigs ... > , const typen
 	int iter = 0;
 	Pointer( T ) X = GetPointer( &solution[0] + _sNodesBegin(depth) , _sNodesSize(depth) );
 	ConstPointer( T ) B = GetPointer( &constraints[0] + _sNodesBegin(depth) , _sNodesSize(depth) );
-	SparseMatrix< Real > M;
+	CSRSparseMatrix< Real > M;
 
 	double& systemTime = stats.systemTime;
 	double&  solveTime = stats. solveTime;
 	systemTime = solveTime = 0.;
+	stats.clearSystem();
 	// Get the system matrix (and adjust the right-hand-side based on the coarser solution if prolonging)
 	systemTime = Time();
 	Pointer( T ) _constraints = AllocPointer< T >( _sNodesSize( depth ) );
@@ -538,16 +603,18 @@ int FEMTree< Dim , Real >::_solveSystemCG( UIntPack< FEMSigs ... > , const typen
 	PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > > pcStencils;
 	F.template setStencil< false >( ccStencil );
 	F.template setStencils< true >( pcStencils );
-	_getSliceMatrixAndProlongationConstraints( UIntPack< FEMSigs ... >() , F , M , NullPointer( Real ) , bsData , depth , _sNodesBegin( depth ) , _sNodesEnd( depth ) , prolongedSolution , _constraints , ccStencil , pcStencils , interpolationInfo... );
+	_getSliceMatrixAndProlongationConstraints< Real >( UIntPack< FEMSigs ... >() , F , M , NullPointer( Real ) , bsData , depth , _sNodesBegin( depth ) , _sNodesEnd( depth ) , prolongedSolution , _constraints , NullPointer( char ) , NullPointer( int ) , 0 , ccStencil , pcStencils , interpolationInfo... );
 #pragma omp parallel for
 	for( int i=_sNodesBegin(depth) ; i<_sNodesEnd(depth) ; i++ ) _constraints[ i - _sNodesBegin(depth) ] = constraints[i] - _constraints[ i - _sNodesBegin(depth) ];
+	stats.addSystem< Real , T >( M.rowNum , M.entries() );
 	systemTime = Time()-systemTime;
 	solveTime = Time();
 	// Solve the linear system
 	accuracy = Real( accuracy / 100000 ) * M.rowNum;
 	int dims[] = { ( _BSplineEnd< FEMSigs >( depth ) - _BSplineBegin< FEMSigs >( depth ) ) ... };
 	int nonZeroRows = 0;
-	for( int i=0 ; i<M.rowNum ; i++ ) if( M.rowSizes[i] ) nonZeroRows++;
+#pragma omp parallel for reduction( + : nonZeroRows )
+	for( int i=0 ; i<M.rowNum ; i++ ) if( M.rowSize(i) ) nonZeroRows++;
 	int totalDim = 1;
 	for( int d=0 ; d<Dim ; d++ ) totalDim *= dims[d];
 	BoundaryType bTypes[] = { FEMSignature< FEMSigs >::BType ... };
@@ -560,11 +627,7 @@ int FEMTree< Dim , Real >::_solveSystemCG( UIntPack< FEMSigs ... > , const typen
 #pragma omp parallel for reduction( + : bNorm , inRNorm )
 		for( int j=0 ; j<M.rowNum ; j++ )
 		{
-			T temp = {};
-			ConstPointer( MatrixEntry< Real > ) start = M[j];
-			ConstPointer( MatrixEntry< Real > ) end = start + (unsigned long long)M.rowSizes[j];
-			ConstPointer( MatrixEntry< Real > ) e;
-			for( e=start ; e!=end ; e++ ) temp += X[ e->N ] * e->Value;
+			T temp = M.rowDot( j , ( ConstPointer( T ) )X );
 			bNorm += Dot( B[j] , B[j] );
 			inRNorm += Dot( temp-B[j] , temp-B[j] );
 		}
@@ -574,18 +637,27 @@ int FEMTree< Dim , Real >::_solveSystemCG( UIntPack< FEMSigs ... > , const typen
 	struct SPDFunctor
 	{
 	protected:
-		const SparseMatrix< Real >& _M;
+		const CSRSparseMatrix< Real >& _M;
 		bool _addDCTerm;
 	public:
-		SPDFunctor( const SparseMatrix< Real >& M , bool addDCTerm ) : _M(M) , _addDCTerm(addDCTerm){ }
+		SPDFunctor( const CSRSparseMatrix< Real >& M , bool addDCTerm ) : _M(M) , _addDCTerm(addDCTerm){ }
 		void operator()( ConstPointer( T ) in , Pointer( T ) out ) const
 		{
 			_M.multiply( in , out );
 			if( _addDCTerm )
 			{
+				std::vector< T > averages( omp_get_max_threads() );
+#pragma omp parallel
+				{
+					T average = {};
+#pragma omp for
+					for( int i=0 ; i<_M.rowNum ; i++ ) average += in[i];
+					averages[ omp_get_thread_num() ] = average;
+				}
 				T average = {};
-				for( int i=0 ; i<_M.rowNum ; i++ ) average += in[i];
+				for( size_t t=0 ; t<averages.size() ; t++ ) average += averages[t];
 				average /= _M.rowNum;
+#pragma omp parallel for
 				for( int i=0 ; i<_M.rowNum ; i++ ) out[i] += average;
 			}
 		}
@@ -598,11 +670,7 @@ int FEMTree< Dim , Real >::_solveSystemCG( UIntPack< FEMSigs ... > , const typen
 #pragma omp parallel for reduction( + : outRNorm )
 		for( int j=0 ; j<M.rowNum ; j++ )
 		{
-			T temp = {};
-			ConstPointer( MatrixEntry< Real > ) start = M[j];
-			ConstPointer( MatrixEntry< Real > ) end = start + (unsigned long long)M.rowSizes[j];
-			ConstPointer( MatrixEntry< Real > ) e;
-			for( e=start ; e!=end ; e++ ) temp += X[ e->N ] * e->Value;
+			T temp = M.rowDot( j , ( ConstPointer( T ) )X );
 			outRNorm += Dot( temp-B[j] , temp-B[j] );
 		}
 		stats.bNorm2 = bNorm , stats.inRNorm2 = inRNorm , stats.outRNorm2 = outRNorm;
@@ -614,31 +682,185 @@ int FEMTree< Dim , Real >::_solveSystemCG( UIntPack< FEMSigs ... > , const typen
 }
 template< unsigned int Dim , class Real >
 template< unsigned int ... FEMSigs , typename T , typename TDotT , unsigned int ... PointDs >
-void FEMTree< Dim , Real >::_solveRegularMG( UIntPack< FEMSigs ... > ,  typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) constraints , TDotT Dot , int vCycles , int iters , _SolverStats& stats , bool computeNorms , double cgAccuracy , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
+int FEMTree< Dim , Real >::_solveSystemPCG( UIntPack< FEMSigs ... > , const typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) prolongedSolution , ConstPointer( T ) constraints , TDotT Dot , int iters , _SolverStats& stats , bool computeNorms , double residualTolerance , SystemCache* systemCache , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
 {
+	int iter = 0;
+	Pointer( T ) X = GetPointer( &solution[0] + _sNodesBegin(depth) , _sNodesSize(depth) );
+
 	double& systemTime = stats.systemTime;
 	double&  solveTime = stats. solveTime;
+	systemTime = solveTime = 0.;
+	stats.clearSystem();
+	// Get the system matrix and adjust the right-hand-side based on the coarser solution
+	systemTime = Time();
+	Pointer( T ) B = AllocPointer< T >( _sNodesSize( depth ) );
+	CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > > ccStencil;
+	PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > > pcStencils;
+	F.template setStencil< false >( ccStencil );
+	F.template setStencils< true >( pcStencils );
 
-	std::vector< SparseMatrix< Real , int > > P( depth ) , R( depth ) , M( depth+1 );
-	std::vector< Pointer( Real ) > D( depth+1 );
-	std::vector< Pointer( T ) > B( depth+1 ) , X( depth+1 ) , MX( depth+1 );
-	std::vector< std::vector< std::vector< int > > > multiColorIndices( depth+1 );
+	// The hierarchy only depends on the tree and the system, so a cached one is reused and only the constraints are recomputed
+	_MGHierarchy _hierarchy;
+	_MGHierarchy& hierarchy = systemCache ? systemCache->pcgMG : _hierarchy;
+	std::vector< CSRSparseMatrix< Real > >& P = hierarchy.P;
+	std::vector< CSRSparseMatrix< Real > >& R = hierarchy.R;
+	std::vector< CSRSparseMatrix< Real > >& M = hierarchy.M;
+	std::vector< Pointer( Real ) >& D = hierarchy.D;
+	std::vector< std::vector< std::vector< int > > >& multiColorIndices = hierarchy.multiColorIndices;
+	if( hierarchy.depth==depth ) _getProlongationConstraints( UIntPack< FEMSigs ... >() , F , bsData , depth , _sNodesBegin( depth ) , _sNodesEnd( depth ) , prolongedSolution , B , pcStencils , interpolationInfo ... );
+	else
+	{
+		hierarchy.clear();
+		M.resize( depth+1 );
+		_getSliceMatrixAndProlongationConstraints< Real >( UIntPack< FEMSigs ... >() , F , M.back() , NullPointer( Real ) , bsData , depth , _sNodesBegin( depth ) , _sNodesEnd( depth ) , prolongedSolution , B , NullPointer( char ) , NullPointer( int ) , 0 , ccStencil , pcStencils , interpolationInfo... );
+		_setMGHierarchy( UIntPack< FEMSigs ... >() , hierarchy , depth );
+	}
+#pragma omp parallel for
+	for( int i=_sNodesBegin(depth) ; i<_sNodesEnd(depth) ; i++ ) B[ i - _sNodesBegin(depth) ] = constraints[i] - B[ i - _sNodesBegin(depth) ];
 
-	systemTime = Time();
-	M.back() = systemMatrix< Real >( UIntPack< FEMSigs ... >() , F , depth , interpolationInfo ... );
+	std::vector< Pointer( T ) > _B( depth+1 ) , _X( depth+1 ) , MX( depth+1 );
+	for( int d=0 ; d<=depth ; d++ )
+	{
+		size_t dim = M[d].rows();
+		MX[d] = AllocPointer< T >( dim );
+		if( d<depth )
+		{
+			_X[d] = AllocPointer< T >( dim );
+			_B[d] = AllocPointer< T >( dim );
+		}
+	}
+	int coarseRows = 0;
+	for( size_t i=0 ; i<M[0].rows() ; i++ ) if( M[0].rowSize(i) ) coarseRows++;
+
+	// An iteration multiplies by the matrix and applies the v-cycle, which relaxes every level but the coarsest twice and computes its residual,
+	// and the size reported is that of the finest level
+	for( int d=0 ; d<=depth ; d++ ) stats.addSystem< Real , T >( M[d].rows() , M[d].entries() , d ? ( d==depth ? 4 : 3 ) : 1 );
+	stats.rows = M.back().rows() , stats.entries = M.back().entries();
+	systemTime = Time()-systemTime;
+
+	const CSRSparseMatrix< Real >& _M = M.back();
+	double bNorm = 0 , inRNorm = 0 , outRNorm = 0;
+	if( computeNorms )
+	{
+#pragma omp parallel for reduction( + : bNorm , inRNorm )
+		for( int j=0 ; j<_M.rowNum ; j++ )
+		{
+			T temp = _M.rowDot( j , ( ConstPointer( T ) )X );
+			bNorm += Dot( B[j] , B[j] );
+			inRNorm += Dot( temp-B[j] , temp-B[j] );
+		}
+	}
+
+	// Solve the linear system
+	solveTime = Time();
+	auto Multiply = [&]( ConstPointer( T ) in , Pointer( T ) out ){ _M.multiply( in , out ); };
+	auto CoarseMultiply = [&]( ConstPointer( T ) in , Pointer( T ) out ){ M[0].multiply( in , out ); };
+	// One v-cycle from a zero initial guess. Since the coarse systems are the Galerkin restrictions, the prolongation is the transpose of the restriction,
+	// the sweeps on the way up are the reverse of those on the way down and the coarsest level is solved exactly, it is a symmetric preconditioner.
+	auto Precondition = [&]( ConstPointer( T ) in , Pointer( T ) out )
+	{
+		_B[depth] = ( Pointer( T ) )in , _X[depth] = out;
+		// Restriction
+		for( int d=depth ; d>0 ; d-- )
+		{
+#pragma omp parallel for
+			for( int i=0 ; i<(int)M[d].rows() ; i++ ) _X[d][i] = T();
+			M[d].gsIteration( multiColorIndices[d] , ( ConstPointer( Real ) )D[d] , ( ConstPointer( T ) )_B[d] , _X[d] , true , true );
+			M[d].multiply( _X[d] , MX[d] );
+#pragma omp parallel for
+			for( int i=0 ; i<(int)M[d].rows() ; i++ ) MX[d][i] = _B[d][i] - MX[d][i];
+			R[d-1].multiply( MX[d] , _B[d-1] );
+		}
+		// Base
+#pragma omp parallel for
+		for( int i=0 ; i<(int)M[0].rows() ; i++ ) _X[0][i] = T();
+		SolveCG< decltype( CoarseMultiply ) , T , Real >( CoarseMultiply , (int)M[0].rows() , ( ConstPointer( T ) )_B[0] , coarseRows , _X[0] , 0. , Dot );
+		// Prolongation
+		for( int d=1 ; d<=depth ; d++ )
+		{
+			P[d-1].multiply( _X[d-1] , _X[d] , MULTIPLY_ADD );
+			M[d].gsIteration( multiColorIndices[d] , ( ConstPointer( Real ) )D[d] , ( ConstPointer( T ) )_B[d] , _X[d] , false , true );
+		}
+	};
+	PreconditionedCGScratch< T > scratch( (int)_M.rows() );
+	if( iters ) iter = _SolvePCG< T >( Multiply , Precondition , (int)_M.rows() , ( ConstPointer( T ) )B , iters , X , residualTolerance , Dot , scratch );
+	solveTime = Time()-solveTime;
+
+	if( computeNorms )
+	{
+#pragma omp parallel for reduction( + : outRNorm )
+		for( int j=0 ; j<_M.rowNum ; j++ )
+		{
+			T temp = _M.rowDot( j , ( ConstPointer( T ) )X );
+			outRNorm += Dot( temp-B[j] , temp-B[j] );
+		}
+		stats.bNorm2 = bNorm , stats.inRNorm2 = inRNorm , stats.outRNorm2 = outRNorm;
+	}
+	for( int d=0 ; d<=depth ; d++ )
+	{
+		FreePointer( MX[d] );
+		if( d<depth )
+		{
+			FreePointer( _X[d] );
+			FreePointer( _B[d] );
+		}
+	}
+	FreePointer( B );
+
+	MemoryUsage();
+	return iter;
+}
+template< unsigned int Dim , class Real >
+template< unsigned int ... FEMSigs >
+void FEMTree< Dim , Real >::_setMGHierarchy( UIntPack< FEMSigs ... > , _MGHierarchy& hierarchy , LocalDepth depth ) const
+{
+	std::vector< CSRSparseMatrix< Real > >& P = hierarchy.P;
+	std::vector< CSRSparseMatrix< Real > >& R = hierarchy.R;
+	std::vector< CSRSparseMatrix< Real > >& M = hierarchy.M;
+	P.resize( depth ) , R.resize( depth ) , hierarchy.D.resize( depth+1 ) , hierarchy.multiColorIndices.resize( depth+1 );
 	for( int d=depth ; d>0 ; d-- )
 	{
 		R[d-1] = downSampleMatrix( UIntPack< FEMSigs ... >() , d );
-		P[d-1] = R[d-1].transpose();
-		M[d-1] = R[d-1] * M[d] * P[d-1];
+		P[d-1] = R[d-1].transpose( M[d].rows() );
+		M[d-1] = CSRSparseMatrix< Real >::Multiply( CSRSparseMatrix< Real >::Multiply( R[d-1] , M[d] ) , P[d-1] );
+	}
+	for( int d=0 ; d<=depth ; d++ )
+	{
+		hierarchy.D[d] = AllocPointer< Real >( M[d].rows() );
+		M[d].setDiagonalR( hierarchy.D[d] );
+		setMultiColorIndices( UIntPack< FEMSigs ... >() , d , hierarchy.multiColorIndices[d] );
+	}
+	hierarchy.depth = depth;
+}
+template< unsigned int Dim , class Real >
+template< unsigned int ... FEMSigs , typename T , typename TDotT , unsigned int ... PointDs >
+void FEMTree< Dim , Real >::_solveRegularMG( UIntPack< FEMSigs ... > ,  typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) constraints , TDotT Dot , int vCycles , int iters , _SolverStats& stats , bool computeNorms , double cgAccuracy , SystemCache* systemCache , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
+{
+	double& systemTime = stats.systemTime;
+	double&  solveTime = stats. solveTime;
+
+	// The Galerkin hierarchy only depends on the tree and the system, so a cached one is reused
+	_MGHierarchy _hierarchy;
+	_MGHierarchy& hierarchy = systemCache ? systemCache->regularMG : _hierarchy;
+	std::vector< CSRSparseMatrix< Real > >& P = hierarchy.P;
+	std::vector< CSRSparseMatrix< Real > >& R = hierarchy.R;
+	std::vector< CSRSparseMatrix< Real > >& M = hierarchy.M;
+	std::vector< Pointer( Real ) >& D = hierarchy.D;
+	std::vector< std::vector< std::vector< int > > >& multiColorIndices = hierarchy.multiColorIndices;
+	std::vector< Pointer( T ) > B( depth+1 ) , X( depth+1 ) , MX( depth+1 );
+
+	systemTime = Time();
+	if( hierarchy.depth!=depth )
+	{
+		hierarchy.clear();
+		M.resize( depth+1 );
+		M.back() = systemMatrix< T >( UIntPack< FEMSigs ... >() , F , depth , interpolationInfo ... );
+		_setMGHierarchy( UIntPack< FEMSigs ... >() , hierarchy , depth );
 	}
 	for( int d=0 ; d<=depth ; d++ )
 	{
 		size_t dim = M[d].rows();
-		D[d]  = AllocPointer< Real >( dim );
 		MX[d] = AllocPointer< T >( dim );
-		M[d].setDiagonalR( D[d] );
-		setMultiColorIndices( UIntPack< FEMSigs ... >() , d , multiColorIndices[d] );
 		if( d<depth )
 		{
 			X[d]  = AllocPointer< T >( dim );
@@ -647,6 +869,13 @@ void FEMTree< Dim , Real >::_solveRegularMG( UIntPack< FEMSigs ... > ,  typename
 	}
 	X.back() = solution + nodesBegin( depth );
 	ConstPointer( T ) _B = constraints + nodesBegin( depth );
+	// A v-cycle relaxes every level but the coarsest twice per iteration (counting the conjugate-gradients solve of the coarsest as one pass), and the size reported is that of the finest level
+	stats.clearSystem();
+	for( int d=0 ; d<=depth ; d++ )
+	{
+		stats.addSystem< Real , T >( M[d].rows() , M[d].entries() , d ? 2*iters : 1 );
+		if( d==depth ) stats.rows = M[d].rows() , stats.entries = M[d].entries();
+	}
 	systemTime = Time() - systemTime;
 
 	solveTime = Time();
@@ -654,16 +883,12 @@ void FEMTree< Dim , Real >::_solveRegularMG( UIntPack< FEMSigs ... > ,  typename
 	double bNorm = 0 , inRNorm = 0 , outRNorm = 0;
 	if( computeNorms )
 	{
-		const SparseMatrix< Real , int >& _M = M.back();
+		const CSRSparseMatrix< Real >& _M = M.back();
 		ConstPointer( T ) _X = X.back();
 #pragma omp parallel for reduction( + : bNorm , inRNorm )
 		for( int j=0 ; j<_M.rowNum ; j++ )
 		{
-			T temp = {};
-			ConstPointer( MatrixEntry< Real > ) start = _M[j];
-			ConstPointer( MatrixEntry< Real > ) end = start + (unsigned long long)_M.rowSizes[j];
-			ConstPointer( MatrixEntry< Real > ) e;
-			for( e=start ; e!=end ; e++ ) temp += _X[ e->N ] * e->Value;
+			T temp = _M.rowDot( j , _X );
 			bNorm += Dot( _B[j] , _B[j] );
 			inRNorm += Dot( temp-_B[j] , temp-_B[j] );
 		}
@@ -677,9 +902,11 @@ void FEMTree< Dim , Real >::_solveRegularMG( UIntPack< FEMSigs ... > ,  typename
 			ConstPointer( T ) __B = d==depth ? _B : B[d];
 			for( int i=0 ; i<iters ; i++ ) M[d].gsIteration( multiColorIndices[d] , D[d] , __B , X[d] , true , true );
 			M[d].multiply( X[d] , MX[d] );
-			for( int i=0 ; i<M[d].rows() ; i++ ) MX[d][i] = __B[i] - MX[d][i];
+#pragma omp parallel for
+			for( int i=0 ; i<(int)M[d].rows() ; i++ ) MX[d][i] = __B[i] - MX[d][i];
 			R[d-1].multiply( MX[d] , B[d-1] );
-			memset( X[d-1] , 0 , sizeof( T )*M[d-1].rows() );
+#pragma omp parallel for
+			for( int i=0 ; i<(int)M[d-1].rows() ; i++ ) X[d-1][i] = T();
 		}
 
 		// Base
@@ -689,24 +916,34 @@ void FEMTree< Dim , Real >::_solveRegularMG( UIntPack< FEMSigs ... > ,  typename
 			struct SPDFunctor
 			{
 			protected:
-				const SparseMatrix< Real >& _M;
+				const CSRSparseMatrix< Real >& _M;
 				bool _addDCTerm;
 			public:
-				SPDFunctor( const SparseMatrix< Real >& M , bool addDCTerm ) : _M(M) , _addDCTerm(addDCTerm){ }
+				SPDFunctor( const CSRSparseMatrix< Real >& M , bool addDCTerm ) : _M(M) , _addDCTerm(addDCTerm){ }
 				void operator()( ConstPointer( T ) in , Pointer( T ) out ) const
 				{
 					_M.multiply( in , out );
 					if( _addDCTerm )
 					{
+						std::vector< T > averages( omp_get_max_threads() );
+#pragma omp parallel
+						{
+							T average = {};
+#pragma omp for
+							for( int i=0 ; i<_M.rowNum ; i++ ) average += in[i];
+							averages[ omp_get_thread_num() ] = average;
+						}
 						T average = {};
-						for( int i=0 ; i<_M.rowNum ; i++ ) average += in[i];
+						for( size_t t=0 ; t<averages.size() ; t++ ) average += averages[t];
 						average /= _M.rowNum;
+#pragma omp parallel for
 						for( int i=0 ; i<_M.rowNum ; i++ ) out[i] += average;
 					}
 				}
 			};
 			int nonZeroRows = 0;
-			for( int i=0 ; i<M[d].rowNum ; i++ ) if( M[d].rowSizes[i] ) nonZeroRows++;
+#pragma omp parallel for reduction( + : nonZeroRows )
+			for( int i=0 ; i<M[d].rowNum ; i++ ) if( M[d].rowSize(i) ) nonZeroRows++;
 			int totalDim = 1;
 			int dims[] = { ( _BSplineEnd< FEMSigs >( depth ) - _BSplineBegin< FEMSigs >( depth ) ) ... };
 			for( int dd=0 ; dd<Dim ; dd++ ) totalDim *= dims[dd];
@@ -728,16 +965,12 @@ void FEMTree< Dim , Real >::_solveRegularMG( UIntPack< FEMSigs ... > ,  typename
 	}
 	if( computeNorms )
 	{
-		const SparseMatrix< Real , int >& _M = M.back();
+		const CSRSparseMatrix< Real >& _M = M.back();
 		ConstPointer( T ) _X = X.back();
 #pragma omp parallel for reduction( + : outRNorm )
 		for( int j=0 ; j<_M.rowNum ; j++ )
 		{
-			T temp = {};
-			ConstPointer( MatrixEntry< Real > ) start = _M[j];
-			ConstPointer( MatrixEntry< Real > ) end = start + (unsigned long long)_M.rowSizes[j];
-			ConstPointer( MatrixEntry< Real > ) e;
-			for( e=start ; e!=end ; e++ ) temp += _X[ e->N ] * e->Value;
+			T temp = _M.rowDot( j , _X );
 			outRNorm += Dot( temp-_B[j] , temp-_B[j] );
 		}
 		stats.bNorm2 = bNorm , stats.inRNorm2 = inRNorm , stats.outRNorm2 = outRNorm;
@@ -748,7 +981,6 @@ void FEMTree< Dim , Real >::_solveRegularMG( UIntPack< FEMSigs ... > ,  typename
 
 	for( int d=0 ; d<=depth ; d++ )
 	{
-		FreePointer( D[d] );
 		FreePointer( MX[d] );
 		if( d<depth )
 		{
@@ -887,14 +1119,42 @@ void FEMTree< Dim , Real >::_addPointValues( UIntPack< FEMSigs ... > , StaticWin
 }
 
 template< unsigned int Dim , class Real >
-template< typename T , unsigned int ... PointDs , unsigned int ... FEMSigs >
-T FEMTree< Dim , Real >::_setMatrixRowAndGetConstraintFromProlongation( UIntPack< FEMSigs ... > , const BaseSystem< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& pNeighbors , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors , Pointer( MatrixEntry< Real > ) row , int offset , const PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& pcStencils , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , ConstPointer( T ) prolongedSolution , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
+template< unsigned int ... FEMSigs , typename T , unsigned int PointD >
+bool FEMTree< Dim , Real >::_hasPointSamples( UIntPack< FEMSigs ... > , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors , const InterpolationInfo< T , PointD >* interpolationInfo ) const
+{
+	typedef UIntPack< ( -BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapStart ) ... > OverlapRadii;
+	typedef UIntPack< ( -BSplineSupportSizes< FEMSignature< FEMSigs >::Degree >::SupportStart ) ... > LeftSupportRadii;
+	typedef UIntPack<    BSplineSupportSizes< FEMSignature< FEMSigs >::Degree >::SupportEnd     ... > RightSupportRadii;
+
+	if( !interpolationInfo ) return false;
+	bool hasSamples = false;
+	// Loop over all nodes which are supported on the center, as in _addPointValues
+	WindowLoop< Dim >::Run
+	(
+		OverlapRadii() - LeftSupportRadii() , OverlapRadii() + RightSupportRadii() + IsotropicUIntPack< Dim , 1 >() ,
+		[&]( int , int ){} ,
+		[&]( const FEMTreeNode* _node )
+		{
+			if( !hasSamples && _isValidSpaceNode( _node ) )
+			{
+				size_t begin , end;
+				interpolationInfo->range( _node , begin , end );
+				if( begin<end ) hasSamples = true;
+			}
+		} ,
+		neighbors.neighbors()
+	);
+	return hasSamples;
+}
+
+template< unsigned int Dim , class Real >
+template< typename T , unsigned int ... PointDs , unsigned int ... FEMSigs , typename MatrixRow >
+T FEMTree< Dim , Real >::_setMatrixRowAndGetConstraintFromProlongation( UIntPack< FEMSigs ... > , const BaseSystem< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& pNeighbors , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors , MatrixRow row , int offset , const PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& pcStencils , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , ConstPointer( T ) prolongedSolution , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
 {
 	T constraint ={};
 	typedef UIntPack< ( -BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapStart ) ... > OverlapRadii;
 	typedef UIntPack<    BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize    ... > OverlapSizes;
 
-	int count = 0;
 	const FEMTreeNode* node = neighbors.neighbors.data[ WindowIndex< OverlapSizes , OverlapRadii >::Index ];
 	LocalDepth d ; LocalOffset off;
 	_localDepthAndOffset( node , d , off );
@@ -904,11 +1164,26 @@ T FEMTree< Dim , Real >::_setMatrixRowAndGetConstraintFromProlongation( UIntPack
 		constraint = _getConstraintFromProlongedSolution( UIntPack< FEMSigs ... >() , F , neighbors , pNeighbors , node , prolongedSolution , pcStencils.data[cIdx] , bsData , interpolationInfo... );
 	}
 
-	bool isInterior = BaseFEMIntegrator::IsInteriorlyOverlapped( UIntPack< FEMSignature< FEMSigs >::Degree ... >() , UIntPack< FEMSignature< FEMSigs >::Degree ... >() , d , off );
-
 	StaticWindow< Real , UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > > pointValues;
 	memset( pointValues.data , 0 , sizeof(Real)*WindowSize< OverlapSizes >::Size );
 	_addPointValues( UIntPack< FEMSigs ... >() , pointValues , neighbors , bsData , interpolationInfo ... );
+	_setMatrixRow( UIntPack< FEMSigs ... >() , F , neighbors , pointValues , row , offset , ccStencil );
+	return constraint;
+}
+
+template< unsigned int Dim , class Real >
+template< unsigned int ... FEMSigs , typename MatrixRow >
+void FEMTree< Dim , Real >::_setMatrixRow( UIntPack< FEMSigs ... > , const BaseSystem< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors , StaticWindow< Real , UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& pointValues , MatrixRow row , int offset , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil ) const
+{
+	typedef UIntPack< ( -BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapStart ) ... > OverlapRadii;
+	typedef UIntPack<    BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize    ... > OverlapSizes;
+
+	int count = 0;
+	const FEMTreeNode* node = neighbors.neighbors.data[ WindowIndex< OverlapSizes , OverlapRadii >::Index ];
+	LocalDepth d ; LocalOffset off;
+	_localDepthAndOffset( node , d , off );
+	bool isInterior = BaseFEMIntegrator::IsInteriorlyOverlapped( UIntPack< FEMSignature< FEMSigs >::Degree ... >() , UIntPack< FEMSignature< FEMSigs >::Degree ... >() , d , off );
+
 	int nodeIndex = node->nodeData.nodeIndex;
 	if( isInterior ) // General case, so try to make fast
 	{
@@ -944,7 +1219,90 @@ T FEMTree< Dim , Real >::_setMatrixRowAndGetConstraintFromProlongation( UIntPack
 			neighbors.neighbors() , pointValues()
 		);
 	}
-	return constraint;
+}
+
+template< unsigned int Dim , class Real >
+template< unsigned int ... FEMSigs , typename RowFunctor >
+void FEMTree< Dim , Real >::_processStencilRow( UIntPack< FEMSigs ... > , ConstOneRingNeighborKey& neighborKey , const FEMTreeNode* node , int offset , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , RowFunctor F ) const
+{
+	typedef UIntPack< ( -BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapStart ) ... > OverlapRadii;
+	typedef UIntPack<    BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize    ... > OverlapSizes;
+	static const int CenterIndex = WindowIndex< OverlapSizes , OverlapRadii >::Index;
+
+	typename FEMTreeNode::template ConstNeighbors< OverlapSizes > neighbors;
+	neighborKey.getNeighbors( OverlapRadii() , OverlapRadii() , node , neighbors );
+	const FEMTreeNode* const * _nodes = neighbors.neighbors.data;
+	ConstPointer( double ) _stencil = ccStencil.data;
+	F( node->nodeData.nodeIndex-offset , (Real)_stencil[ CenterIndex ] );
+	for( int i=0 ; i<WindowSize< OverlapSizes >::Size ; i++ ) if( i!=CenterIndex && _isValidFEM1Node( _nodes[i] ) ) F( _nodes[i]->nodeData.nodeIndex-offset , (Real)_stencil[i] );
+}
+
+template< unsigned int Dim , class Real >
+template< typename MatrixReal , unsigned int ... FEMSigs , typename T >
+T FEMTree< Dim , Real >::_rowProduct( UIntPack< FEMSigs ... > , const CSRSparseMatrix< MatrixReal >& M , ConstPointer( char ) stencilRows , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , ConstOneRingNeighborKey& neighborKey , int offset , int row , ConstPointer( T ) x ) const
+{
+	T temp = {};
+	if( stencilRows && stencilRows[row] ) _processStencilRow( UIntPack< FEMSigs ... >() , neighborKey , _sNodes.treeNodes[ row+offset ] , offset , ccStencil , [&]( int n , Real value ){ temp += x[n] * value; } );
+	else temp = M.rowDot( row , x );
+	return temp;
+}
+
+template< unsigned int Dim , class Real >
+template< typename MatrixReal , unsigned int ... FEMSigs , typename T >
+void FEMTree< Dim , Real >::_gsIteration( UIntPack< FEMSigs ... > , const CSRSparseMatrix< MatrixReal >& M , ConstPointer( char ) stencilRows , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , std::vector< ConstOneRingNeighborKey >& neighborKeys , int offset , const std::vector< std::vector< int > >& multiColorIndices , ConstPointer( MatrixReal ) diagonalR , ConstPointer( T ) b , Pointer( T ) x , bool forward ) const
+{
+	for( int c=0 ; c<(int)multiColorIndices.size() ; c++ )
+	{
+		const std::vector< int >& indices = multiColorIndices[ forward ? c : (int)multiColorIndices.size()-1-c ];
+#pragma omp parallel for
+		for( int k=0 ; k<(int)indices.size() ; k++ )
+		{
+			int jj = indices[k];
+			T _b = b[jj];
+			if( stencilRows[jj] ) _processStencilRow( UIntPack< FEMSigs ... >() , neighborKeys[ omp_get_thread_num() ] , _sNodes.treeNodes[ jj+offset ] , offset , ccStencil , [&]( int n , Real value ){ _b -= x[n] * value; } );
+			else for( size_t e=M.rowOffsets[jj] ; e<M.rowOffsets[jj+1] ; e++ ) _b -= x[ M.columns[e] ] * M.values[e];
+			x[jj] += _b * diagonalR[jj];
+		}
+	}
+}
+
+template< unsigned int Dim , class Real >
+template< typename MatrixReal , unsigned int ... FEMSigs , typename T , typename XFunction , typename OffsetFunction >
+void FEMTree< Dim , Real >::_gsSliceBlocksIteration( UIntPack< FEMSigs ... > , const std::vector< int >& blocks , const std::vector< int >& slots , const std::vector< _SliceSystem< MatrixReal >* >& systems , Pointer( Pointer( MatrixReal ) ) diagonalsR , const std::vector< Pointer( T ) >& constraints , XFunction X , OffsetFunction Offset , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , std::vector< ConstOneRingNeighborKey >& neighborKeys , bool forward ) const
+{
+	size_t blockCount = blocks.size();
+	std::vector< const _SliceSystem< MatrixReal >* > S( blockCount );
+	std::vector< ConstPointer( MatrixReal ) > D( blockCount );
+	std::vector< ConstPointer( T ) > B( blockCount );
+	std::vector< Pointer( T ) > x( blockCount );
+	std::vector< int > offsets( blockCount ) , rowStarts( blockCount+1 );
+	for( size_t k=0 ; k<blockCount ; k++ )
+	{
+		int b = blocks[k] , _b = slots[k];
+		S[k] = systems[_b] , D[k] = diagonalsR[_b] , B[k] = constraints[_b] , x[k] = X( b ) , offsets[k] = Offset( b );
+	}
+	int colors = (int)S[0]->mcIndices.size();
+	for( int c=0 ; c<colors ; c++ )
+	{
+		int cc = forward ? c : colors-1-c;
+		// The rows of the color in all the blocks are relaxed by a single parallel loop
+		rowStarts[0] = 0;
+		for( size_t k=0 ; k<blockCount ; k++ ) rowStarts[k+1] = rowStarts[k] + (int)S[k]->mcIndices[cc].size();
+#pragma omp parallel for
+		for( int r=0 ; r<rowStarts[blockCount] ; r++ )
+		{
+			int k = (int)( std::upper_bound( rowStarts.begin() , rowStarts.end() , r ) - rowStarts.begin() ) - 1;
+			const _SliceSystem< MatrixReal >& system = *S[k];
+			int jj = system.colorStarts.size() ? system.colorStarts[cc] + r - rowStarts[k] : system.mcIndices[cc][ r - rowStarts[k] ];
+			if( system.stencilRows && system.stencilRows[jj] )
+			{
+				T _b = B[k][jj];
+				_processStencilRow( UIntPack< FEMSigs ... >() , neighborKeys[ omp_get_thread_num() ] , _sNodes.treeNodes[ jj+offsets[k] ] , offsets[k] , ccStencil , [&]( int n , Real value ){ _b -= x[k][n] * value; } );
+				x[k][jj] += _b * D[k][jj];
+			}
+			else system.M.gsRow( jj , D[k] , B[k] , x[k] , true );
+		}
+	}
 }
 
 template< unsigned int Dim , class Real >
@@ -1501,34 +1859,78 @@ CumulativeDerivativeValues< T , Dim , PointD > FEMTree< Dim , Real >::_finerFunc
 }
 
 template< unsigned int Dim , class Real >
-template< unsigned int ... FEMSigs , typename T , unsigned int ... PointDs >
-int FEMTree< Dim , Real >::_getSliceMatrixAndProlongationConstraints( UIntPack< FEMSigs ... > , const typename BaseFEMIntegrator::template System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , SparseMatrix< Real >& matrix , Pointer( Real ) diagonalR , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , int nBegin , int nEnd , ConstPointer( T ) prolongedSolution , Pointer( T ) constraints , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , const PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& pcStencils , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
+template< typename MatrixReal , unsigned int ... FEMSigs , typename T , unsigned int ... PointDs >
+int FEMTree< Dim , Real >::_getSliceMatrixAndProlongationConstraints( UIntPack< FEMSigs ... > , const typename BaseFEMIntegrator::template System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , CSRSparseMatrix< MatrixReal >& matrix , Pointer( MatrixReal ) diagonalR , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , int nBegin , int nEnd , ConstPointer( T ) prolongedSolution , Pointer( T ) constraints , Pointer( char ) stencilRows , ConstPointer( int ) colorOrder , int orderBegin , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , const PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& pcStencils , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
 {
 	typedef UIntPack< FEMSignature< FEMSigs >::Degree ... > FEMDegrees;
 	typedef UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > OverlapSizes;
 	typedef UIntPack< ( -BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapStart ) ... > OverlapRadii;
 	size_t range = nEnd - nBegin;
-	matrix.resize( (int)range );
+	matrix.resize( range );
 	std::vector< ConstOneRingNeighborKey > neighborKeys( omp_get_max_threads() );
 	for( size_t i=0 ; i<neighborKeys.size() ; i++ ) neighborKeys[i].set( _localToGlobal( depth ) );
+	// The row (and inverted diagonal) of the i-th node
+	auto Row = [&]( int i ){ return colorOrder ? colorOrder[ i+nBegin-orderBegin ] - nBegin : i; };
+
+	// Set the row sizes, so that the rows can be assembled in place
 #pragma omp parallel for
-	for( int i=0 ; i<(int)range ; i++ ) if( _isValidFEM1Node( _sNodes.treeNodes[i+nBegin] ) )
+	for( int i=0 ; i<(int)range ; i++ )
 	{
-		ConstOneRingNeighborKey& neighborKey = neighborKeys[ omp_get_thread_num() ];
 		FEMTreeNode* node = _sNodes.treeNodes[i+nBegin];
-		// Get the matrix row size	
-		typename FEMTreeNode::template ConstNeighbors< OverlapSizes > neighbors , pNeighbors;
-		neighborKey.getNeighbors( OverlapRadii() , OverlapRadii() , node , pNeighbors , neighbors );
-		int count = _getMatrixRowSize< FEMSigs ... >( neighbors );
-		// Allocate memory for the row
-		matrix.setRowSize( i , count );
+		int rowSize = 0;
+		if( _isValidFEM1Node( node ) )
+		{
+			typename FEMTreeNode::template ConstNeighbors< OverlapSizes > neighbors;
+			neighborKeys[ omp_get_thread_num() ].getNeighbors( OverlapRadii() , OverlapRadii() , node , neighbors );
+			if( stencilRows )
+			{
+				LocalDepth d ; LocalOffset off;
+				_localDepthAndOffset( node , d , off );
+				// Interior rows that are not screened by any sample are the stencil itself, so they are not stored
+				stencilRows[i] = BaseFEMIntegrator::IsInteriorlyOverlapped( FEMDegrees() , FEMDegrees() , d , off ) && !_hasPointSamples( UIntPack< FEMSigs ... >() , neighbors , interpolationInfo ... ) ? 1 : 0;
+			}
+			if( !stencilRows || !stencilRows[i] ) rowSize = _getMatrixRowSize< FEMSigs ... >( neighbors );
+		}
+		else if( stencilRows ) stencilRows[i] = 0;
+		matrix.rowOffsets[ Row(i)+1 ] = rowSize;
+	}
+	matrix.setRowOffsetsFromSizes();
 
-		// Set the row entries
-		if( constraints ) constraints[i] = _setMatrixRowAndGetConstraintFromProlongation( UIntPack< FEMSigs ... >() , F , pNeighbors , neighbors , matrix[i] , nBegin , pcStencils , ccStencil , bsData , prolongedSolution , interpolationInfo... );
-		else                               _setMatrixRowAndGetConstraintFromProlongation( UIntPack< FEMSigs ... >() , F , pNeighbors , neighbors , matrix[i] , nBegin , pcStencils , ccStencil , bsData , prolongedSolution , interpolationInfo... );
-		if( diagonalR ) diagonalR[i] = (Real)1. / matrix[i][0].Value;
+	// Assemble the rows in place, converting the entries to the precision of the matrix as they are written
+#pragma omp parallel for
+	for( int i=0 ; i<(int)range ; i++ )
+	{
+		FEMTreeNode* node = _sNodes.treeNodes[i+nBegin];
+		if( !_isValidFEM1Node( node ) )
+		{
+			if( constraints ) constraints[i] = T();
+			continue;
+		}
+		int thread = omp_get_thread_num();
+		typename FEMTreeNode::template ConstNeighbors< OverlapSizes > neighbors , pNeighbors;
+		neighborKeys[ thread ].getNeighbors( OverlapRadii() , OverlapRadii() , node , pNeighbors , neighbors );
+		if( stencilRows && stencilRows[i] )
+		{
+			if( constraints )
+			{
+				LocalDepth d ; LocalOffset off;
+				_localDepthAndOffset( node , d , off );
+				constraints[i] = T();
+				if( d>0 && prolongedSolution ) constraints[i] = _getConstraintFromProlongedSolution( UIntPack< FEMSigs ... >() , F , neighbors , pNeighbors , node , prolongedSolution , pcStencils.data[ (int)( node - node->parent->children ) ] , bsData , interpolationInfo... );
+			}
+			if( diagonalR ) diagonalR[ Row(i) ] = (MatrixReal)( (Real)1. / (Real)ccStencil.data[ WindowIndex< OverlapSizes , OverlapRadii >::Index ] );
+		}
+		else
+		{
+			int r = Row(i);
+			typename CSRSparseMatrix< MatrixReal >::RowWriter row = matrix.rowWriter( r );
+			if( constraints ) constraints[i] = _setMatrixRowAndGetConstraintFromProlongation( UIntPack< FEMSigs ... >() , F , pNeighbors , neighbors , row , nBegin , pcStencils , ccStencil , bsData , prolongedSolution , interpolationInfo... );
+			else                               _setMatrixRowAndGetConstraintFromProlongation( UIntPack< FEMSigs ... >() , F , pNeighbors , neighbors , row , nBegin , pcStencils , ccStencil , bsData , prolongedSolution , interpolationInfo... );
+			// The entries keep their order within the row, so that the relaxations sum in the same order
+			if( colorOrder ) for( size_t e=matrix.rowOffsets[r] ; e<matrix.rowOffsets[r+1] ; e++ ) matrix.columns[e] = colorOrder[ matrix.columns[e]+nBegin-orderBegin ] - nBegin;
+			if( diagonalR ) diagonalR[r] = (MatrixReal)( (Real)1. / (Real)matrix.values[ matrix.rowOffsets[r] ] );
+		}
 	}
-	else if( constraints ) constraints[i] = T();
 #ifdef SHOW_WARNINGS
 #pragma message( "[WARNING] Why do we care if the node is not valid?" )
 #endif // SHOW_WARNINGS
@@ -1541,6 +1943,71 @@ int FEMTree< Dim , Real >::_getSliceMatrixAndProlongationConstraints( UIntPack<
 	return 1;
 }
 
+template< unsigned int Dim , class Real >
+template< typename MatrixReal , unsigned int ... FEMSigs , typename T , unsigned int ... PointDs >
+void FEMTree< Dim , Real >::_setSliceSystem( UIntPack< FEMSigs ... > , const typename BaseFEMIntegrator::template System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , int nBegin , int nEnd , ConstPointer( T ) prolongedSolution , Pointer( T ) constraints , bool matrixFree , ConstPointer( int ) colorOrder , int orderBegin , _SliceSystem< MatrixReal >& system , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , const PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& pcStencils , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
+{
+	// A valid system only needs the constraints from the prolonged solution, which change with every solve
+	if( system.valid ) _getProlongationConstraints( UIntPack< FEMSigs ... >() , F , bsData , depth , nBegin , nEnd , prolongedSolution , constraints , pcStencils , interpolationInfo ... );
+	else
+	{
+		FreePointer( system.D );
+		system.D = AllocPointer< MatrixReal >( nEnd - nBegin );
+		FreePointer( system.stencilRows );
+		if( matrixFree ) system.stencilRows = AllocPointer< char >( nEnd - nBegin );
+		_getSliceMatrixAndProlongationConstraints( UIntPack< FEMSigs ... >() , F , system.M , system.D , bsData , depth , nBegin , nEnd , prolongedSolution , constraints , system.stencilRows , colorOrder , orderBegin , ccStencil , pcStencils , interpolationInfo... );
+		for( size_t i=0 ; i<system.mcIndices.size() ; i++ ) system.mcIndices[i].clear();
+		_setMultiColorIndices( UIntPack< FEMSigs ... >() , nBegin , nEnd , system.mcIndices );
+		system.colorStarts.clear();
+		if( colorOrder )
+		{
+			system.colorStarts.resize( system.mcIndices.size()+1 );
+			system.colorStarts[0] = 0;
+			for( size_t c=0 ; c<system.mcIndices.size() ; c++ ) system.colorStarts[c+1] = system.colorStarts[c] + (int)system.mcIndices[c].size();
+		}
+		system.valid = true;
+	}
+}
+
+template< unsigned int Dim , class Real >
+template< typename T >
+void FEMTree< Dim , Real >::_permuteColorOrder( Pointer( T ) x , size_t size , ConstPointer( int ) colorOrder , int orderBegin , bool toColorOrder )
+{
+	Pointer( T ) _x = AllocPointer< T >( size );
+#pragma omp parallel for
+	for( long long i=0 ; i<(long long)size ; i++ ) _x[i] = x[i];
+	if( toColorOrder )
+#pragma omp parallel for
+		for( long long i=0 ; i<(long long)size ; i++ ) x[ colorOrder[i]-orderBegin ] = _x[i];
+	else
+#pragma omp parallel for
+		for( long long i=0 ; i<(long long)size ; i++ ) x[i] = _x[ colorOrder[i]-orderBegin ];
+	FreePointer( _x );
+}
+
+template< unsigned int Dim , class Real >
+template< unsigned int ... FEMSigs , typename T , unsigned int ... PointDs >
+void FEMTree< Dim , Real >::_getProlongationConstraints( UIntPack< FEMSigs ... > , const typename BaseFEMIntegrator::template System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , int nBegin , int nEnd , ConstPointer( T ) prolongedSolution , Pointer( T ) constraints , const PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& pcStencils , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
+{
+	typedef UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > OverlapSizes;
+	typedef UIntPack< ( -BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapStart ) ... > OverlapRadii;
+	std::vector< ConstOneRingNeighborKey > neighborKeys( omp_get_max_threads() );
+	for( size_t i=0 ; i<neighborKeys.size() ; i++ ) neighborKeys[i].set( _localToGlobal( depth ) );
+#pragma omp parallel for
+	for( int i=nBegin ; i<nEnd ; i++ )
+	{
+		const FEMTreeNode* node = _sNodes.treeNodes[i];
+		constraints[i-nBegin] = T();
+		if( !prolongedSolution || !_isValidFEM1Node( node ) ) continue;
+		LocalDepth d ; LocalOffset off;
+		_localDepthAndOffset( node , d , off );
+		if( d<=0 ) continue;
+		typename FEMTreeNode::template ConstNeighbors< OverlapSizes > neighbors , pNeighbors;
+		neighborKeys[ omp_get_thread_num() ].getNeighbors( OverlapRadii() , OverlapRadii() , node , pNeighbors , neighbors );
+		constraints[i-nBegin] = _getConstraintFromProlongedSolution( UIntPack< FEMSigs ... >() , F , neighbors , pNeighbors , node , prolongedSolution , pcStencils.data[ (int)( node - node->parent->children ) ] , bsData , interpolationInfo... );
+	}
+}
+
 template< unsigned int Dim , class Real >
 template< typename T , unsigned int ... PointDs , unsigned int ... FEMSigs >
 SparseMatrix< Real > FEMTree< Dim , Real >::systemMatrix( UIntPack< FEMSigs ... > , typename BaseFEMIntegrator::template System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , LocalDepth depth , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
@@ -2370,10 +2837,15 @@ void FEMTree< Dim , Real >::solveSystem( UIntPack< FEMSigs ... > , typename Base
 	PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > > bsData( sizeof...(PointDs)==0 ? 0 : maxSolveDepth );
 
 	maxSolveDepth = std::min< LocalDepth >( maxSolveDepth , _maxDepth );
+	// The deepest depths can be empty after finalization, so the residual is checked at the finest depth that has nodes
+	LocalDepth finestDepth = maxSolveDepth;
+	while( finestDepth>baseDepth && !_sNodesSize( finestDepth ) ) finestDepth--;
+	if( solverInfo.pcgIters>0 && finestDepth==baseDepth ) fprintf( stderr , "[WARNING] FEMTree::solveSystem: Finest depth with nodes is the base depth, conjugate-gradients will not be used: %d\n" , finestDepth );
 
 	bool clearSolution = solution.size()!=_sNodesEnd( _maxDepth );
 	if( clearSolution ) solution = initDenseNodeData< T >( UIntPack< FEMSigs ... >() ) , clearSolution = true;
 	bool simpleSolve = clearSolution && solverInfo.vCycles==1 && solverInfo.cascadic;
+	bool checkResidual = solverInfo.residualTolerance>0;
 
 	// The initial estimate of the solution (may be empty or may come in with an initial guess)
 	Pointer( T ) _solution = solution();
@@ -2393,14 +2865,14 @@ void FEMTree< Dim , Real >::solveSystem( UIntPack< FEMSigs ... > , typename Base
 	Pointer( T ) _prolongedSolution = AllocPointer< T >( _sNodesEnd( _maxDepth-1 ) );
 
 	memset( _prolongedSolution , 0 , sizeof(T) * _sNodesEnd( _maxDepth-1 ) );
-	if( !( clearSolution && solverInfo.vCycles==1 && solverInfo.cascadic ) )
+	if( !simpleSolve )
 	{
 		_restrictedConstraints = AllocPointer< T >( _sNodesEnd( _maxDepth-1 ) );
 		memset( _restrictedConstraints , 0 , sizeof(T) * _sNodesEnd( _maxDepth-1 ) );
 	}
 
 	Pointer( double ) _bNorm2 = NullPointer( double );
-	if( solverInfo.showGlobalResidual!=SHOW_GLOBAL_RESIDUAL_NONE )
+	if( solverInfo.showGlobalResidual!=SHOW_GLOBAL_RESIDUAL_NONE || checkResidual )
 	{
 		_bNorm2 = AllocPointer< double >( _maxDepth+1 );
 		memset( _bNorm2 , 0 , sizeof(double) * ( _maxDepth+1 ) );
@@ -2445,8 +2917,17 @@ void FEMTree< Dim , Real >::solveSystem( UIntPack< FEMSigs ... > , typename Base
 #pragma omp parallel for
 			for( int i=_sNodesBegin(depth) ; i<_sNodesEnd(depth) ; i++ ) _residualConstraints[i] -= _restrictedConstraints[i];
 	};
-	auto OutputSolverStats = [&] ( int cycle , int depth , const _SolverStats& sStats , bool showResidual , int actualIters )
+	auto OutputSolverStats = [&] ( int cycle , int depth , bool restriction , const _SolverStats& sStats , bool showResidual , int actualIters )
 	{
+		if( solverInfo.telemetry )
+		{
+			const char* solver = depth==baseDepth ? "MG" : ( depth<=solverInfo.cgDepth ? "CG" : ( !restriction && depth==finestDepth && solverInfo.pcgIters>0 ? "PCG" : "GS" ) );
+			fprintf( solverInfo.telemetry , "{\"solve\":%d,\"cycle\":%d,\"phase\":\"%s\",\"depth\":%d,\"maxDepth\":%d,\"solver\":\"%s\",\"iters\":%d,\"femNodes\":%llu,\"matrixRows\":%llu,\"nonzeros\":%llu,\"constraintTime\":%g,\"systemTime\":%g,\"solveTime\":%g,\"iterTime\":%g,\"bNorm\":%g,\"inResidual\":%g,\"outResidual\":%g,\"bytes\":%.0f,\"memoryMB\":%g}\n" ,
+				solverInfo.solveId , cycle , restriction ? "restriction" : "prolongation" , depth , maxSolveDepth , solver , actualIters , (unsigned long long)validFEMNodes( UIntPack< FEMSigs ... >() , depth ) , (unsigned long long)sStats.rows , (unsigned long long)sStats.entries ,
+				sStats.constraintUpdateTime , sStats.systemTime , sStats.solveTime , actualIters>0 ? sStats.solveTime / actualIters : 0. ,
+				sqrt( sStats.bNorm2 ) , sqrt( sStats.inRNorm2 ) , sqrt( sStats.outRNorm2 ) , sStats.iterationBytes * actualIters , _LocalMemoryUsage );
+			fflush( solverInfo.telemetry );
+		}
 		if( solverInfo.verbose )
 		{
 			int femNodes = (int)validFEMNodes( UIntPack< FEMSigs ... >() , depth );
@@ -2461,7 +2942,7 @@ void FEMTree< Dim , Real >::solveSystem( UIntPack< FEMSigs ... > , typename Base
 		if( solverInfo.showResidual && showResidual )
 		{
 			for( int d=baseDepth ; d<depth ; d++ ) printf( "  " );
-			printf( "%s: %.4e -> %.4e -> %.4e (%.1e) [%d]\n" , depth<=solverInfo.cgDepth ? "CG" : "GS" , sqrt( sStats.bNorm2 ) , sqrt( sStats.inRNorm2 ) , sqrt( sStats.outRNorm2 ) , sqrt( sStats.outRNorm2  / sStats.inRNorm2 ) , actualIters );
+			printf( "%s: %.4e -> %.4e -> %.4e (%.1e) [%d]\n" , depth<=solverInfo.cgDepth ? "CG" : ( !restriction && depth==finestDepth && solverInfo.pcgIters>0 ? "PCG" : "GS" ) , sqrt( sStats.bNorm2 ) , sqrt( sStats.inRNorm2 ) , sqrt( sStats.outRNorm2 ) , sqrt( sStats.outRNorm2  / sStats.inRNorm2 ) , actualIters );
 		}
 	};
 
@@ -2512,19 +2993,21 @@ void FEMTree< Dim , Real >::solveSystem( UIntPack< FEMSigs ... > , typename Base
 				SetResidualConstraints( d , interpolationInfo... );
 				sStats.constraintUpdateTime += Time()-t;
 				// In the restriction phase we do not solve at the coarsest resolution since we will do so in the prolongation phase
-				if( d==baseDepth ) _solveRegularMG( UIntPack< FEMSigs ... >() , F , bsData , d , _solution , d==_maxDepth ? _constraints : _residualConstraints , Dot , solverInfo.baseVCycles , iters , sStats , solverInfo.showResidual , solverInfo.cgAccuracy , interpolationInfo... );
+				bool computeNorms = solverInfo.showResidual || solverInfo.telemetry;
+				if( d==baseDepth ) _solveRegularMG( UIntPack< FEMSigs ... >() , F , bsData , d , _solution , d==_maxDepth ? _constraints : _residualConstraints , Dot , solverInfo.baseVCycles , iters , sStats , computeNorms , solverInfo.cgAccuracy , solverInfo.systemCache , interpolationInfo... ) , actualIters = solverInfo.baseVCycles;
 				else
 				{
-					if( d>solverInfo.cgDepth ) actualIters = _solveSystemGS( UIntPack< FEMSigs ... >() , Dim!=1 , F , bsData , d , _solution , ( ConstPointer( T ) )_prolongedSolution , d==_maxDepth ? _constraints : _residualConstraints , Dot , iters , coarseToFine , solverInfo.sliceBlockSize , sorWeights , sStats , solverInfo.showResidual ,                         interpolationInfo... );
-					else                       actualIters = _solveSystemCG( UIntPack< FEMSigs ... >() ,          F , bsData , d , _solution , ( ConstPointer( T ) )_prolongedSolution , d==_maxDepth ? _constraints : _residualConstraints , Dot , iters , coarseToFine ,                                          sStats , solverInfo.showResidual , solverInfo.cgAccuracy , interpolationInfo... );
+					if( d>solverInfo.cgDepth ) actualIters = _solveSystemGS( UIntPack< FEMSigs ... >() , Dim!=1 , F , bsData , d , _solution , ( ConstPointer( T ) )_prolongedSolution , d==_maxDepth ? _constraints : _residualConstraints , Dot , iters , coarseToFine , solverInfo.sliceBlockSize , solverInfo.concurrentSliceBlocks , sorWeights , solverInfo.matrixFree , solverInfo.mixedPrecision , solverInfo.systemCache , sStats , computeNorms ,                         interpolationInfo... );
+					else                       actualIters = _solveSystemCG( UIntPack< FEMSigs ... >() ,          F , bsData , d , _solution , ( ConstPointer( T ) )_prolongedSolution , d==_maxDepth ? _constraints : _residualConstraints , Dot , iters , coarseToFine ,                                          sStats , computeNorms , solverInfo.cgAccuracy , interpolationInfo... );
 				}
 				t = Time();
 				UpdateRestriction( d , interpolationInfo... );
 				sStats.constraintUpdateTime += Time()-t;
-				OutputSolverStats( v , d , sStats , showResidual , actualIters );
+				OutputSolverStats( v , d , true , sStats , showResidual , actualIters );
 			}
 		}
 	};
+	double finestRNorm2 = 0;
 	auto SolveProlongation = [&]( int v , int depth , InterpolationInfo< T , PointDs >* ... interpolationInfo )
 	{
 		sorWeights.sorFunction = solverInfo.sorProlongationFunction;
@@ -2538,16 +3021,19 @@ void FEMTree< Dim , Real >::solveSystem( UIntPack< FEMSigs ... > , typename Base
 			F.init( d );
 			SetResidualConstraints( d , interpolationInfo... );
 			sStats.constraintUpdateTime += Time()-t;
-			if( d==baseDepth ) _solveRegularMG( UIntPack< FEMSigs ... >() , F , bsData , d , _solution , d==_maxDepth ? _constraints : _residualConstraints , Dot , solverInfo.baseVCycles , iters , sStats , solverInfo.showResidual , solverInfo.cgAccuracy , interpolationInfo... );
+			bool computeNorms = solverInfo.showResidual || solverInfo.telemetry || ( checkResidual && d==finestDepth );
+			if( d==baseDepth ) _solveRegularMG( UIntPack< FEMSigs ... >() , F , bsData , d , _solution , d==_maxDepth ? _constraints : _residualConstraints , Dot , solverInfo.baseVCycles , iters , sStats , computeNorms , solverInfo.cgAccuracy , solverInfo.systemCache , interpolationInfo... ) , actualIters = solverInfo.baseVCycles;
+			else if( d==finestDepth && solverInfo.pcgIters>0 ) actualIters = _solveSystemPCG( UIntPack< FEMSigs ... >() , F , bsData , d , _solution , ( ConstPointer( T ) )_prolongedSolution , d==_maxDepth ? _constraints : _residualConstraints , Dot , solverInfo.pcgIters , sStats , computeNorms , solverInfo.residualTolerance , solverInfo.systemCache , interpolationInfo... );
 			else
 			{
-				if( d>solverInfo.cgDepth ) actualIters = _solveSystemGS( UIntPack< FEMSigs ... >() , Dim!=1 , F , bsData , d , _solution , ( ConstPointer( T ) )_prolongedSolution , d==_maxDepth ? _constraints : _residualConstraints , Dot , iters , coarseToFine , solverInfo.sliceBlockSize , sorWeights , sStats , solverInfo.showResidual , interpolationInfo... );
-				else                       actualIters = _solveSystemCG( UIntPack< FEMSigs ... >() ,          F , bsData , d , _solution , ( ConstPointer( T ) )_prolongedSolution , d==_maxDepth ? _constraints : _residualConstraints , Dot , iters , coarseToFine , sStats , solverInfo.showResidual , solverInfo.cgAccuracy , interpolationInfo... );
+				if( d>solverInfo.cgDepth ) actualIters = _solveSystemGS( UIntPack< FEMSigs ... >() , Dim!=1 , F , bsData , d , _solution , ( ConstPointer( T ) )_prolongedSolution , d==_maxDepth ? _constraints : _residualConstraints , Dot , iters , coarseToFine , solverInfo.sliceBlockSize , solverInfo.concurrentSliceBlocks , sorWeights , solverInfo.matrixFree , solverInfo.mixedPrecision , solverInfo.systemCache , sStats , computeNorms , interpolationInfo... );
+				else                       actualIters = _solveSystemCG( UIntPack< FEMSigs ... >() ,          F , bsData , d , _solution , ( ConstPointer( T ) )_prolongedSolution , d==_maxDepth ? _constraints : _residualConstraints , Dot , iters , coarseToFine , sStats , computeNorms , solverInfo.cgAccuracy , interpolationInfo... );
 			}
+			if( d==finestDepth ) finestRNorm2 = sStats.outRNorm2;
 			t = Time();
 			UpdateProlongation( d );
 			sStats.constraintUpdateTime += Time()-t;
-			OutputSolverStats( v , d , sStats , showResidual , actualIters );
+			OutputSolverStats( v , d , false , sStats , showResidual , actualIters );
 		}
 	};
 
@@ -2571,6 +3057,8 @@ void FEMTree< Dim , Real >::solveSystem( UIntPack< FEMSigs ... > , typename Base
 			SolveRestriction ( v , maxSolveDepth , interpolationInfo ... );
 			SolveProlongation( v , maxSolveDepth , interpolationInfo ... );
 		}
+		// Nothing is relaxed after the finest depth with nodes in the prolongation phase, so its residual is current
+		double outRNorm2 = finestRNorm2;
 		if( solverInfo.showGlobalResidual==SHOW_GLOBAL_RESIDUAL_ALL || ( solverInfo.showGlobalResidual==SHOW_GLOBAL_RESIDUAL_LAST && v==solverInfo.vCycles-1 ) )
 		{
 			bool coarseToFine = false;
@@ -2579,7 +3067,7 @@ void FEMTree< Dim , Real >::solveSystem( UIntPack< FEMSigs ... > , typename Base
 			{
 				F.init( d );
 				SetResidualConstraints( d , interpolationInfo... );
-				_solveSystemGS( UIntPack< FEMSigs ... >() , Dim!=1 , F , bsData , d , _solution , ( ConstPointer( T ) )_prolongedSolution , d==_maxDepth ? _constraints : _residualConstraints , Dot , 0 , coarseToFine , solverInfo.sliceBlockSize , TrivialSORWeights() , sStats , true , interpolationInfo... );
+				_solveSystemGS( UIntPack< FEMSigs ... >() , Dim!=1 , F , bsData , d , _solution , ( ConstPointer( T ) )_prolongedSolution , d==_maxDepth ? _constraints : _residualConstraints , Dot , 0 , coarseToFine , solverInfo.sliceBlockSize , solverInfo.concurrentSliceBlocks , TrivialSORWeights() , solverInfo.matrixFree , solverInfo.mixedPrecision , solverInfo.systemCache , sStats , true , interpolationInfo... );
 				UpdateRestriction( d , interpolationInfo... );
 				rNorms[d] = sqrt( sStats.outRNorm2 / _bNorm2[d] );
 			}
@@ -2587,6 +3075,12 @@ void FEMTree< Dim , Real >::solveSystem( UIntPack< FEMSigs ... > , typename Base
 			for( int d=baseDepth ; d<=maxSolveDepth ; d++ ) printf( "\t%.4e" , rNorms[d] );
 			printf( "\n" );
 		}
+		if( checkResidual && _bNorm2[finestDepth]>0 )
+		{
+			double rNorm = sqrt( outRNorm2 / _bNorm2[finestDepth] );
+			if( solverInfo.verbose ) printf( "Cycle[%d] Residual: %.4e\n" , v , rNorm );
+			if( rNorm<solverInfo.residualTolerance ) break;
+		}
 	}
 	MemoryUsage();
 
@@ -2596,6 +3090,30 @@ void FEMTree< Dim , Real >::solveSystem( UIntPack< FEMSigs ... > , typename Base
 	FreePointer( _bNorm2 );
 }
 
+template< unsigned int Dim , class Real >
+template< unsigned int K , unsigned int ... FEMSigs , unsigned int ... PointDs >
+void FEMTree< Dim , Real >::solveSystems( UIntPack< FEMSigs ... > , typename BaseFEMIntegrator::template System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const DenseNodeData< Real , UIntPack< FEMSigs ... > >* constraints , DenseNodeData< Real , UIntPack< FEMSigs ... > >* solutions , LocalDepth maxSolveDepth , const typename FEMTree< Dim , Real >::SolverInfo& solverInfo , InterpolationInfo< Point< Real , K > , PointDs >* ... interpolationInfo ) const
+{
+	typedef Point< Real , K > T;
+	// Interleave the right-hand sides (and initial guesses) so that a relaxation updates all of them with one pass over a matrix row
+	DenseNodeData< T , UIntPack< FEMSigs ... > > _constraints = initDenseNodeData< T >( UIntPack< FEMSigs ... >() ) , _solution;
+	bool warmStart = true;
+	for( unsigned int k=0 ; k<K ; k++ ) warmStart &= solutions[k].size()==_constraints.size();
+	if( warmStart ) _solution = initDenseNodeData< T >( UIntPack< FEMSigs ... >() );
+#pragma omp parallel for
+	for( int i=0 ; i<(int)_constraints.size() ; i++ ) for( unsigned int k=0 ; k<K ; k++ )
+	{
+		_constraints[i][k] = constraints[k][i];
+		if( warmStart ) _solution[i][k] = solutions[k][i];
+	}
+
+	solveSystem( UIntPack< FEMSigs ... >() , F , _constraints , _solution , []( T v , T w ){ return T::Dot( v , w ); } , maxSolveDepth , solverInfo , interpolationInfo ... );
+
+	for( unsigned int k=0 ; k<K ; k++ ) if( solutions[k].size()!=_solution.size() ) solutions[k] = initDenseNodeData( UIntPack< FEMSigs ... >() );
+#pragma omp parallel for
+	for( int i=0 ; i<(int)_solution.size() ; i++ ) for( unsigned int k=0 ; k<K ; k++ ) solutions[k][i] = _solution[i][k];
+}
+
 template< unsigned int Dim , class Real >
 template< unsigned int ... FEMSigs >
 DenseNodeData< Real , UIntPack< FEMSigs ... > > FEMTree< Dim , Real >::initDenseNodeData( UIntPack< FEMSigs ... > ) const
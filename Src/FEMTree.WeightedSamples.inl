@@ -54,8 +54,6 @@ void FEMTree< Dim , Real >::_addWeightContribution( DensityEstimator< WeightDegr
 	double values[ Dim ][ BSplineSupportSizes< WeightDegree >::SupportSize ];
 	typename FEMTreeNode::template Neighbors< IsotropicUIntPack< Dim , BSplineSupportSizes< WeightDegree >::SupportSize > >& neighbors = weightKey.template getNeighbors< true >( node , nodeAllocator , _NodeInitializer( *this ) );
 
-	densityWeights.reserve( nodeCount() );
-
 	Point< Real , Dim > start;
 	Real w;
 	_startAndWidth( node , start , w );
@@ -168,8 +166,39 @@ void FEMTree< Dim , Real >::_splatPointData( FEMTreeNode* node , Point< Real , D
 	);
 }
 template< unsigned int Dim , class Real >
+template< class V , unsigned int ... DataSigs >
+void FEMTree< Dim , Real >::_resplatPointData( const FEMTreeNode* node , Point< Real , Dim > position , V v , SparseNodeData< V , UIntPack< DataSigs ... > >& dataInfo , ConstPointSupportKey< UIntPack< FEMSignature< DataSigs >::Degree ... > >& dataKey  , bool atomic )
+{
+	typedef UIntPack< BSplineSupportSizes< FEMSignature< DataSigs >::Degree >::SupportSize ... > SupportSizes;
+	double values[ Dim ][ SupportSizes::Max() ];
+	typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineSupportSizes< FEMSignature< DataSigs >::Degree >::SupportSize ... > >& neighbors = dataKey.getNeighbors( node );
+
+	Point< Real , Dim > start;
+	Real w;
+	_startAndWidth( node , start , w );
+
+	__SetBSplineComponentValues< Real , FEMSignature< DataSigs >::Degree ... >( &position[0] , &start[0] , w , &values[0][0] , SupportSizes::Max() );
+	double scratch[Dim+1];
+	scratch[0] = 1;
+	WindowLoop< Dim >::Run
+	(
+		ZeroUIntPack< Dim >() , UIntPack< BSplineSupportSizes< FEMSignature< DataSigs >::Degree >::SupportSize ... >() ,
+		[&]( int d , int i ){ scratch[d+1] = scratch[d] * values[d][i]; } ,
+		[&]( const FEMTreeNode* node )
+		{
+			V* data = node ? dataInfo( node ) : NULL;
+			if( data )
+			{
+				if( atomic ) AddAtomic( *data , v * (Real)scratch[Dim] );
+				else *data += v * (Real)scratch[Dim];
+			}
+		} ,
+		neighbors.neighbors()
+	);
+}
+template< unsigned int Dim , class Real >
 template< bool CreateNodes , unsigned int WeightDegree , class V , unsigned int ... DataSigs >
-Real FEMTree< Dim , Real >::_splatPointData( const DensityEstimator< WeightDegree >& densityWeights , Point< Real , Dim > position , V v , SparseNodeData< V , UIntPack< DataSigs ... > >& dataInfo , PointSupportKey< IsotropicUIntPack< Dim , WeightDegree > >& weightKey , PointSupportKey< UIntPack< FEMSignature< DataSigs >::Degree ... > >& dataKey , LocalDepth minDepth , LocalDepth maxDepth , int dim , Real depthBias )
+Real FEMTree< Dim , Real >::_splatPointData( const DensityEstimator< WeightDegree >& densityWeights , Point< Real , Dim > position , V v , SparseNodeData< V , UIntPack< DataSigs ... > >& dataInfo , PointSupportKey< IsotropicUIntPack< Dim , WeightDegree > >& weightKey , PointSupportKey< UIntPack< FEMSignature< DataSigs >::Degree ... > >& dataKey , LocalDepth minDepth , LocalDepth maxDepth , int dim , Real depthBias , SampleSplat* splat )
 {
 	double dx;
 	V _v;
@@ -206,9 +235,10 @@ Real FEMTree< Dim , Real >::_splatPointData( const DensityEstimator< WeightDegre
 	while( _localDepth( temp )>topDepth ) temp=temp->parent;
 	while( _localDepth( temp )<topDepth )
 	{
-		if( !temp->children ) temp->initChildren( nodeAllocator , _NodeInitializer( *this ) );
+		FEMTreeNode* children = temp->acquireChildren();
+		if( !children ) temp->template initChildren< true >( nodeAllocator , _NodeInitializer( *this ) ) , children = temp->acquireChildren();
 		int cIndex = FEMTreeNode::ChildIndex( myCenter , position );
-		temp = &temp->children[cIndex];
+		temp = children + cIndex;
 		myWidth/=2;
 		for( int d=0 ; d<Dim ; d++ )
 			if( (cIndex>>d) & 1 ) myCenter[d] += myWidth/2;
@@ -216,6 +246,7 @@ Real FEMTree< Dim , Real >::_splatPointData( const DensityEstimator< WeightDegre
 	}
 	width = 1.0 / ( 1<<_localDepth( temp ) );
 	_v = v * weight / Real( pow( width , dim ) ) * Real( dx );
+	if( splat ) splat->nodes[0] = temp , splat->scales[0] = weight / Real( pow( width , dim ) ) * Real( dx );
 	_splatPointData< CreateNodes , V ,  DataSigs ... >( temp , position , _v , dataInfo , dataKey );
 	if( fabs(1.0-dx) > 1e-6 )
 	{
@@ -224,6 +255,7 @@ Real FEMTree< Dim , Real >::_splatPointData( const DensityEstimator< WeightDegre
 		width = 1.0 / ( 1<<_localDepth( temp ) );
 
 		_v = v * weight / Real( pow( width , dim ) ) * Real( dx );
+		if( splat ) splat->nodes[1] = temp , splat->scales[1] = weight / Real( pow( width , dim ) ) * Real( dx );
 		_splatPointData< CreateNodes , V , DataSigs ... >( temp , position , _v , dataInfo , dataKey );
 	}
 	return weight;
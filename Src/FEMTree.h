@@ -57,6 +57,7 @@ DAMAGE.
 #include "RegularTree.h"
 #include "SparseMatrix.h"
 #include <functional>
+#include <tuple>
 
 
 template< unsigned int Dim , class Real > class FEMTree;
@@ -1312,6 +1313,25 @@ public:
 
 	typedef NodeAndPointSample< Dim , Real > PointSample;
 
+	// The (at most two) nodes into which the density-adaptive splatting distributes a sample, together with the scale applied to the sample's value at each
+	struct SampleSplat
+	{
+		FEMTreeNode* nodes[2];
+		Real scales[2];
+		SampleSplat( void ){ nodes[0] = nodes[1] = NULL , scales[0] = scales[1] = (Real)0; }
+	};
+
+	// The recorded splats grouped by the node they go into, with the nodes grouped by color.
+	// Nodes of the same color have disjoint supports, so their splats can be accumulated concurrently without atomics.
+	struct SplatSchedule
+	{
+		std::vector< size_t > colorStarts;		// the nodes of the c-th color are nodes[ colorStarts[c] ... colorStarts[c+1]-1 ]
+		std::vector< size_t > nodeStarts;		// the splats into nodes[i] are splats[ nodeStarts[i] ... nodeStarts[i+1]-1 ]
+		std::vector< const FEMTreeNode* > nodes;
+		std::vector< int > splats;				// 2*s+j for the j-th splat of the s-th sample
+		bool empty( void ) const { return nodes.empty(); }
+	};
+
 	typedef typename FEMTreeNode::template      NeighborKey< IsotropicUIntPack< Dim , 1 > , IsotropicUIntPack< Dim , 1 > >      OneRingNeighborKey;
 	typedef typename FEMTreeNode::template ConstNeighborKey< IsotropicUIntPack< Dim , 1 > , IsotropicUIntPack< Dim , 1 > > ConstOneRingNeighborKey;
 	typedef typename FEMTreeNode::template      Neighbors< IsotropicUIntPack< Dim , 3 > >      OneRingNeighbors;
@@ -1864,12 +1884,122 @@ public:
 	template< unsigned int ... FEMSigs > void setMultiColorIndices( UIntPack< FEMSigs ... > , int depth , std::vector< std::vector< int > >& indices ) const;
 protected:
 	template< unsigned int ... FEMSigs > void _setMultiColorIndices( UIntPack< FEMSigs ... > , int start , int end , std::vector< std::vector< int > >& indices ) const;
+	// Sets the position of every node in [start,end) when the nodes of each color are stored contiguously, in their original order, followed by the nodes that are not relaxed
+	template< unsigned int ... FEMSigs > void _setColorOrder( UIntPack< FEMSigs ... > , int start , int end , Pointer( int ) order ) const;
 
 	struct _SolverStats
 	{
 		double constraintUpdateTime , systemTime , solveTime;
 		double bNorm2 , inRNorm2 , outRNorm2;
+		// The size of the system solved and an estimate of the bytes an iteration moves
+		size_t rows , entries;
+		double iterationBytes;
+		void clearSystem( void ){ rows = entries = 0 , iterationBytes = 0; }
+		// Adds rows of a compressed-row matrix, counting a sweep as reading the matrix, its diagonal and the constraints and reading and writing the solution
+		template< typename MatrixReal , typename T >
+		void addSystem( size_t r , size_t e , int sweeps=1 )
+		{
+			rows += r , entries += e;
+			iterationBytes += sweeps * ( (double)e * ( sizeof( MatrixReal ) + sizeof( int ) ) + (double)r * ( sizeof( size_t ) + sizeof( MatrixReal ) + 3 * sizeof( T ) ) );
+		}
+	};
+	// The matrix of a block of slices of a Gauss-Seidel solve, with its inverted diagonal (before the SOR weights are applied)
+	template< typename MatrixReal >
+	struct _SliceSystem
+	{
+		bool valid;
+		CSRSparseMatrix< MatrixReal > M;
+		Pointer( MatrixReal ) D;
+		Pointer( char ) stencilRows;
+		std::vector< std::vector< int > > mcIndices;
+		// If set, the rows (and columns) are stored in color order and the rows of the c-th color are those in [ colorStarts[c] , colorStarts[c+1] )
+		std::vector< int > colorStarts;
+		_SliceSystem( void ) : valid(false) , D( NullPointer( MatrixReal ) ) , stencilRows( NullPointer( char ) ){ }
+		~_SliceSystem( void ){ FreePointer( D ) ; FreePointer( stencilRows ); }
+	};
+	// The slice systems of a depth, together with the blocking for which they were set
+	template< typename MatrixReal >
+	struct _DepthSliceSystems
+	{
+		int blocks;
+		unsigned int sliceBlockSize;
+		bool matrixFree;
+		Pointer( _SliceSystem< MatrixReal > ) systems;
+		// The color order in which the systems are stored, if they are
+		Pointer( int ) colorOrder;
+		_DepthSliceSystems( void ) : blocks(0) , sliceBlockSize(0) , matrixFree(false) , systems( NullPointer( _SliceSystem< MatrixReal > ) ) , colorOrder( NullPointer( int ) ){ }
 	};
+	// A Galerkin multigrid hierarchy: the system of a depth and its restrictions R * M * P to all the coarser depths.
+	// The regular multigrid solver uses one at the base depth, and the conjugate-gradients solve is preconditioned with one at the depth it solves.
+	struct _MGHierarchy
+	{
+		LocalDepth depth;
+		std::vector< CSRSparseMatrix< Real > > P , R , M;
+		std::vector< Pointer( Real ) > D;
+		std::vector< std::vector< std::vector< int > > > multiColorIndices;
+		_MGHierarchy( void ) : depth(-1){ }
+		~_MGHierarchy( void ){ clear(); }
+		void clear( void )
+		{
+			for( size_t d=0 ; d<D.size() ; d++ ) FreePointer( D[d] );
+			P.clear() , R.clear() , M.clear() , D.clear() , multiColorIndices.clear();
+			depth = -1;
+		}
+	};
+public:
+	// Keeps the systems built by the solver alive so that subsequent solves do not rebuild them.
+	// A cache may only be shared by solves with the same tree, system and interpolation constraints (the right-hand sides can differ).
+	// The multigrid hierarchies of the coarse solve and of the conjugate-gradients solve are always cached.
+	// If sliceSystems is set, so are the Gauss-Seidel matrices of all the finer depths, which takes as much memory as the full system.
+	struct SystemCache
+	{
+		bool sliceSystems;
+
+		SystemCache( bool sliceSystems=false ) : sliceSystems(sliceSystems){ }
+		~SystemCache( void ){ clear(); }
+		void clear( void )
+		{
+			regularMG.clear() , pcgMG.clear();
+			_clear( std::get< 0 >( _slices ) ) , _clear( std::get< 1 >( _slices ) );
+		}
+
+		_MGHierarchy regularMG , pcgMG;
+
+		// Returns the (possibly not yet valid) systems of the blocks at the depth, discarding those cached with a different blocking
+		template< typename MatrixReal >
+		Pointer( _SliceSystem< MatrixReal > ) slices( LocalDepth depth , int blocks , unsigned int sliceBlockSize , bool matrixFree )
+		{
+			std::vector< _DepthSliceSystems< MatrixReal > >& depthSlices = std::get< std::is_same< MatrixReal , Real >::value ? 0 : 1 >( _slices );
+			if( depthSlices.size()<=(size_t)depth ) depthSlices.resize( depth+1 );
+			_DepthSliceSystems< MatrixReal >& s = depthSlices[depth];
+			if( s.blocks!=blocks || s.sliceBlockSize!=sliceBlockSize || s.matrixFree!=matrixFree )
+			{
+				DeletePointer( s.systems );
+				FreePointer( s.colorOrder );
+				s.systems = NewPointer< _SliceSystem< MatrixReal > >( blocks );
+				s.blocks = blocks , s.sliceBlockSize = sliceBlockSize , s.matrixFree = matrixFree;
+			}
+			return s.systems;
+		}
+		// The color order of the nodes of the depth in which the systems returned by slices are stored (null until it is set)
+		template< typename MatrixReal >
+		Pointer( int )& colorOrder( LocalDepth depth ){ return std::get< std::is_same< MatrixReal , Real >::value ? 0 : 1 >( _slices )[depth].colorOrder; }
+	protected:
+		std::tuple< std::vector< _DepthSliceSystems< Real > > , std::vector< _DepthSliceSystems< float > > > _slices;
+		SystemCache( const SystemCache& ){ }
+		SystemCache& operator = ( const SystemCache& ){ return *this; }
+		template< typename MatrixReal >
+		static void _clear( std::vector< _DepthSliceSystems< MatrixReal > >& depthSlices )
+		{
+			for( size_t d=0 ; d<depthSlices.size() ; d++ )
+			{
+				DeletePointer( depthSlices[d].systems );
+				FreePointer( depthSlices[d].colorOrder );
+			}
+			depthSlices.clear();
+		}
+	};
+protected:
 	template< unsigned int ... FEMSigs , typename T , unsigned int PointD , unsigned int ... PointDs >
 	typename std::enable_if< (sizeof...(PointDs)!=0) >::type _addPointValues( UIntPack< FEMSigs ... > , StaticWindow< Real , UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& pointValues , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , const InterpolationInfo< T , PointD >* iInfo , const InterpolationInfo< T , PointDs >* ... iInfos ) const
 	{
@@ -1880,6 +2010,17 @@ protected:
 	template< unsigned int ... FEMSigs , typename T , unsigned int PointD >
 	void _addPointValues( UIntPack< FEMSigs ... > , StaticWindow< Real , UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& pointValues , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , const InterpolationInfo< T , PointD >* interpolationInfo ) const;
 
+	// Returns true if a sample lies in the support of the node at the center of the neighbors
+	template< unsigned int ... FEMSigs , typename T , unsigned int PointD , unsigned int ... PointDs >
+	typename std::enable_if< (sizeof...(PointDs)!=0) , bool >::type _hasPointSamples( UIntPack< FEMSigs ... > , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors , const InterpolationInfo< T , PointD >* iInfo , const InterpolationInfo< T , PointDs >* ... iInfos ) const
+	{
+		return _hasPointSamples( UIntPack< FEMSigs ... >() , neighbors , iInfo ) || _hasPointSamples( UIntPack< FEMSigs ... >() , neighbors , iInfos... );
+	}
+	template< unsigned int ... FEMSigs >
+	bool _hasPointSamples( UIntPack< FEMSigs ... > , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors ) const { return false; }
+	template< unsigned int ... FEMSigs , typename T , unsigned int PointD >
+	bool _hasPointSamples( UIntPack< FEMSigs ... > , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors , const InterpolationInfo< T , PointD >* interpolationInfo ) const;
+
 	template< unsigned int ... FEMSigs , typename T , unsigned int PointD , unsigned int ... PointDs >
 	typename std::enable_if< (sizeof...(PointDs)>1) >::type _addProlongedPointValues( UIntPack< FEMSigs ... > , WindowSlice< Real , UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > > pointValues , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& pNeighbors , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , const InterpolationInfo< T , PointD >* iInfo , const InterpolationInfo< T , PointDs >* ... iInfos ) const
 	{
@@ -1935,8 +2076,23 @@ protected:
 	int _getProlongedMatrixRowSize( const FEMTreeNode* node , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& pNeighbors ) const;
 	template< unsigned int ... FEMSigs >
 	int _getMatrixRowSize( const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors ) const;
-	template< typename T , unsigned int ... PointDs , unsigned int ... FEMSigs >
-	T _setMatrixRowAndGetConstraintFromProlongation( UIntPack< FEMSigs ... > , const BaseSystem< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& pNeighbors , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors , Pointer( MatrixEntry< Real > ) row , int offset , const PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& pcStencils , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , ConstPointer( T ) prolongedSolution , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
+	// The row is written through row[i] = MatrixEntry< Real >( ... ), either into a MatrixEntry array or in place into the arrays of a CSR matrix
+	template< typename T , unsigned int ... PointDs , unsigned int ... FEMSigs , typename MatrixRow >
+	T _setMatrixRowAndGetConstraintFromProlongation( UIntPack< FEMSigs ... > , const BaseSystem< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& pNeighbors , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors , MatrixRow row , int offset , const PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& pcStencils , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , ConstPointer( T ) prolongedSolution , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
+	template< unsigned int ... FEMSigs , typename MatrixRow >
+	void _setMatrixRow( UIntPack< FEMSigs ... > , const BaseSystem< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors , StaticWindow< Real , UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& pointValues , MatrixRow row , int offset , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil ) const;
+	// Calls F( index , value ) for the entries of the (unassembled) row of an interior node without samples in its support, in the order in which _setMatrixRow would have stored them
+	template< unsigned int ... FEMSigs , typename RowFunctor >
+	void _processStencilRow( UIntPack< FEMSigs ... > , ConstOneRingNeighborKey& neighborKey , const FEMTreeNode* node , int offset , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , RowFunctor F ) const;
+	// Relaxation and row products for a system whose rows flagged in stencilRows are applied from the stencil instead of being stored in the matrix
+	template< typename MatrixReal , unsigned int ... FEMSigs , typename T >
+	void _gsIteration( UIntPack< FEMSigs ... > , const CSRSparseMatrix< MatrixReal >& M , ConstPointer( char ) stencilRows , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , std::vector< ConstOneRingNeighborKey >& neighborKeys , int offset , const std::vector< std::vector< int > >& multiColorIndices , ConstPointer( MatrixReal ) diagonalR , ConstPointer( T ) b , Pointer( T ) x , bool forward ) const;
+	// Relaxes the blocks of a step of the sliced solver's wavefront, which are assumed to be far enough apart that none reads the unknowns of another, with one parallel loop per color.
+	// The systems, diagonals and constraints of the b-th block are in the slot slots[b], X( b ) returns its window of the solution and Offset( b ) the index of its first node.
+	template< typename MatrixReal , unsigned int ... FEMSigs , typename T , typename XFunction , typename OffsetFunction >
+	void _gsSliceBlocksIteration( UIntPack< FEMSigs ... > , const std::vector< int >& blocks , const std::vector< int >& slots , const std::vector< _SliceSystem< MatrixReal >* >& systems , Pointer( Pointer( MatrixReal ) ) diagonalsR , const std::vector< Pointer( T ) >& constraints , XFunction X , OffsetFunction Offset , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , std::vector< ConstOneRingNeighborKey >& neighborKeys , bool forward ) const;
+	template< typename MatrixReal , unsigned int ... FEMSigs , typename T >
+	T _rowProduct( UIntPack< FEMSigs ... > , const CSRSparseMatrix< MatrixReal >& M , ConstPointer( char ) stencilRows , const CCStencil< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , ConstOneRingNeighborKey& neighborKey , int offset , int row , ConstPointer( T ) x ) const;
 	template< typename T , unsigned int ... PointDs , unsigned int ... FEMSigs >
 	int _setProlongedMatrixRow( const typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& pNeighbors , Pointer( MatrixEntry< Real > ) row , int offset , const DynamicWindow< double , UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& stencil , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
 
@@ -1944,20 +2100,40 @@ protected:
 	template< unsigned int ... FEMSigs , typename T , unsigned int ... PointDs >
 	T _getConstraintFromProlongedSolution( UIntPack< FEMSigs ... > , const BaseSystem< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& neighbors , const typename FEMTreeNode::template ConstNeighbors< UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& pNeighbors , const FEMTreeNode* node , ConstPointer( T ) prolongedSolution , const DynamicWindow< double , UIntPack< BSplineOverlapSizes< FEMSignature< FEMSigs >::Degree >::OverlapSize ... > >& stencil , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
 
+	template< typename MatrixReal , unsigned int ... FEMSigs , typename T , typename TDotT , typename SORWeights , unsigned int ... PointDs >
+	int _solveFullSystemGS( UIntPack< FEMSigs ... > , const typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) prolongedSolution , ConstPointer( T ) constraints , TDotT Dot , int iters , bool coarseToFine , SORWeights sorWeights , bool matrixFree , SystemCache* systemCache , _SolverStats& stats , bool computeNorms , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
+	template< typename MatrixReal , unsigned int ... FEMSigs , typename T , typename TDotT , typename SORWeights , unsigned int ... PointDs >
+	int _solveSlicedSystemGS( UIntPack< FEMSigs ... > , const typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) prolongedSolution , ConstPointer( T ) constraints , TDotT Dot , int iters , bool coarseToFine , unsigned int sliceBlockSize , bool concurrentBlocks , SORWeights sorWeights , bool matrixFree , SystemCache* systemCache , _SolverStats& stats , bool computeNorms , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
 	template< unsigned int ... FEMSigs , typename T , typename TDotT , typename SORWeights , unsigned int ... PointDs >
-	int _solveFullSystemGS( UIntPack< FEMSigs ... > , const typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) prolongedSolution , ConstPointer( T ) constraints , TDotT Dot , int iters , bool coarseToFine , SORWeights sorWeights , _SolverStats& stats , bool computeNorms , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
-	template< unsigned int ... FEMSigs , typename T , typename TDotT , typename SORWeights , unsigned int ... PointDs >
-	int _solveSlicedSystemGS( UIntPack< FEMSigs ... > , const typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) prolongedSolution , ConstPointer( T ) constraints , TDotT Dot , int iters , bool coarseToFine , unsigned int sliceBlockSize , SORWeights sorWeights , _SolverStats& stats , bool computeNorms , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
-	template< unsigned int ... FEMSigs , typename T , typename TDotT , typename SORWeights , unsigned int ... PointDs >
-	int _solveSystemGS( UIntPack< FEMSigs ... > , bool sliced , const typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) prolongedSolution , ConstPointer( T ) constraints , TDotT Dot , int iters , bool coarseToFine , unsigned int sliceBlockSize , SORWeights sorWeights , _SolverStats& stats , bool computeNorms , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
+	int _solveSystemGS( UIntPack< FEMSigs ... > , bool sliced , const typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) prolongedSolution , ConstPointer( T ) constraints , TDotT Dot , int iters , bool coarseToFine , unsigned int sliceBlockSize , bool concurrentBlocks , SORWeights sorWeights , bool matrixFree , bool mixedPrecision , SystemCache* systemCache , _SolverStats& stats , bool computeNorms , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const
 	{
-		if( sliced ) return _solveSlicedSystemGS( UIntPack< FEMSigs ... >() , F , bsData , depth , solution , prolongedSolution , constraints , Dot , iters , coarseToFine , sliceBlockSize , sorWeights , stats , computeNorms , interpolationInfo ... );
-		else         return _solveFullSystemGS  ( UIntPack< FEMSigs ... >() , F , bsData , depth , solution , prolongedSolution , constraints , Dot , iters , coarseToFine ,                  sorWeights , stats , computeNorms , interpolationInfo ... );
+		if( mixedPrecision )
+		{
+			if( sliced ) return _solveSlicedSystemGS< float >( UIntPack< FEMSigs ... >() , F , bsData , depth , solution , prolongedSolution , constraints , Dot , iters , coarseToFine , sliceBlockSize , concurrentBlocks , sorWeights , matrixFree , systemCache , stats , computeNorms , interpolationInfo ... );
+			else         return _solveFullSystemGS  < float >( UIntPack< FEMSigs ... >() , F , bsData , depth , solution , prolongedSolution , constraints , Dot , iters , coarseToFine ,                  sorWeights , matrixFree , systemCache , stats , computeNorms , interpolationInfo ... );
+		}
+		else
+		{
+			if( sliced ) return _solveSlicedSystemGS< Real >( UIntPack< FEMSigs ... >() , F , bsData , depth , solution , prolongedSolution , constraints , Dot , iters , coarseToFine , sliceBlockSize , concurrentBlocks , sorWeights , matrixFree , systemCache , stats , computeNorms , interpolationInfo ... );
+			else         return _solveFullSystemGS  < Real >( UIntPack< FEMSigs ... >() , F , bsData , depth , solution , prolongedSolution , constraints , Dot , iters , coarseToFine ,                  sorWeights , matrixFree , systemCache , stats , computeNorms , interpolationInfo ... );
+		}
 	}
 	template< unsigned int ... FEMSigs , typename T , typename TDotT , unsigned int ... PointDs >
 	int _solveSystemCG( UIntPack< FEMSigs ... > , const typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) prolongedSolution , ConstPointer( T ) constraints , TDotT Dot , int iters , bool coarseToFine , _SolverStats& stats , bool computeNorms , double cgAccuracy , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
+	// Conjugate-gradients preconditioned with one symmetric multigrid v-cycle over the Galerkin hierarchy of the system of the depth, stopping on the relative residual.
+	// The v-cycle relaxes every level with a forward multi-color Gauss-Seidel sweep on the way down and a backward one on the way up, and solves the coarsest level (at depth zero) exactly.
 	template< unsigned int ... FEMSigs , typename T , typename TDotT , unsigned int ... PointDs >
-	void _solveRegularMG( UIntPack< FEMSigs ... > , typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) constraints , TDotT Dot , int vCycles , int iters , _SolverStats& stats , bool computeNorms , double cgAccuracy , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
+	int _solveSystemPCG( UIntPack< FEMSigs ... > , const typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) prolongedSolution , ConstPointer( T ) constraints , TDotT Dot , int iters , _SolverStats& stats , bool computeNorms , double residualTolerance , SystemCache* systemCache , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
+	// Conjugate-gradients with the step sizes shared by the whole vector, or (for the interleaved systems of solveSystems) computed separately for every lane
+	template< typename T , typename SPDFunctor , typename Preconditioner , typename TDotT >
+	static int _SolvePCG( const SPDFunctor& M , const Preconditioner& P , int dim , ConstPointer( T ) b , int iters , Pointer( T ) x , double eps , TDotT Dot , PreconditionedCGScratch< T >& scratch ){ return SolvePCG< SPDFunctor , Preconditioner , T , Real >( M , P , dim , b , iters , x , eps , Dot , &scratch ); }
+	template< unsigned int K , typename SPDFunctor , typename Preconditioner , typename TDotT >
+	static int _SolvePCG( const SPDFunctor& M , const Preconditioner& P , int dim , ConstPointer( Point< Real , K > ) b , int iters , Pointer( Point< Real , K > ) x , double eps , TDotT , PreconditionedCGScratch< Point< Real , K > >& scratch ){ return SolvePCGLanes< K , SPDFunctor , Preconditioner , Point< Real , K > , Real >( M , P , dim , b , iters , x , eps , &scratch ); }
+	// Sets the Galerkin restrictions of the system hierarchy.M[depth] to all the coarser depths, with the inverted diagonals and the multi-color indices of every depth
+	template< unsigned int ... FEMSigs >
+	void _setMGHierarchy( UIntPack< FEMSigs ... > , _MGHierarchy& hierarchy , LocalDepth depth ) const;
+	template< unsigned int ... FEMSigs , typename T , typename TDotT , unsigned int ... PointDs >
+	void _solveRegularMG( UIntPack< FEMSigs ... > , typename BaseFEMIntegrator::System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , Pointer( T ) solution , ConstPointer( T ) constraints , TDotT Dot , int vCycles , int iters , _SolverStats& stats , bool computeNorms , double cgAccuracy , SystemCache* systemCache , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
 
 	// Updates the cumulative integral constraints @(depth-1) based on the change in solution coefficients @(depth)
 	template< unsigned int ... FEMSigs , typename T >
@@ -1968,8 +2144,17 @@ protected:
 	template< unsigned int PointD , typename T , unsigned int ... FEMSigs >
 	CumulativeDerivativeValues< T , Dim , PointD >   _finerFunctionValues( UIntPack< FEMSigs ... > , Point< Real , Dim > p , const ConstPointSupportKey< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& neighborKey , const FEMTreeNode* node , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , ConstPointer( T ) coefficients ) const;
 
+	// Moves the entries of x into color order (or back), where colorOrder[i]-orderBegin is the position of the i-th entry in color order
+	template< typename T >
+	static void _permuteColorOrder( Pointer( T ) x , size_t size , ConstPointer( int ) colorOrder , int orderBegin , bool toColorOrder );
+	// Sets the system of [nBegin,nEnd), or only the constraints if it is valid. If colorOrder is set, the rows (and columns) are assembled in color order,
+	// the row of the i-th node at colorOrder[i-orderBegin]-nBegin (the nodes of a block keep to the block), while the constraints are in the order of the nodes
+	template< typename MatrixReal , unsigned int ... FEMSigs , typename T , unsigned int ... PointDs >
+	void _setSliceSystem( UIntPack< FEMSigs ... > , const BaseSystem< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , int nBegin , int nEnd , ConstPointer( T ) prolongedSolution , Pointer( T ) constraints , bool matrixFree , ConstPointer( int ) colorOrder , int orderBegin , _SliceSystem< MatrixReal >& system , const CCStencil < UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , const PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& pcStencils , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
 	template< unsigned int ... FEMSigs , typename T , unsigned int ... PointDs >
-	int _getSliceMatrixAndProlongationConstraints( UIntPack< FEMSigs ... > , const BaseSystem< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , SparseMatrix< Real >& matrix , Pointer( Real ) diagonalR , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , int nBegin , int nEnd , ConstPointer( T ) prolongedSolution , Pointer( T ) constraints , const CCStencil < UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , const PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& pcStencils , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
+	void _getProlongationConstraints( UIntPack< FEMSigs ... > , const BaseSystem< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , int nBegin , int nEnd , ConstPointer( T ) prolongedSolution , Pointer( T ) constraints , const PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& pcStencils , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
+	template< typename MatrixReal , unsigned int ... FEMSigs , typename T , unsigned int ... PointDs >
+	int _getSliceMatrixAndProlongationConstraints( UIntPack< FEMSigs ... > , const BaseSystem< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , CSRSparseMatrix< MatrixReal >& matrix , Pointer( MatrixReal ) diagonalR , const PointEvaluator< UIntPack< FEMSigs ... > , UIntPack< FEMSignature< FEMSigs >::Degree ... > >& bsData , LocalDepth depth , int nBegin , int nEnd , ConstPointer( T ) prolongedSolution , Pointer( T ) constraints , Pointer( char ) stencilRows , ConstPointer( int ) colorOrder , int orderBegin , const CCStencil < UIntPack< FEMSignature< FEMSigs >::Degree ... > >& ccStencil , const PCStencils< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& pcStencils , const InterpolationInfo< T , PointDs >* ... interpolationInfo ) const;
 
 	// Down samples constraints @(depth) to constraints @(depth-1)
 	template< class C , unsigned ... Degrees , unsigned int ... FEMSigs > void _downSample( UIntPack< FEMSigs ... > , typename BaseFEMIntegrator::template RestrictionProlongation< UIntPack< Degrees ... > >& RP , LocalDepth highDepth , Pointer( C ) constraints ) const;
@@ -2004,7 +2189,8 @@ protected:
 	void _getSampleDepthAndWeight( const DensityEstimator< WeightDegree >& densityWeights , Point< Real , Dim > position , WeightKey& weightKey , Real& depth , Real& weight ) const;
 
 	template< bool CreateNodes ,                             class V , unsigned int ... DataSigs > void      _splatPointData( FEMTreeNode* node ,                                                          Point< Real , Dim > point , V v , SparseNodeData< V , UIntPack< DataSigs ... > >& data ,                                                                         PointSupportKey< UIntPack< FEMSignature< DataSigs >::Degree ... > >& dataKey                                                                        );
-	template< bool CreateNodes , unsigned int WeightDegree , class V , unsigned int ... DataSigs > Real      _splatPointData( const DensityEstimator< WeightDegree >& densityWeights ,                     Point< Real , Dim > point , V v , SparseNodeData< V , UIntPack< DataSigs ... > >& data , PointSupportKey< IsotropicUIntPack< Dim , WeightDegree > >& weightKey , PointSupportKey< UIntPack< FEMSignature< DataSigs >::Degree ... > >& dataKey , LocalDepth minDepth , LocalDepth maxDepth , int dim , Real depthBias );
+	template< bool CreateNodes , unsigned int WeightDegree , class V , unsigned int ... DataSigs > Real      _splatPointData( const DensityEstimator< WeightDegree >& densityWeights ,                     Point< Real , Dim > point , V v , SparseNodeData< V , UIntPack< DataSigs ... > >& data , PointSupportKey< IsotropicUIntPack< Dim , WeightDegree > >& weightKey , PointSupportKey< UIntPack< FEMSignature< DataSigs >::Degree ... > >& dataKey , LocalDepth minDepth , LocalDepth maxDepth , int dim , Real depthBias , SampleSplat* splat=NULL );
+	template<                                                  class V , unsigned int ... DataSigs > void _resplatPointData( const FEMTreeNode* node ,                                                    Point< Real , Dim > point , V v , SparseNodeData< V , UIntPack< DataSigs ... > >& data ,                                                                         ConstPointSupportKey< UIntPack< FEMSignature< DataSigs >::Degree ... > >& dataKey , bool atomic=true                                                    );
 	template< bool CreateNodes , unsigned int WeightDegree , class V , unsigned int ... DataSigs > Real _multiSplatPointData( const DensityEstimator< WeightDegree >* densityWeights , FEMTreeNode* node , Point< Real , Dim > point , V v , SparseNodeData< V , UIntPack< DataSigs ... > >& data , PointSupportKey< IsotropicUIntPack< Dim , WeightDegree > >& weightKey , PointSupportKey< UIntPack< FEMSignature< DataSigs >::Degree ... > >& dataKey ,                                             int dim                  );
 	template< unsigned int WeightDegree , class V , unsigned int ... DataSigs > Real _nearestMultiSplatPointData( const DensityEstimator< WeightDegree >* densityWeights , FEMTreeNode* node , Point< Real , Dim > point , V v , SparseNodeData< V , UIntPack< DataSigs ... > >& data , PointSupportKey< IsotropicUIntPack< Dim , WeightDegree > >& weightKey , int dim=Dim );
 	template< class V , class Coefficients , unsigned int D , unsigned int ... DataSigs > V _evaluate( const Coefficients& coefficients , Point< Real , Dim > p , const PointEvaluator< UIntPack< DataSigs ... > , IsotropicUIntPack< Dim , D > >& pointEvaluator , const ConstPointSupportKey< UIntPack< FEMSignature< DataSigs >::Degree ... > >& dataKey ) const;
@@ -2241,10 +2427,20 @@ public:
 	typename FEMTree::template DensityEstimator< DensityDegree >* setDensityEstimator( const std::vector< PointSample >& samples , LocalDepth splatDepth , Real samplesPerNode , int coDimension );
 	template< unsigned int ... NormalSigs , unsigned int DensityDegree , class Data >
 #if defined(_WIN32) || defined(_WIN64)
-	SparseNodeData< Point< Real , Dim > , UIntPack< NormalSigs ... > > setNormalField( UIntPack< NormalSigs ... > , const std::vector< PointSample >& samples , const std::vector< Data >& normalData , const DensityEstimator< DensityDegree >* density , Real& pointWeightSum , std::function< Real ( Real ) > BiasFunction = []( Real ){ return 0.f; } );
+	SparseNodeData< Point< Real , Dim > , UIntPack< NormalSigs ... > > setNormalField( UIntPack< NormalSigs ... > , const std::vector< PointSample >& samples , const std::vector< Data >& normalData , const DensityEstimator< DensityDegree >* density , Real& pointWeightSum , std::function< Real ( Real ) > BiasFunction = []( Real ){ return 0.f; } , std::vector< SampleSplat >* splats=NULL );
 #else // !_WIN32 && !_WIN64
-	SparseNodeData< Point< Real , Dim > , UIntPack< NormalSigs ... > > setNormalField( UIntPack< NormalSigs ... > , const std::vector< PointSample >& samples , const std::vector< Data >& normalData , const DensityEstimator< DensityDegree >* density , Real& pointWeightSum , std::function< Real ( Real ) > BiasFunction = []( Real ){ return (Real)0; } );
+	SparseNodeData< Point< Real , Dim > , UIntPack< NormalSigs ... > > setNormalField( UIntPack< NormalSigs ... > , const std::vector< PointSample >& samples , const std::vector< Data >& normalData , const DensityEstimator< DensityDegree >* density , Real& pointWeightSum , std::function< Real ( Real ) > BiasFunction = []( Real ){ return (Real)0; } , std::vector< SampleSplat >* splats=NULL );
 #endif // _WIN32 || _WIN64
+	// Re-computes the values of a normal field from new normals, re-using the splats recorded by setNormalField.
+	// Only the nodes that already carry normal data are updated, so the tree (and its indexing) can have been finalized in between.
+	template< unsigned int ... NormalSigs , class Data >
+	void resetNormalField( UIntPack< NormalSigs ... > , const std::vector< PointSample >& samples , const std::vector< Data >& normalData , const std::vector< SampleSplat >& splats , SparseNodeData< Point< Real , Dim > , UIntPack< NormalSigs ... > >& normalField );
+	// Groups the splats recorded by setNormalField by node and color, for contention-free calls to resetNormalField. The tree has to be finalized.
+	template< unsigned int ... NormalSigs >
+	SplatSchedule setSplatSchedule( UIntPack< NormalSigs ... > , const std::vector< PointSample >& samples , const std::vector< SampleSplat >& splats ) const;
+	// As above, but accumulating the splats of one color at a time, each node's splats by a single thread, so that no atomic additions are needed.
+	template< unsigned int ... NormalSigs , class Data >
+	void resetNormalField( UIntPack< NormalSigs ... > , const std::vector< PointSample >& samples , const std::vector< Data >& normalData , const std::vector< SampleSplat >& splats , const SplatSchedule& schedule , SparseNodeData< Point< Real , Dim > , UIntPack< NormalSigs ... > >& normalField );
 
 	template< unsigned int DataSig , bool CreateNodes , unsigned int DensityDegree , class Data >
 	SparseNodeData< Data , IsotropicUIntPack< Dim , DataSig > > setSingleDepthDataField( const std::vector< PointSample >& samples , const std::vector< Data >& sampleData , const DensityEstimator< DensityDegree >* density );
@@ -2471,11 +2667,31 @@ public:
 		int vCycles;
 		double cgAccuracy;
 		int baseDepth , baseVCycles;
+		// If positive, the v-cycles stop once the relative residual at the finest solve depth that has nodes, |b-Ax|/|b|, drops below this value.
+		// (A solution passed in with the size of the system is used as the initial guess, so this also bounds the work of a warm-started solve.)
+		double residualTolerance;
+		// If set, the Gauss-Seidel solvers do not assemble the rows of interior nodes without samples in their support but apply the stencil to their neighbors on the fly
+		bool matrixFree;
+		// If set, the Gauss-Seidel solvers store their matrices (and inverted diagonals) in single precision, while the relaxations, residuals and constraints are accumulated in the precision of the solution
+		bool mixedPrecision;
+		// If set, the systems built by the solver are kept in (and taken from) this cache, so that solves with the same tree and interpolation constraints do not rebuild them
+		SystemCache* systemCache;
+		// If positive, the finest solve depth that has nodes is solved in the prolongation phase with at most this many iterations of conjugate-gradients, preconditioned with a multigrid v-cycle,
+		// stopping once the relative residual drops below residualTolerance (instead of relaxing it with a fixed number of Gauss-Seidel iterations).
+		// With several right-hand sides (solveSystems) every one has its own step sizes and stopping test.
+		int pcgIters;
+		// If set, the sliced Gauss-Seidel solver spaces the blocks relaxed by a step of its wavefront further apart than their overlap, and relaxes them concurrently.
+		// This gives the same result as relaxing them one after the other.
+		bool concurrentSliceBlocks;
 		// What to output
 		bool verbose , showResidual;
 		int showGlobalResidual;
+		// If set, a JSON object describing the solve of every depth (its size, timings, residuals and estimated memory traffic) is written on a line of this file
+		FILE* telemetry;
+		// Identifies the solve in the lines written to telemetry, so that the v-cycles of successive solves can be told apart
+		int solveId;
 
-		SolverInfo( void ) : cgDepth(0) , wCycle(false) , cascadic(true) , iters(1) , vCycles(1) , cgAccuracy(0.) , verbose(false) , showResidual(false) , showGlobalResidual(SHOW_GLOBAL_RESIDUAL_NONE) , sliceBlockSize(1) , sorRestrictionFunction( []( Real , Real ){ return (Real)1; } ) , sorProlongationFunction( []( Real , Real ){ return (Real)1; } ) , useSupportWeights( false ) , useProlongationSupportWeights( false ) , baseDepth(0) , baseVCycles(1) { }
+		SolverInfo( void ) : cgDepth(0) , wCycle(false) , cascadic(true) , iters(1) , vCycles(1) , cgAccuracy(0.) , verbose(false) , showResidual(false) , showGlobalResidual(SHOW_GLOBAL_RESIDUAL_NONE) , sliceBlockSize(1) , sorRestrictionFunction( []( Real , Real ){ return (Real)1; } ) , sorProlongationFunction( []( Real , Real ){ return (Real)1; } ) , useSupportWeights( false ) , useProlongationSupportWeights( false ) , baseDepth(0) , baseVCycles(1) , residualTolerance(0.) , matrixFree(false) , mixedPrecision(false) , systemCache(NULL) , pcgIters(0) , concurrentSliceBlocks(false) , telemetry(NULL) , solveId(0) { }
 	};
 	// Solve the linear system
 	template< unsigned int ... FEMSigs , typename T , typename TDotT , unsigned int ... PointDs >
@@ -2486,13 +2702,17 @@ public:
 	template< unsigned int ... FEMSigs , unsigned int ... PointDs >
 	void solveSystem( UIntPack< FEMSigs ... > , typename BaseFEMIntegrator::template System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const DenseNodeData< Real , UIntPack< FEMSigs ... > >& constraints , DenseNodeData< Real , UIntPack< FEMSigs ... > >& solution , LocalDepth maxSolveDepth , const SolverInfo& solverInfo , InterpolationInfo< Real , PointDs >* ... iData ) const
 	{
-		return solveSystem< FEMSigs ... , Real >( UIntPack< FEMSigs ... >() , F , constraints , solution , []( Real v , Real w ){ return v*w; } , maxSolveDepth , solverInfo , iData ... );
+		return solveSystem( UIntPack< FEMSigs ... >() , F , constraints , solution , []( Real v , Real w ){ return v*w; } , maxSolveDepth , solverInfo , iData ... );
 	}
 	template< unsigned int ... FEMSigs , unsigned int ... PointDs >
 	DenseNodeData< Real , UIntPack< FEMSigs ... > > solveSystem( UIntPack< FEMSigs ... > , typename BaseFEMIntegrator::template System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const DenseNodeData< Real , UIntPack< FEMSigs ... > >& constraints , LocalDepth maxSolveDepth , const SolverInfo& solverInfo , InterpolationInfo< Real , PointDs >* ... iData ) const
 	{
 		return solveSystem( UIntPack< FEMSigs ... >() , F , constraints , []( Real v , Real w ){ return v*w; } , maxSolveDepth , solverInfo , iData ... );
 	}
+	// Solve the linear system for K right-hand sides at once, relaxing them together so that every sweep streams the matrices once for all of them
+	// (Solutions that come in with the size of the system are used as initial guesses, provided that all of them do.)
+	template< unsigned int K , unsigned int ... FEMSigs , unsigned int ... PointDs >
+	void solveSystems( UIntPack< FEMSigs ... > , typename BaseFEMIntegrator::template System< UIntPack< FEMSignature< FEMSigs >::Degree ... > >& F , const DenseNodeData< Real , UIntPack< FEMSigs ... > >* constraints , DenseNodeData< Real , UIntPack< FEMSigs ... > >* solutions , LocalDepth maxSolveDepth , const SolverInfo& solverInfo , InterpolationInfo< Point< Real , K > , PointDs >* ... iData ) const;
 
 	FEMTreeNode& spaceRoot( void ){ return *_spaceRoot; }
 	const FEMTreeNode& tree( void ) const { return *_tree; }
@@ -2582,6 +2802,8 @@ struct FEMTreeInitializer
 	// Initialize the tree using a point stream
 	static int Initialize( FEMTreeNode& root , InputPointStream< Real , Dim >& pointStream , int maxDepth , std::vector< PointSample >& samplePoints , Allocator< FEMTreeNode >* nodeAllocator , std::function< void ( FEMTreeNode& ) > NodeInitializer );
 	template< class Data > static int Initialize( FEMTreeNode& root , InputPointStreamWithData< Real , Dim , Data >& pointStream , int maxDepth , std::vector< PointSample >& samplePoints , std::vector< Data >& sampleData , bool mergeNodeSamples , Allocator< FEMTreeNode >* nodeAllocator , std::function< void ( FEMTreeNode& ) > NodeInitializer , std::function< Real ( const Point< Real , Dim >& , Data& ) > ProcessData = []( const Point< Real , Dim >& , Data& ){ return (Real)1.; } );
+	// As above, but the points are sorted by the Morton (Z-curve) codes of their leaves, the tree is built from the sorted codes in parallel, and the samples are returned in Morton order
+	template< class Data > static int MortonInitialize( FEMTreeNode& root , InputPointStreamWithData< Real , Dim , Data >& pointStream , int maxDepth , std::vector< PointSample >& samplePoints , std::vector< Data >& sampleData , bool mergeNodeSamples , Allocator< FEMTreeNode >* nodeAllocator , std::function< void ( FEMTreeNode& ) > NodeInitializer , std::function< Real ( const Point< Real , Dim >& , Data& ) > ProcessData = []( const Point< Real , Dim >& , Data& ){ return (Real)1.; } );
 
 	// Initialize the tree using simplices
 	static void Initialize( FEMTreeNode& root , const std::vector< Point< Real , Dim > >& vertices , const std::vector< SimplexIndex< Dim-1 > >& simplices , int maxDepth , std::vector< PointSample >& samples , bool mergeNodeSamples , Allocator< FEMTreeNode >* nodeAllocator , std::function< void ( FEMTreeNode& ) > NodeInitializer );
@@ -2593,6 +2815,8 @@ struct FEMTreeInitializer
 	static unsigned int Initialize( FEMTreeNode& root , DerivativeStream< Data >& dStream , std::vector< NodeSample< Dim , Data > > derivatives[Dim] , Allocator< FEMTreeNode >* nodeAllocator , std::function< void ( FEMTreeNode& ) > NodeInitializer );
 
 protected:
+	// Stable least-significant-digit radix sort of (key,index) pairs on the low bits of the keys
+	static void _RadixSort( std::vector< std::pair< unsigned long long , int > >& keys , unsigned int bits );
 	static int _AddSimplex( FEMTreeNode& root , Simplex< Real , Dim , Dim-1 >& s , int maxDepth , std::vector< PointSample >& samples , std::vector< int >* nodeToIndexMap , Allocator< FEMTreeNode >* nodeAllocator , std::function< void ( FEMTreeNode& ) > NodeInitializer );
 	static int _AddSimplex( FEMTreeNode& root , Simplex< Real , Dim , Dim-1 >& s , int maxDepth , std::vector< NodeSimplices< Dim , Real > >& simplices , std::vector< int >& nodeToIndexMap , Allocator< FEMTreeNode >* nodeAllocator , std::function< void ( FEMTreeNode& ) > NodeInitializer );
 	static int _AddSimplex( FEMTreeNode* node , Simplex< Real , Dim , Dim-1 >& s , int maxDepth , std::vector< PointSample >& samples , std::vector< int >* nodeToIndexMap , Allocator< FEMTreeNode >* nodeAllocator , std::function< void ( FEMTreeNode& ) > NodeInitializer );
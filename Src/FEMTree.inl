@@ -268,53 +268,107 @@ template< unsigned int Dim , class Real >
 template< unsigned int DensityDegree >
 typename FEMTree< Dim , Real >::template DensityEstimator< DensityDegree >* FEMTree< Dim , Real >::setDensityEstimator( const std::vector< PointSample >& samples , LocalDepth splatDepth , Real samplesPerNode , int coDimension )
 {
+	typedef ProjectiveData< Point< Real , Dim > , Real > Sample;
+	// Nodes whose offsets agree modulo the support size have disjoint splatting windows
+	static const int SupportSize = BSplineSupportSizes< DensityDegree >::SupportSize;
+	int colorCount = 1;
+	for( int dd=0 ; dd<Dim ; dd++ ) colorCount *= SupportSize;
+
 	LocalDepth maxDepth = _spaceRoot->maxDepth();
 	splatDepth = std::max< LocalDepth >( 0 , std::min< LocalDepth >( splatDepth , maxDepth ) );
 	DensityEstimator< DensityDegree >* _density = new DensityEstimator< DensityDegree >( splatDepth , coDimension );
 	DensityEstimator< DensityDegree >& density = *_density;
-	PointSupportKey< IsotropicUIntPack< Dim , DensityDegree > > densityKey;
-	densityKey.set( _localToGlobal( splatDepth ) );
+	std::vector< PointSupportKey< IsotropicUIntPack< Dim , DensityDegree > > > densityKeys( omp_get_max_threads() );
+	for( int i=0 ; i<densityKeys.size() ; i++ ) densityKeys[i].set( _localToGlobal( splatDepth ) );
 
 	std::vector< int > sampleMap( nodeCount() , -1 );
 #pragma omp parallel for
 	for( int i=0 ; i<samples.size() ; i++ ) if( samples[i].sample.weight>0 ) sampleMap[ samples[i].node->nodeData.nodeIndex ] = i;
-	std::function< ProjectiveData< Point< Real , Dim > , Real > ( FEMTreeNode* ) > SetDensity = [&] ( FEMTreeNode* node )
+	std::function< Sample ( const FEMTreeNode* ) > SubtreeSample = [&]( const FEMTreeNode* node )
 	{
-		ProjectiveData< Point< Real , Dim > , Real > sample;
-		LocalDepth d = _localDepth( node );
+		Sample sample;
 		int idx = node->nodeData.nodeIndex;
-		if( node->children )
-			for( int c=0 ; c<(1<<Dim) ; c++ )
+		if( node->children ) for( int c=0 ; c<(1<<Dim) ; c++ ) sample += SubtreeSample( node->children + c );
+		else if( idx<sampleMap.size() && sampleMap[idx]!=-1 ) sample = samples[ sampleMap[ idx ] ].sample;
+		return sample;
+	};
+
+	// Gather the nodes at or above the splatting depth, level by level, so that the children of nodes[d][i] are consecutive in nodes[d+1] starting at childStart[d][i]
+	std::vector< std::vector< FEMTreeNode* > > nodes( splatDepth+1 );
+	std::vector< std::vector< int > > childStart( splatDepth+1 );
+	nodes[0].push_back( _spaceRoot );
+	for( LocalDepth d=0 ; d<=splatDepth ; d++ )
+	{
+		childStart[d].resize( nodes[d].size() , -1 );
+		for( int i=0 ; i<nodes[d].size() ; i++ ) if( nodes[d][i]->children )
+		{
+			childStart[d][i] = d<splatDepth ? (int)nodes[d+1].size() : 0;
+			if( d<splatDepth ) for( int c=0 ; c<(1<<Dim) ; c++ ) nodes[d+1].push_back( nodes[d][i]->children + c );
+		}
+	}
+
+	// Accumulate the samples and splat them from the bottom up. Nodes of the same color are splatted in parallel, and the colors are processed in a fixed order so that the density does not depend on the thread count.
+	std::vector< Sample > sums , childSums;
+	for( LocalDepth d=splatDepth ; d>=0 ; d-- )
+	{
+		std::vector< std::vector< int > > colors( colorCount );
+		for( int i=0 ; i<nodes[d].size() ; i++ )
+		{
+			LocalDepth _d;
+			LocalOffset off;
+			_localDepthAndOffset( nodes[d][i] , _d , off );
+			int color = 0;
+			for( int dd=Dim-1 ; dd>=0 ; dd-- ) color = color*SupportSize + ( ( off[dd] % SupportSize ) + SupportSize ) % SupportSize;
+			colors[color].push_back( i );
+		}
+		sums.resize( 0 ) , sums.resize( nodes[d].size() );
+		density.reserve( nodeCount() );
+		for( int color=0 ; color<colorCount ; color++ )
+		{
+#pragma omp parallel for
+			for( int j=0 ; j<colors[color].size() ; j++ )
 			{
-				ProjectiveData< Point< Real , Dim > , Real > s = SetDensity( node->children + c );
-				if( d<=splatDepth && s.weight>0 )
+				PointSupportKey< IsotropicUIntPack< Dim , DensityDegree > >& densityKey = densityKeys[ omp_get_thread_num() ];
+				int i = colors[color][j];
+				FEMTreeNode* node = nodes[d][i];
+				Sample& sample = sums[i];
+				if( childStart[d][i]!=-1 )
+					for( int c=0 ; c<(1<<Dim) ; c++ )
+					{
+						Sample s = d<splatDepth ? childSums[ childStart[d][i]+c ] : SubtreeSample( node->children + c );
+						if( s.weight>0 )
+						{
+							Point< Real , Dim > p = s.data / s.weight;
+							Real w = s.weight / samplesPerNode;
+							_addWeightContribution( density , node , p , densityKey , w );
+						}
+						sample += s;
+					}
+				else
 				{
-					Point< Real , Dim > p = s.data / s.weight;
-					Real w = s.weight / samplesPerNode;
-					_addWeightContribution( density , node , p , densityKey , w );
+					int idx = node->nodeData.nodeIndex;
+					if( idx<sampleMap.size() && sampleMap[idx]!=-1 )
+					{
+						sample = samples[ sampleMap[ idx ] ].sample;
+						if( sample.weight>0 )
+						{
+							Point< Real , Dim > p = sample.data / sample.weight;
+							Real w = sample.weight / samplesPerNode;
+							_addWeightContribution( density , node , p , densityKey , w );
+						}
+					}
 				}
-				sample += s;
-			}
-		else if( idx<sampleMap.size() && sampleMap[idx]!=-1 )
-		{
-			sample = samples[ sampleMap[ idx ] ].sample;
-			if( d<=splatDepth && sample.weight>0 )
-			{
-				Point< Real , Dim > p = sample.data / sample.weight;
-				Real w = sample.weight / samplesPerNode;
-				_addWeightContribution( density , node , p , densityKey , w );
 			}
 		}
-		return sample;
-	};
-	SetDensity( _spaceRoot );
+		std::swap( sums , childSums );
+	}
 
 	MemoryUsage();
 	return _density;
 }
 template< unsigned int Dim , class Real >
 template< unsigned int ... NormalSigs , unsigned int DensityDegree , class Data >
-SparseNodeData< Point< Real , Dim > , UIntPack< NormalSigs ... > > FEMTree< Dim , Real >::setNormalField( UIntPack< NormalSigs ... > , const std::vector< PointSample >& samples , const std::vector< Data >& normalData , const DensityEstimator< DensityDegree >* density , Real& pointWeightSum , std::function< Real ( Real ) > BiasFunction )
+SparseNodeData< Point< Real , Dim > , UIntPack< NormalSigs ... > > FEMTree< Dim , Real >::setNormalField( UIntPack< NormalSigs ... > , const std::vector< PointSample >& samples , const std::vector< Data >& normalData , const DensityEstimator< DensityDegree >* density , Real& pointWeightSum , std::function< Real ( Real ) > BiasFunction , std::vector< SampleSplat >* splats )
 {
 	LocalDepth maxDepth = _spaceRoot->maxDepth();
 	typedef PointSupportKey< IsotropicUIntPack< Dim , DensityDegree > > DensityKey;
@@ -330,6 +384,7 @@ SparseNodeData< Point< Real , Dim > , UIntPack< NormalSigs ... > > FEMTree< Dim
 	pointWeightSum = 0;
 	SparseNodeData< Point< Real , Dim > , UIntPack< NormalSigs ... > > normalField;
 	Real _pointWeightSum = 0;
+	if( splats ) splats->assign( samples.size() , SampleSplat() );
 #pragma omp parallel for reduction( + : weightSum , _pointWeightSum )
 	for( int i=0 ; i<samples.size() ; i++ )
 	{
@@ -351,11 +406,13 @@ SparseNodeData< Point< Real , Dim > , UIntPack< NormalSigs ... > > FEMTree< Dim
 				fprintf( stderr , "\n" );
 				continue;
 			}
-			if( density ) _pointWeightSum += _splatPointData< true , DensityDegree , Point< Real , Dim > , NormalSigs ... >( *density , p , n , normalField , densityKey , oneKey ? *( (NormalKey*)&densityKey ) : normalKey , 0 , maxDepth , Dim , depthBias ) * sample.weight;
+			if( density ) _pointWeightSum += _splatPointData< true , DensityDegree , Point< Real , Dim > , NormalSigs ... >( *density , p , n , normalField , densityKey , oneKey ? *( (NormalKey*)&densityKey ) : normalKey , 0 , maxDepth , Dim , depthBias , splats ? &(*splats)[i] : NULL ) * sample.weight;
 			else
 			{
 				Real width = (Real)( 1.0 / ( 1<<maxDepth ) );
-				_splatPointData< true , Point< Real , Dim > , NormalSigs ... >( leaf( p , maxDepth ) , p , n / (Real)pow( width , Dim ) , normalField , oneKey ? *( (NormalKey*)&densityKey ) : normalKey );
+				FEMTreeNode* node = leaf( p , maxDepth );
+				if( splats ) (*splats)[i].nodes[0] = node , (*splats)[i].scales[0] = (Real)1. / (Real)pow( width , Dim );
+				_splatPointData< true , Point< Real , Dim > , NormalSigs ... >( node , p , n / (Real)pow( width , Dim ) , normalField , oneKey ? *( (NormalKey*)&densityKey ) : normalKey );
 				_pointWeightSum += sample.weight;
 			}
 		}
@@ -365,6 +422,124 @@ SparseNodeData< Point< Real , Dim > , UIntPack< NormalSigs ... > > FEMTree< Dim
 	return normalField;
 }
 template< unsigned int Dim , class Real >
+template< unsigned int ... NormalSigs , class Data >
+void FEMTree< Dim , Real >::resetNormalField( UIntPack< NormalSigs ... > , const std::vector< PointSample >& samples , const std::vector< Data >& normalData , const std::vector< SampleSplat >& splats , SparseNodeData< Point< Real , Dim > , UIntPack< NormalSigs ... > >& normalField )
+{
+	LocalDepth maxDepth = _spaceRoot->maxDepth();
+	typedef ConstPointSupportKey< UIntPack< FEMSignature< NormalSigs >::Degree ... > > NormalKey;
+	std::vector< NormalKey > normalKeys( omp_get_max_threads() );
+	for( int i=0 ; i<normalKeys.size() ; i++ ) normalKeys[i].set( _localToGlobal( maxDepth ) );
+
+#pragma omp parallel for
+	for( int i=0 ; i<normalField.size() ; i++ ) normalField[i] = Point< Real , Dim >();
+#pragma omp parallel for
+	for( int i=0 ; i<samples.size() ; i++ )
+	{
+		NormalKey& normalKey = normalKeys[ omp_get_thread_num() ];
+		const ProjectiveData< Point< Real , Dim > , Real >& sample = samples[i].sample;
+		if( sample.weight>0 && splats[i].nodes[0] )
+		{
+			Point< Real , Dim > p = sample.data / sample.weight , n = normalData[i].normal;
+			Real l = (Real)Length( n );
+			// A zero normal has no direction to splat, and dividing by its length would spread NaNs through the field
+			if( !( l>0 ) ) continue;
+			n *= sample.weight / l;
+			for( int j=0 ; j<2 ; j++ ) if( splats[i].nodes[j] ) _resplatPointData< Point< Real , Dim > , NormalSigs ... >( splats[i].nodes[j] , p , n * splats[i].scales[j] , normalField , normalKey );
+		}
+	}
+	MemoryUsage();
+}
+template< unsigned int Dim , class Real >
+template< unsigned int ... NormalSigs >
+typename FEMTree< Dim , Real >::SplatSchedule FEMTree< Dim , Real >::setSplatSchedule( UIntPack< NormalSigs ... > , const std::vector< PointSample >& samples , const std::vector< SampleSplat >& splats ) const
+{
+	// Nodes at the same depth whose offsets agree modulo the support size have disjoint supports
+	static const int SupportSizes[] = { BSplineSupportSizes< FEMSignature< NormalSigs >::Degree >::SupportSize ... };
+	int colorCount = 1;
+	for( int d=0 ; d<Dim ; d++ ) colorCount *= SupportSizes[d];
+
+	SplatSchedule schedule;
+	size_t sNodeCount = _sNodes.size();
+
+	// Count the splats going into each node
+	std::vector< size_t > splatStarts( sNodeCount+1 , 0 );
+	for( int i=0 ; i<samples.size() ; i++ ) if( samples[i].sample.weight>0 && splats[i].nodes[0] )
+		for( int j=0 ; j<2 ; j++ ) if( splats[i].nodes[j] && splats[i].nodes[j]->nodeData.nodeIndex>=0 ) splatStarts[ splats[i].nodes[j]->nodeData.nodeIndex+1 ]++;
+
+	// Color the nodes that are splatted into
+	std::vector< int > colors( sNodeCount , -1 );
+#pragma omp parallel for
+	for( int i=0 ; i<sNodeCount ; i++ ) if( splatStarts[i+1] )
+	{
+		LocalDepth d;
+		LocalOffset off;
+		_localDepthAndOffset( _sNodes.treeNodes[i] , d , off );
+		int color = 0;
+		for( int dd=Dim-1 ; dd>=0 ; dd-- ) color = color*SupportSizes[dd] + ( ( off[dd] % SupportSizes[dd] ) + SupportSizes[dd] ) % SupportSizes[dd];
+		colors[i] = color;
+	}
+
+	// Order the nodes by color, and then by index
+	schedule.colorStarts.resize( colorCount+1 , 0 );
+	for( int i=0 ; i<sNodeCount ; i++ ) if( colors[i]!=-1 ) schedule.colorStarts[ colors[i]+1 ]++;
+	for( int c=0 ; c<colorCount ; c++ ) schedule.colorStarts[c+1] += schedule.colorStarts[c];
+	schedule.nodes.resize( schedule.colorStarts[colorCount] );
+	{
+		std::vector< size_t > colorSizes( colorCount , 0 );
+		std::vector< size_t > position( sNodeCount , 0 );
+		for( int i=0 ; i<sNodeCount ; i++ ) if( colors[i]!=-1 )
+		{
+			position[i] = schedule.colorStarts[ colors[i] ] + colorSizes[ colors[i] ]++;
+			schedule.nodes[ position[i] ] = _sNodes.treeNodes[i];
+		}
+
+		// Lay out the splats of each node contiguously, in sample order
+		schedule.nodeStarts.resize( schedule.nodes.size()+1 , 0 );
+		for( int i=0 ; i<sNodeCount ; i++ ) if( colors[i]!=-1 ) schedule.nodeStarts[ position[i]+1 ] = splatStarts[i+1];
+		for( size_t i=0 ; i<schedule.nodes.size() ; i++ ) schedule.nodeStarts[i+1] += schedule.nodeStarts[i];
+		std::vector< size_t > nodeSizes( schedule.nodes.size() , 0 );
+		schedule.splats.resize( schedule.nodeStarts.back() );
+		for( int i=0 ; i<samples.size() ; i++ ) if( samples[i].sample.weight>0 && splats[i].nodes[0] )
+			for( int j=0 ; j<2 ; j++ ) if( splats[i].nodes[j] && splats[i].nodes[j]->nodeData.nodeIndex>=0 )
+			{
+				size_t p = position[ splats[i].nodes[j]->nodeData.nodeIndex ];
+				schedule.splats[ schedule.nodeStarts[p] + nodeSizes[p]++ ] = 2*i+j;
+			}
+	}
+	return schedule;
+}
+template< unsigned int Dim , class Real >
+template< unsigned int ... NormalSigs , class Data >
+void FEMTree< Dim , Real >::resetNormalField( UIntPack< NormalSigs ... > , const std::vector< PointSample >& samples , const std::vector< Data >& normalData , const std::vector< SampleSplat >& splats , const SplatSchedule& schedule , SparseNodeData< Point< Real , Dim > , UIntPack< NormalSigs ... > >& normalField )
+{
+	LocalDepth maxDepth = _spaceRoot->maxDepth();
+	typedef ConstPointSupportKey< UIntPack< FEMSignature< NormalSigs >::Degree ... > > NormalKey;
+	std::vector< NormalKey > normalKeys( omp_get_max_threads() );
+	for( int i=0 ; i<normalKeys.size() ; i++ ) normalKeys[i].set( _localToGlobal( maxDepth ) );
+
+#pragma omp parallel for
+	for( int i=0 ; i<normalField.size() ; i++ ) normalField[i] = Point< Real , Dim >();
+	for( size_t c=0 ; c+1<schedule.colorStarts.size() ; c++ )
+	{
+#pragma omp parallel for
+		for( long long idx=(long long)schedule.colorStarts[c] ; idx<(long long)schedule.colorStarts[c+1] ; idx++ )
+		{
+			NormalKey& normalKey = normalKeys[ omp_get_thread_num() ];
+			for( size_t k=schedule.nodeStarts[idx] ; k<schedule.nodeStarts[idx+1] ; k++ )
+			{
+				int i = schedule.splats[k]>>1 , j = schedule.splats[k]&1;
+				const ProjectiveData< Point< Real , Dim > , Real >& sample = samples[i].sample;
+				Point< Real , Dim > p = sample.data / sample.weight , n = normalData[i].normal;
+				Real l = (Real)Length( n );
+				if( !( l>0 ) ) continue;
+				n *= sample.weight / l;
+				_resplatPointData< Point< Real , Dim > , NormalSigs ... >( schedule.nodes[idx] , p , n * splats[i].scales[j] , normalField , normalKey , false );
+			}
+		}
+	}
+	MemoryUsage();
+}
+template< unsigned int Dim , class Real >
 template< unsigned int DataSig , bool CreateNodes , unsigned int DensityDegree , class Data >
 SparseNodeData< Data , IsotropicUIntPack< Dim , DataSig > > FEMTree< Dim , Real >::setSingleDepthDataField( const std::vector< PointSample >& samples , const std::vector< Data >& sampleData , const DensityEstimator< DensityDegree >* density )
 {
@@ -0,0 +1,310 @@
+/*
+Copyright (c) 2022, Fei Hou and Chiyu Wang, Institute of Software, Chinese Academy of Sciences.
+All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef IPSR_H
+#define IPSR_H
+
+#include <vector>
+#include <string>
+#include <array>
+#include <limits>
+#include <algorithm>
+#include <random>
+#include "kdtree.h"
+#include "utility.h"
+#include "PoissonRecon.h"
+
+// parameters of iPSR
+struct IPSRParameters
+{
+	int iters;					// maximum number of iterations
+	double point_weight;		// screened weight of SPSR
+	int depth;					// maximum depth of the octree
+	int neighbors;				// number of the nearest sample points to search from every face
+	double variation_fraction;	// fraction of the samples with the largest normal change that measures convergence
+	double variation_threshold; // the iterations stop when their average normal change is below this value
+	bool matrix_free;			// do not assemble the matrix rows that are the plain stencil of the Poisson system
+	bool mixed_precision;		// store the matrices of the Gauss-Seidel relaxations in single precision
+	bool cache_matrices;		// keep the matrices of the Gauss-Seidel relaxations for all the iterations
+	bool concurrent_slices;		// relax the slice blocks of a Gauss-Seidel wavefront step concurrently, at the cost of more blocks in memory
+	int initializations;		// number of random normal initializations iterated together, the one that converges best is returned
+	int pcg_iters;				// maximum preconditioned conjugate-gradient iterations solving the finest depth, 0 to relax it with Gauss-Seidel
+	double residual_tolerance;	// the conjugate-gradient iterations stop once the relative residual at the finest depth is below this value
+	bool morton_order;			// sample the points in the Morton order of the octree leaves, for the locality of the later passes on unordered scans
+	std::string telemetry;		// if not empty, the statistics of the solves of every depth are appended to this file as JSON lines
+	bool verbose;				// print the progress of the iterations
+
+	IPSRParameters() : iters(30), point_weight(10), depth(10), neighbors(10), variation_fraction(0.001), variation_threshold(0.175), matrix_free(false), mixed_precision(false), cache_matrices(false), concurrent_slices(false), initializations(1), pcg_iters(0), residual_tolerance(1e-3), morton_order(false), verbose(true) {}
+
+	// parameters of the screened Poisson reconstructions run by iPSR
+	PoissonParameters poisson_parameters() const
+	{
+		PoissonParameters params;
+		params.depth = depth;
+		params.pointWeight = (float)point_weight;
+		params.boundary = BOUNDARY_DIRICHLET;
+		params.matrixFree = matrix_free;
+		params.mixedPrecision = mixed_precision;
+		params.cacheMatrices = cache_matrices;
+		params.concurrentSlices = concurrent_slices;
+		params.pcgIters = pcg_iters;
+		params.residualTolerance = (float)residual_tolerance;
+		params.mortonOrder = morton_order;
+		return params;
+	}
+};
+
+// Iterative Poisson surface reconstruction of unoriented points.
+// An object only holds its parameters, so independent reconstructions can run concurrently.
+template <class Real>
+class IPSR
+{
+public:
+	typedef Point<Real, 3> Vertex;
+	typedef std::pair<std::vector<Vertex>, std::vector<std::vector<int>>> Mesh;
+
+	explicit IPSR(const IPSRParameters &parameters) : parameters_(parameters) {}
+
+	const IPSRParameters &parameters() const { return parameters_; }
+
+	// reconstruct a mesh from the count points starting at points; the mesh is in the coordinates of the points,
+	// and empty if the parameters are invalid
+	Mesh reconstruct(const Vertex *points, size_t count) const
+	{
+		const unsigned int DIM = 3U;
+		const IPSRParameters &p = parameters_;
+		if (p.neighbors <= 0)
+		{
+			printf("invalid number of neighbors %d\n", p.neighbors);
+			return Mesh();
+		}
+		PoissonParameters poisson = p.poisson_parameters();
+		const Normal<Real, DIM> zero_normal(Point<Real, DIM>(0, 0, 0));
+
+		if (!p.telemetry.empty())
+		{
+			poisson.telemetry = fopen(p.telemetry.c_str(), "a");
+			if (!poisson.telemetry)
+				printf("cannot open the telemetry file %s\n", p.telemetry.c_str());
+		}
+
+		std::vector<std::pair<Point<Real, DIM>, Normal<Real, DIM>>> points_normals(count);
+		for (size_t i = 0; i < count; ++i)
+			points_normals[i] = std::make_pair(points[i], Normal<Real, DIM>(Point<Real, DIM>(1, 0, 0)));
+
+		// sample points by the octree
+		XForm<Real, DIM + 1> iXForm;
+		std::vector<double> weight_samples;
+		points_normals = sample_points<Real, DIM>(poisson, points_normals, iXForm, weight_samples);
+
+		// initialize normals randomly
+		if (p.verbose)
+			printf("random initialization...\n");
+		std::vector<std::vector<std::pair<Point<Real, DIM>, Normal<Real, DIM>>>> fields(std::max(p.initializations, 1), points_normals);
+		std::mt19937 generator(0);
+		for (size_t f = 0; f < fields.size(); ++f)
+		{
+			for (size_t i = 0; i < fields[f].size(); ++i)
+			{
+				do
+				{
+					fields[f][i].second = Point<Real, DIM>(generator() % 1001 - 500.0, generator() % 1001 - 500.0, generator() % 1001 - 500.0);
+				} while (fields[f][i].second == zero_normal);
+				normalize<Real, DIM>(fields[f][i].second);
+			}
+		}
+
+		// construct the Kd-Tree
+		kdt::KDTree<kdt::KDTreePoint> tree;
+		{
+			std::vector<kdt::KDTreePoint> vertices;
+			vertices.reserve(points_normals.size());
+			for (size_t i = 0; i < points_normals.size(); ++i)
+			{
+				std::array<double, 3> a{points_normals[i].first[0], points_normals[i].first[1], points_normals[i].first[2]};
+				vertices.push_back(kdt::KDTreePoint(a));
+			}
+			tree.build(vertices);
+		}
+
+		// the samples live in the unit cube; cells spanning 4 finest octree nodes keep few candidates per cell
+		// while the mesh of a later iteration mostly falls in cells created by the earlier ones;
+		// a cell is kept while the mesh of any initialization of the last iteration fell into it
+		kdt::KnnCache<kdt::KDTreePoint> knn_cache(tree, p.neighbors, 4.0 / (1 << p.depth), std::max(p.initializations, 1));
+
+		// the octree and everything else that does not depend on the normals is built once
+		ReconstructionSession<Real, DIM> *session = new_reconstruction_session<Real, DIM>(poisson, points_normals, weight_samples);
+		if (!session)
+		{
+			if (poisson.telemetry)
+				fclose(poisson.telemetry);
+			return Mesh();
+		}
+
+		Mesh mesh;
+		if (fields.size() == 1)
+		{
+			std::vector<std::pair<Point<Real, DIM>, Normal<Real, DIM>>> &points_normals = fields[0];
+
+			// iterations
+			int epoch = 0;
+			while (epoch < p.iters)
+			{
+				++epoch;
+				if (p.verbose)
+					printf("Iter: %d\n", epoch);
+
+				std::vector<Point<Real, DIM>>().swap(mesh.first);
+				std::vector<std::vector<int>>().swap(mesh.second);
+
+				// Poisson reconstruction
+				mesh = session->reconstruct(points_normals);
+
+				double ave_max_diff = update_normals(mesh, points_normals, knn_cache);
+				if (p.verbose)
+					printf("normals variation %f\n", ave_max_diff);
+				if (ave_max_diff < p.variation_threshold)
+					break;
+			}
+
+			mesh = session->reconstruct(points_normals);
+		}
+		else
+		{
+			// the initializations that have not converged yet are reconstructed together, sharing the sweeps of the solver
+			std::vector<double> variations(fields.size(), std::numeric_limits<double>::max());
+			std::vector<size_t> active(fields.size());
+			for (size_t f = 0; f < fields.size(); ++f)
+				active[f] = f;
+
+			// iterations
+			int epoch = 0;
+			while (epoch < p.iters && !active.empty())
+			{
+				++epoch;
+				if (p.verbose)
+					printf("Iter: %d\n", epoch);
+
+				std::vector<const std::vector<std::pair<Point<Real, DIM>, Normal<Real, DIM>>> *> normal_fields(active.size());
+				for (size_t j = 0; j < active.size(); ++j)
+					normal_fields[j] = &fields[active[j]];
+				std::vector<Mesh> meshes = session->reconstruct(normal_fields);
+
+				std::vector<size_t> unconverged;
+				for (size_t j = 0; j < active.size(); ++j)
+				{
+					size_t f = active[j];
+					variations[f] = update_normals(meshes[j], fields[f], knn_cache);
+					if (p.verbose)
+						printf("normals variation of initialization %d: %f\n", (int)f, variations[f]);
+					if (variations[f] >= p.variation_threshold)
+						unconverged.push_back(f);
+				}
+				active.swap(unconverged);
+			}
+
+			size_t best = std::min_element(variations.begin(), variations.end()) - variations.begin();
+			if (p.verbose)
+				printf("best initialization: %d\n", (int)best);
+			mesh = session->reconstruct(fields[best]);
+		}
+		delete session;
+		if (poisson.telemetry)
+			fclose(poisson.telemetry);
+		// output_sample_points_and_normals<Real, DIM>("points_normals_samples.ply", points_normals, iXForm);
+
+		// back to the coordinates of the input points
+#pragma omp parallel for
+		for (int i = 0; i < (int)mesh.first.size(); ++i)
+			mesh.first[i] = iXForm * mesh.first[i];
+		return mesh;
+	}
+
+private:
+	// map the normals of the faces of the mesh to their nearest samples and return the average normal variation of the samples that change the most
+	double update_normals(const Mesh &mesh, std::vector<std::pair<Point<Real, 3>, Normal<Real, 3>>> &points_normals, kdt::KnnCache<kdt::KDTreePoint> &knn_cache) const
+	{
+		const unsigned int DIM = 3U;
+		const IPSRParameters &p = parameters_;
+		const Normal<Real, DIM> zero_normal(Point<Real, DIM>(0, 0, 0));
+
+		// compute face normals and centroids of the triangles
+		std::vector<int> triangles;
+		triangles.reserve(mesh.second.size());
+		for (size_t i = 0; i < mesh.second.size(); ++i)
+			if (mesh.second[i].size() == 3)
+				triangles.push_back((int)i);
+
+		std::vector<double> centroids(triangles.size() * 3);
+		std::vector<Point<Real, DIM>> normals(triangles.size());
+#pragma omp parallel for
+		for (int i = 0; i < (int)triangles.size(); i++)
+		{
+			const std::vector<int> &face = mesh.second[triangles[i]];
+			Point<Real, DIM> c = mesh.first[face[0]] + mesh.first[face[1]] + mesh.first[face[2]];
+			c /= 3;
+			for (unsigned int d = 0; d < DIM; ++d)
+				centroids[i * 3 + d] = c[d];
+			normals[i] = Point<Real, DIM>::CrossProduct(mesh.first[face[1]] - mesh.first[face[0]], mesh.first[face[2]] - mesh.first[face[0]]);
+		}
+
+		// map the face normals to the nearest sample points
+		std::vector<int> nearestSamples(triangles.size() * p.neighbors);
+		knn_cache.knnSearch(centroids.data(), (int)triangles.size(), nearestSamples.data());
+
+		// update sample point normals, gathering the faces of every sample so that the samples are independent
+		std::vector<int> sample_face_offsets, sample_faces;
+		invert_nearest_samples(nearestSamples, p.neighbors, points_normals.size(), sample_face_offsets, sample_faces);
+
+		std::vector<Normal<Real, DIM>> projective_normals(points_normals.size(), zero_normal);
+#pragma omp parallel for
+		for (int i = 0; i < (int)projective_normals.size(); ++i)
+		{
+			for (int j = sample_face_offsets[i]; j < sample_face_offsets[i + 1]; ++j)
+			{
+				const Point<Real, DIM> &n = normals[sample_faces[j]];
+				projective_normals[i].normal[0] += n[0];
+				projective_normals[i].normal[1] += n[1];
+				projective_normals[i].normal[2] += n[2];
+			}
+		}
+
+#pragma omp parallel for
+		for (int i = 0; i < (int)projective_normals.size(); ++i)
+			normalize<Real, DIM>(projective_normals[i]);
+
+		// compute the average normal variation of the samples that change the most
+		double ave_max_diff = normal_variation<Real, DIM>(points_normals, projective_normals, p.variation_fraction);
+
+#pragma omp parallel for
+		for (int i = 0; i < (int)points_normals.size(); ++i)
+			if (!(projective_normals[i] == zero_normal))
+				points_normals[i].second = projective_normals[i];
+
+		return ave_max_diff;
+	}
+
+	IPSRParameters parameters_;
+};
+
+#endif
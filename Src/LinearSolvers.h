@@ -35,44 +35,7 @@ template< class Type > inline double SquareDifference( const   Type* values1 , c
 
 // This is the conjugate gradients solver.
 // The assumption is that the class SPDOperator defines a method operator()( const Real* , Real* ) which corresponds to applying a symmetric positive-definite operator.
-template< class Real >
-struct CGScratch
-{
-	Real *r , *d , *q;
-	CGScratch( void ) : r(NULL) , d(NULL) , q(NULL) , _dim(0){ ; }
-	CGScratch( int dim ) : r(NULL) , d(NULL) , q(NULL){ resize(dim); }
-	~CGScratch( void ){ resize(0); }
-	void resize( int dim )
-	{
-		if( dim!=_dim )
-		{
-			if( r ) delete[] r ; r = NULL;
-			if( d ) delete[] d ; d = NULL;
-			if( q ) delete[] q ; q = NULL;
-			if( dim ) r = new Real[dim] , d = new Real[dim] , q = new Real[dim];
-			_dim = dim;
-		}
-	}
-protected:
-	int _dim;
-};
-template< class Real >
-struct PreconditionedCGScratch : public CGScratch< Real >
-{
-	Real *s;
-	PreconditionedCGScratch( void ) : CGScratch< Real >() , s(NULL){ ; }
-	PreconditionedCGScratch( int dim ) : CGScratch< Real >() { resize(dim); }
-	~PreconditionedCGScratch( void ){ resize(0); }
-	void resize( int dim )
-	{
-		if( dim!=CGScratch< Real >::_dim )
-		{
-			if( s ) delete[] s; s = NULL;
-			if( dim ) s = new Real[dim];
-		}
-		CGScratch< Real >::resize( dim );
-	}
-};
+// The scratch buffers CGScratch and PreconditionedCGScratch are defined in SparseMatrixInterface.h.
 template< class Real >
 struct DiagonalPreconditioner
 {
@@ -39,7 +39,8 @@ This file is edited by Fei Hou and Chiyu Wang, Institute of Software, Chinese Ac
 #define WEIGHT_DEGREE 2						  // The order of the B-Spline used to splat in the weights for density estimation
 #define NORMAL_DEGREE 2						  // The order of the B-Spline used to splat in the normals for constructing the Laplacian constraints
 #define DEFAULT_FEM_DEGREE 2				  // The default finite-element degree
-#define DEFAULT_FEM_BOUNDARY BOUNDARY_NEUMANN // The default finite-element boundary type							// The dimension of the system
+#define DEFAULT_FEM_BOUNDARY BOUNDARY_NEUMANN // The default finite-element boundary type
+#define MULTI_RHS_WIDTH 4					  // The number of normal fields whose systems are relaxed together by a batched reconstruction
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -47,138 +48,57 @@ This file is edited by Fei Hou and Chiyu Wang, Institute of Software, Chinese Ac
 #include <float.h>
 #include <vector>
 #include "MyMiscellany.h"
-#include "CmdLineParser.h"
 #include "PPolynomial.h"
 #include "FEMTree.h"
 #include "Ply.h"
 #include "PointStreamData.h"
-MessageWriter messageWriter;
-
 const float DefaultPointWeightMultiplier = 2.f;
 
-cmdLineParameter<char *>
-	In("in"),
-	Out("out"),
-	TempPath("temppath"),
-	MyOut("myout"),
-	TempDir("tempDir"),
-	VoxelGrid("voxel"),
-	Tree("tree"),
-	Transform("xForm");
-
-cmdLineReadable
-	Performance("performance"),
-	ShowResidual("showResidual"),
-	NoComments("noComments"),
-	PolygonMesh("polygonMesh"),
-	NonManifold("nonManifold"),
-	ASCII("ascii"),
-	Density("density"),
-	LinearFit("linearFit"),
-	PrimalVoxel("primalVoxel"),
-	ExactInterpolation("exact"),
-	Normals("normals"),
-	Colors("colors"),
-	Verbose("verbose");
-
-cmdLineParameter<int>
-#ifndef FAST_COMPILE
-	Degree("degree", DEFAULT_FEM_DEGREE),
-#endif // !FAST_COMPILE
-	Depth("depth", 8), NormalK("k", 0),
-	KernelDepth("kernelDepth"),
-	Iters("iters", 8),
-	FullDepth("fullDepth", 5),
-	BaseDepth("baseDepth", 0),
-	BaseVCycles("baseVCycles", 1),
-#ifndef FAST_COMPILE
-	BType("bType", DEFAULT_FEM_BOUNDARY + 1),
-#endif // !FAST_COMPILE
-	MaxMemoryGB("maxMemory", 0),
-	Threads("threads", omp_get_num_procs());
-
-cmdLineParameter<float>
-	DataX("data", 32.f),
-	SamplesPerNode("samplesPerNode", 1.5f),
-	Scale("scale", 1.1f),
-	Width("width", 0.f),
-	Confidence("confidence", 0.f),
-	ConfidenceBias("confidenceBias", 0.f),
-	CGSolverAccuracy("cgAccuracy", 1e-3f),
-	PointWeight("pointWeight");
-
-cmdLineReadable *params[] =
-	{
-#ifndef FAST_COMPILE
-		&Degree, &BType, &NormalK,
-#endif // !FAST_COMPILE
-		&In, &Depth, &Out, &Transform, &TempPath, &MyOut,
-		&Width,
-		&Scale, &Verbose, &CGSolverAccuracy, &NoComments,
-		&KernelDepth, &SamplesPerNode, &Confidence, &NonManifold, &PolygonMesh, &ASCII, &ShowResidual,
-		&ConfidenceBias,
-		&BaseDepth, &BaseVCycles,
-		&PointWeight,
-		&VoxelGrid, &Threads,
-		&Tree,
-		&Density,
-		&FullDepth,
-		&Iters,
-		&DataX,
-		&Colors,
-		&Normals,
-		&LinearFit,
-		&PrimalVoxel,
-		&TempDir,
-		&ExactInterpolation,
-		&Performance,
-		&MaxMemoryGB,
-		NULL};
-
-void ShowUsage(char *ex)
+// Parameters of a screened Poisson reconstruction, defaulting to the values of the PoissonRecon command line
+struct PoissonParameters
 {
-	printf("Usage: %s\n", ex);
-	printf("\t --%s <input points>\n", In.name);
-	printf("\t[--%s <ouput triangle mesh>]\n", Out.name);
-	printf("\t[--%s <ouput voxel grid>]\n", VoxelGrid.name);
-	printf("\t[--%s <ouput fem tree>]\n", Tree.name);
-#ifndef FAST_COMPILE
-	printf("\t[--%s <b-spline degree>=%d]\n", Degree.name, Degree.value);
-	printf("\t[--%s <boundary type>=%d]\n", BType.name, BType.value);
-	for (int i = 0; i < BOUNDARY_COUNT; i++)
-		printf("\t\t%d] %s\n", i + 1, BoundaryNames[i]);
-#endif // !FAST_COMPILE
-	printf("\t[--%s <maximum reconstruction depth>=%d]\n", Depth.name, Depth.value);
-	printf("\t[--%s <voxel width>]\n", Width.name);
-	printf("\t[--%s <full depth>=%d]\n", FullDepth.name, FullDepth.value);
-	printf("\t[--%s <coarse MG solver depth>=%d]\n", BaseDepth.name, BaseDepth.value);
-	printf("\t[--%s <coarse MG solver v-cycles>=%d]\n", BaseVCycles.name, BaseVCycles.value);
-	printf("\t[--%s <scale factor>=%f]\n", Scale.name, Scale.value);
-	printf("\t[--%s <minimum number of samples per node>=%f]\n", SamplesPerNode.name, SamplesPerNode.value);
-	printf("\t[--%s <interpolation weight>=%.3e * <b-spline degree>]\n", PointWeight.name, DefaultPointWeightMultiplier);
-	printf("\t[--%s <iterations>=%d]\n", Iters.name, Iters.value);
-	printf("\t[--%s]\n", ExactInterpolation.name);
-	printf("\t[--%s <pull factor>=%f]\n", DataX.name, DataX.value);
-	printf("\t[--%s]\n", Colors.name);
-	printf("\t[--%s]\n", Normals.name);
-#ifdef _OPENMP
-	printf("\t[--%s <num threads>=%d]\n", Threads.name, Threads.value);
-#endif // _OPENMP
-	printf("\t[--%s <normal confidence exponent>=%f]\n", Confidence.name, Confidence.value);
-	printf("\t[--%s <normal confidence bias exponent>=%f]\n", ConfidenceBias.name, ConfidenceBias.value);
-	printf("\t[--%s]\n", NonManifold.name);
-	printf("\t[--%s]\n", PolygonMesh.name);
-	printf("\t[--%s <cg solver accuracy>=%g]\n", CGSolverAccuracy.name, CGSolverAccuracy.value);
-	printf("\t[--%s <maximum memory (in GB)>=%d]\n", MaxMemoryGB.name, MaxMemoryGB.value);
-	printf("\t[--%s]\n", Performance.name);
-	printf("\t[--%s]\n", Density.name);
-	printf("\t[--%s]\n", LinearFit.name);
-	printf("\t[--%s]\n", PrimalVoxel.name);
-	printf("\t[--%s]\n", ASCII.name);
-	printf("\t[--%s]\n", NoComments.name);
-	printf("\t[--%s]\n", TempDir.name);
-	printf("\t[--%s]\n", Verbose.name);
-}
+	int depth;				 // maximum reconstruction depth
+	int kernelDepth;		 // depth of the kernel density estimator, depth-2 if negative
+	int fullDepth;			 // depth up to which the octree is complete
+	int baseDepth;			 // coarse multigrid solver depth, at most fullDepth
+	int baseVCycles;		 // coarse multigrid solver v-cycles
+	int iters;				 // Gauss-Seidel iterations per multigrid level
+	int pcgIters;			 // maximum preconditioned conjugate-gradient iterations solving the finest depth, 0 to relax it with Gauss-Seidel instead
+	int degree;				 // b-spline degree (1 or 2)
+	BoundaryType boundary;	 // b-spline boundary type
+	float samplesPerNode;	 // minimum number of samples per node
+	float scale;			 // ratio between the reconstruction cube and the bounding cube of the points
+	float confidence;		 // normal confidence exponent
+	float confidenceBias;	 // normal confidence bias exponent
+	float cgAccuracy;		 // conjugate-gradient solver accuracy
+	float residualTolerance; // relative residual ending the conjugate-gradient iterations
+	float pointWeight;		 // interpolation weight, DefaultPointWeightMultiplier * degree if negative
+	bool exactInterpolation; // use exact point interpolation instead of approximate
+	bool linearFit;			 // fit iso-vertices linearly instead of quadratically
+	bool nonManifold;		 // do not add barycenters to polygons
+	bool polygonMesh;		 // output polygons instead of triangles
+	bool density;			 // keep the density estimator for the iso-surface extraction
+	bool verbose;			 // print timings and statistics
+	bool showResidual;		 // print the multigrid residuals
+	bool matrixFree;		 // apply the stencil of interior nodes without samples instead of assembling their matrix rows
+	bool mixedPrecision;	 // store the Gauss-Seidel matrices in single precision and accumulate the relaxations in Real
+	bool cacheMatrices;		 // keep the Gauss-Seidel matrices of a reconstruction session instead of rebuilding them for every solve
+	bool concurrentSlices;	 // relax the slice blocks of a step of the Gauss-Seidel wavefront concurrently, with the same result as relaxing them in turn
+	bool scheduledSplats;	 // re-splat the normals node by node, one color of nodes at a time, instead of with atomic additions
+	bool mortonOrder;		 // build the sampling tree from the Morton-sorted points and return the samples in Morton order
+	FILE *telemetry;		 // if set, a JSON line describing the solve of every depth is written to this file
+
+	PoissonParameters()
+		: depth(8), kernelDepth(-1), fullDepth(5), baseDepth(0), baseVCycles(1), iters(8), pcgIters(0), degree(DEFAULT_FEM_DEGREE), boundary(DEFAULT_FEM_BOUNDARY),
+		  samplesPerNode(1.5f), scale(1.1f), confidence(0.f), confidenceBias(0.f), cgAccuracy(1e-3f), residualTolerance(1e-3f), pointWeight(-1.f),
+		  exactInterpolation(false), linearFit(false), nonManifold(false), polygonMesh(false), density(false), verbose(false), showResidual(false), matrixFree(false), mixedPrecision(false), cacheMatrices(false), concurrentSlices(false), scheduledSplats(true), mortonOrder(false), telemetry(NULL)
+	{
+	}
+
+	float screeningWeight(void) const { return pointWeight < 0 ? DefaultPointWeightMultiplier * degree : pointWeight; }
+	int kernelDensityDepth(void) const { return kernelDepth < 0 ? depth - 2 : std::min(kernelDepth, depth); }
+	int coarseSolverDepth(void) const { return std::min(baseDepth, fullDepth); }
+};
 
 double Weight(double v, double start, double end)
 {
@@ -203,9 +123,10 @@ template <unsigned int Dim, class Real>
 struct FEMTreeProfiler
 {
 	FEMTree<Dim, Real> &tree;
+	MessageWriter &messageWriter;
 	double t;
 
-	FEMTreeProfiler(FEMTree<Dim, Real> &t) : tree(t) { ; }
+	FEMTreeProfiler(FEMTree<Dim, Real> &t, MessageWriter &w) : tree(t), messageWriter(w) { ; }
 	void start(void) { t = Time(), FEMTree<Dim, Real>::ResetLocalMemoryUsage(); }
 	void print(const char *header) const
 	{
@@ -309,6 +230,28 @@ struct SystemDual<Dim, double>
 	SystemDual(Real w) : weight(w) {}
 	CumulativeDerivativeValues<Real, Dim, 0> operator()(const Point<Real, Dim> &p, const CumulativeDerivativeValues<Real, Dim, 0> &dValues) const { return dValues * weight; };
 };
+// The duals of the screening term when K right-hand sides are solved together
+template <unsigned int Dim, typename Real, unsigned int K>
+struct MultiConstraintDual
+{
+	Real target, weight;
+	MultiConstraintDual(Real t, Real w) : target(t), weight(w) {}
+	CumulativeDerivativeValues<Point<Real, K>, Dim, 0> operator()(const Point<Real, Dim> &p) const
+	{
+		Point<Real, K> value;
+		for (unsigned int k = 0; k < K; k++)
+			value[k] = target * weight;
+		return CumulativeDerivativeValues<Point<Real, K>, Dim, 0>(value);
+	};
+};
+template <unsigned int Dim, typename Real, unsigned int K>
+struct MultiSystemDual
+{
+	Real weight;
+	MultiSystemDual(Real w) : weight(w) {}
+	CumulativeDerivativeValues<Point<Real, K>, Dim, 0> operator()(const Point<Real, Dim> &p, const CumulativeDerivativeValues<Point<Real, K>, Dim, 0> &dValues) const { return dValues * weight; };
+	CumulativeDerivativeValues<double, Dim, 0> operator()(const Point<Real, Dim> &p, const CumulativeDerivativeValues<double, Dim, 0> &dValues) const { return dValues * weight; };
+};
 
 /*******************Modified by Fei Hou and Chiyu Wang*************************/
 
@@ -358,171 +301,222 @@ std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>> export_m
 	return std::make_pair(vertices, faces);
 }
 
-template <class Real, int Dim, class StreamDataInfo, class Vertex, unsigned int... FEMSigs>
-std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>> Execute(const std::vector<double> *weight_samples, int argc, char *argv[], const std::vector<std::pair<Point<Real, Dim>, typename StreamDataInfo::Type>> &points_normals, UIntPack<FEMSigs...>)
+// A reconstruction session keeps everything that only depends on the sample positions and weights
+// (the octree, the density-adaptive splats of the samples, the multigrid indexing and the screening
+// constraints), so that successive reconstructions that only change the normals reuse them.
+// Sessions own all their state, so several of them can run concurrently.
+template <class Real, unsigned int Dim>
+class ReconstructionSession
+{
+public:
+	virtual ~ReconstructionSession() {}
+	virtual std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>> reconstruct(const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &points_normals) = 0;
+	// Reconstructs a mesh for each of several normal fields of the samples, solving the systems of MULTI_RHS_WIDTH fields at a time
+	virtual std::vector<std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>>> reconstruct(const std::vector<const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> *> &normal_fields) = 0;
+};
+
+template <class Real, unsigned int Dim, class Vertex, unsigned int... FEMSigs>
+class _ReconstructionSession : public ReconstructionSession<Real, Dim>
 {
 	typedef UIntPack<FEMSigs...> Sigs;
 	typedef UIntPack<FEMSignature<FEMSigs>::Degree...> Degrees;
 	typedef UIntPack<FEMDegreeAndBType<NORMAL_DEGREE, DerivativeBoundary<FEMSignature<FEMSigs>::BType, 1>::BType>::Signature...> NormalSigs;
 	static const unsigned int DataSig = FEMDegreeAndBType<DATA_DEGREE, BOUNDARY_FREE>::Signature;
-	typedef Point<Real, 3> Color;
 	typedef typename FEMTree<Dim, Real>::template DensityEstimator<WEIGHT_DEGREE> DensityEstimator;
 	typedef typename FEMTree<Dim, Real>::template InterpolationInfo<Real, 0> InterpolationInfo;
-	typedef InputPointStreamWithData<Real, Dim, typename StreamDataInfo::Type> InputPointStream;
-	typedef TransformedInputPointStreamWithData<Real, Dim, typename StreamDataInfo::Type> XInputPointStream;
-	std::vector<char *> comments;
-	messageWriter(comments, "*************************************************************\n");
-	messageWriter(comments, "*************************************************************\n");
-	messageWriter(comments, "** Running Screened Poisson Reconstruction (Version %s) **\n", VERSION);
-	messageWriter(comments, "*************************************************************\n");
-	messageWriter(comments, "*************************************************************\n");
-
-	XForm<Real, Dim + 1> xForm, iXForm;
-	if (Transform.set)
+	typedef typename FEMTree<Dim, Real>::template InterpolationInfo<Point<Real, MULTI_RHS_WIDTH>, 0> MultiInterpolationInfo;
+	typedef std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>> Mesh;
+	typedef typename FEMTree<Dim, Real>::PointSample PointSample;
+	typedef typename FEMTree<Dim, Real>::SampleSplat SampleSplat;
+
+	PoissonParameters params;
+	MessageWriter messageWriter;
+	FEMTree<Dim, Real> tree;
+	std::vector<PointSample> samples;
+	std::vector<Normal<Real, Dim>> sampleNormals;
+	std::vector<SampleSplat> splats;
+	typename FEMTree<Dim, Real>::SplatSchedule splatSchedule; // the splats grouped so that the normals can be re-splatted without atomics
+	SparseNodeData<Point<Real, Dim>, NormalSigs> normalInfo;
+	DensityEstimator *density;
+	InterpolationInfo *iInfo;
+	MultiInterpolationInfo *multiIInfo; // the screening term of the batched solves, set on their first use
+	Real screeningWeight;
+	DenseNodeData<Real, Sigs> pointConstraints;
+	typename FEMTree<Dim, Real>::SystemCache systemCache; // the systems only depend on the tree and the samples, so they are shared by the solves
+	int solveDepth;
+	int solveCount; // the number of solves so far, identifying them in the telemetry
+
+public:
+	_ReconstructionSession(const PoissonParameters &parameters, const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &points_normals, const std::vector<double> &weight_samples) : params(parameters), tree(MEMORY_ALLOCATOR_BLOCK_SIZE), density(NULL), iInfo(NULL), multiIInfo(NULL), screeningWeight(0), systemCache(parameters.cacheMatrices), solveDepth(parameters.depth), solveCount(0)
 	{
-		FILE *fp = fopen(Transform.value, "r");
-		if (!fp)
+		messageWriter.echoSTDOUT = params.verbose;
+		FEMTreeProfiler<Dim, Real> profiler(tree, messageWriter);
+		Real pointWeightSum;
+		Real targetValue = (Real)0.5;
+
+		// Read in the samples
 		{
-			fprintf(stderr, "[WARNING] Could not read x-form from: %s\n", Transform.value);
-			xForm = XForm<Real, Dim + 1>::Identity();
+			profiler.start();
+			MemoryInputPointStreamWithData<Real, Dim, Normal<Real, Dim>> pointStream(points_normals.size(), points_normals.data());
+			int pointCount = FEMTreeInitializer<Dim, Real>::template Initialize<Normal<Real, Dim>>(tree.spaceRoot(), pointStream, params.depth, samples, sampleNormals, true, tree.nodeAllocator, tree.initializer(), NormalInfo<Real, Dim>::ProcessData);
+			for (size_t i = 0; i < samples.size(); i++)
+			{
+				double weight_sample = weight_samples[i];
+				samples[i].sample.weight = weight_sample;
+				samples[i].sample.data.coords[0] *= weight_sample;
+				samples[i].sample.data.coords[1] *= weight_sample;
+				samples[i].sample.data.coords[2] *= weight_sample;
+				sampleNormals[i].normal[0] *= weight_sample;
+				sampleNormals[i].normal[1] *= weight_sample;
+				sampleNormals[i].normal[2] *= weight_sample;
+			}
+			messageWriter("Input Points / Samples: %d / %d\n", pointCount, samples.size());
+			profiler.dumpOutput("# Read input into tree:");
 		}
-		else
+
+		tree.resetNodeIndices();
+
+		// Get the kernel density estimator
 		{
-			for (int i = 0; i < Dim + 1; i++)
-				for (int j = 0; j < Dim + 1; j++)
-				{
-					float f;
-					if (fscanf(fp, " %f ", &f) != 1)
-						fprintf(stderr, "[ERROR] Execute: Failed to read xform\n"), exit(0);
-					xForm(i, j) = (Real)f;
-				}
-			fclose(fp);
+			profiler.start();
+			density = tree.template setDensityEstimator<WEIGHT_DEGREE>(samples, params.kernelDensityDepth(), params.samplesPerNode, 1);
+			profiler.dumpOutput("#   Got kernel density:");
 		}
-	}
-	else
-		xForm = XForm<Real, Dim + 1>::Identity();
 
-	char str[1024];
-	for (int i = 0; params[i]; i++)
-		if (params[i]->set)
+		// Transform the Hermite samples into a vector field, recording where each sample is splatted
+		// (without a confidence bias, which sessions reject, the splat depths do not depend on the normals)
 		{
-			params[i]->writeValue(str);
-			if (strlen(str))
-				messageWriter(comments, "\t--%s %s\n", params[i]->name, str);
-			else
-				messageWriter(comments, "\t--%s\n", params[i]->name);
+			profiler.start();
+			normalInfo = tree.setNormalField(NormalSigs(), samples, sampleNormals, density, pointWeightSum, [](Real)
+											 { return (Real)0; }, &splats);
+			profiler.dumpOutput("#     Got normal field:");
+			messageWriter("Point weight / Estimated Area: %g / %g\n", pointWeightSum, samples.size() * pointWeightSum);
 		}
 
-	double startTime = Time();
-	Real isoValue = 0;
-
-	FEMTree<Dim, Real> tree(MEMORY_ALLOCATOR_BLOCK_SIZE);
-	FEMTreeProfiler<Dim, Real> profiler(tree);
-
-	if (Depth.set && Width.value > 0)
-	{
-		fprintf(stderr, "[WARNING] Both --%s and --%s set, ignoring --%s\n", Depth.name, Width.name, Width.name);
-		Width.value = 0;
-	}
-
-	int pointCount;
-
-	Real pointWeightSum;
-	std::vector<typename FEMTree<Dim, Real>::PointSample> *samples = new std::vector<typename FEMTree<Dim, Real>::PointSample>();
-	std::vector<typename StreamDataInfo::Type> *sampleData = NULL;
-	DensityEstimator *density = NULL;
-	SparseNodeData<Point<Real, Dim>, NormalSigs> *normalInfo = NULL;
-	Real targetValue = (Real)0.5;
+		if (!params.density)
+			delete density, density = NULL;
 
-	// Read in the samples (and color data)
-	{
-		profiler.start();
-		InputPointStream *pointStream = new MemoryInputPointStreamWithData<Real, Dim, typename StreamDataInfo::Type>(points_normals.size(), points_normals.data());
-		sampleData = new std::vector<typename StreamDataInfo::Type>();
-		/*char* ext = GetFileExtension(In.value );
-		if     ( !strcasecmp( ext , "bnpts" ) ) pointStream = new BinaryInputPointStreamWithData< Real , Dim , typename StreamDataInfo::Type >(In.value , StreamDataInfo::ReadBinary );
-		else if( !strcasecmp( ext , "ply"   ) ) pointStream = new    PLYInputPointStreamWithData< Real , Dim , typename StreamDataInfo::Type >(In.value , StreamDataInfo::PlyProperties , StreamDataInfo::PlyPropertyNum , StreamDataInfo::ValidPlyProperties );
-		else                                    pointStream = new  ASCIIInputPointStreamWithData< Real , Dim , typename StreamDataInfo::Type >(In.value , StreamDataInfo::ReadASCII );
-		delete[] ext;*/
-		XInputPointStream _pointStream(typename StreamDataInfo::Transform(xForm), *pointStream);
-		// if(Width.value>0 ) xForm = GetPointXForm< Real , Dim >( _pointStream , Width.value , (Real)(Scale.value>0 ? Scale.value : 1. ) , Depth.value ) * xForm;
-		// else                xForm = Scale.value>0 ? GetPointXForm< Real , Dim >( _pointStream , (Real)Scale.value ) * xForm : xForm;
+		// Trim the tree and prepare for multigrid
 		{
-			XInputPointStream _pointStream(typename StreamDataInfo::Transform(xForm), *pointStream);
-			if (Confidence.value > 0)
-				pointCount = FEMTreeInitializer<Dim, Real>::template Initialize<typename StreamDataInfo::Type>(tree.spaceRoot(), _pointStream, Depth.value, *samples, *sampleData, true, tree.nodeAllocator, tree.initializer(), [&](const Point<Real, Dim> &p, typename StreamDataInfo::Type &d)
-																											   { return (Real)pow(StreamDataInfo::ProcessDataWithConfidence(p, d), Confidence.value); });
-			else
-				pointCount = FEMTreeInitializer<Dim, Real>::template Initialize<typename StreamDataInfo::Type>(tree.spaceRoot(), _pointStream, Depth.value, *samples, *sampleData, true, tree.nodeAllocator, tree.initializer(), StreamDataInfo::ProcessData);
+			profiler.start();
+			constexpr int MAX_DEGREE = NORMAL_DEGREE > Degrees::Max() ? NORMAL_DEGREE : Degrees::Max();
+			tree.template finalizeForMultigrid<MAX_DEGREE>(params.fullDepth, typename FEMTree<Dim, Real>::template HasNormalDataFunctor<NormalSigs>(normalInfo), &normalInfo, density);
+			if (params.scheduledSplats)
+				splatSchedule = tree.setSplatSchedule(NormalSigs(), samples, splats);
+			profiler.dumpOutput("#       Finalized tree:");
 		}
-		iXForm = xForm.inverse();
-		delete pointStream;
-		for (size_t i = 0; i < samples->size(); i++)
+
+		// The interpolation constraints do not depend on the normals
+		pointConstraints = tree.initDenseNodeData(Sigs());
+		const Real pointWeight = (Real)params.screeningWeight();
+		screeningWeight = pointWeight * pointWeightSum;
+		if (pointWeight > 0)
 		{
-			double weight_sample = (*weight_samples)[i];
-			(*samples)[i].sample.weight = weight_sample;
-			(*samples)[i].sample.data.coords[0] *= weight_sample;
-			(*samples)[i].sample.data.coords[1] *= weight_sample;
-			(*samples)[i].sample.data.coords[2] *= weight_sample;
-			(*sampleData)[i].normal[0] *= weight_sample;
-			(*sampleData)[i].normal[1] *= weight_sample;
-			(*sampleData)[i].normal[2] *= weight_sample;
+			profiler.start();
+			if (params.exactInterpolation)
+				iInfo = FEMTree<Dim, Real>::template InitializeExactPointInterpolationInfo<Real, 0>(tree, samples, ConstraintDual<Dim, Real>(targetValue, screeningWeight), SystemDual<Dim, Real>(screeningWeight), true, false);
+			else
+				iInfo = FEMTree<Dim, Real>::template InitializeApproximatePointInterpolationInfo<Real, 0>(tree, samples, ConstraintDual<Dim, Real>(targetValue, screeningWeight), SystemDual<Dim, Real>(screeningWeight), true, 1);
+			tree.addInterpolationConstraints(pointConstraints, solveDepth, *iInfo);
+			profiler.dumpOutput("#Set point constraints:");
 		}
 
-		messageWriter("Input Points / Samples: %d / %d\n", pointCount, samples->size());
-		profiler.dumpOutput2(comments, "# Read input into tree:");
+		messageWriter("Leaf Nodes / Active Nodes / Ghost Nodes: %d / %d / %d\n", (int)tree.leaves(), (int)tree.nodes(), (int)tree.ghostNodes());
+		messageWriter("Memory Usage: %.3f MB\n", float(MemoryInfo::Usage()) / (1 << 20));
 	}
-	int kernelDepth = KernelDepth.set ? KernelDepth.value : Depth.value - 2;
-	if (kernelDepth > Depth.value)
+	~_ReconstructionSession()
 	{
-		fprintf(stderr, "[WARNING] %s can't be greater than %s: %d <= %d\n", KernelDepth.name, Depth.name, KernelDepth.value, Depth.value);
-		kernelDepth = Depth.value;
+		if (iInfo)
+			delete iInfo, iInfo = NULL;
+		if (multiIInfo)
+			delete multiIInfo, multiIInfo = NULL;
+		if (density)
+			delete density, density = NULL;
 	}
 
-	DenseNodeData<Real, Sigs> solution;
+	Mesh reconstruct(const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &points_normals)
 	{
-		DenseNodeData<Real, Sigs> constraints;
-		InterpolationInfo *iInfo = NULL;
-		int solveDepth = Depth.value;
+		FEMTreeProfiler<Dim, Real> profiler(tree, messageWriter);
+		double startTime = Time();
 
-		tree.resetNodeIndices();
+		DenseNodeData<Real, Sigs> constraints = setConstraints(points_normals, profiler);
 
-		// Get the kernel density estimator
+		// Solve the linear system
+		DenseNodeData<Real, Sigs> solution;
 		{
 			profiler.start();
-			density = tree.template setDensityEstimator<WEIGHT_DEGREE>(*samples, kernelDepth, SamplesPerNode.value, 1);
-			profiler.dumpOutput2(comments, "#   Got kernel density:");
+			typename FEMTree<Dim, Real>::SolverInfo sInfo = solverInfo();
+			typename FEMIntegrator::template System<Sigs, IsotropicUIntPack<Dim, 1>> F({0., 1.});
+			solution = tree.solveSystem(Sigs(), F, constraints, solveDepth, sInfo, iInfo);
+			profiler.dumpOutput("# Linear system solved:");
 		}
 
-		// Transform the Hermite samples into a vector field
+		Mesh mesh = extract(solution, profiler);
+		messageWriter("#          Total Solve: %9.1f (s), %9.1f (MB)\n", Time() - startTime, FEMTree<Dim, Real>::MaxMemoryUsage());
+		return mesh;
+	}
+
+	std::vector<Mesh> reconstruct(const std::vector<const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> *> &normal_fields)
+	{
+		FEMTreeProfiler<Dim, Real> profiler(tree, messageWriter);
+		double startTime = Time();
+
+		if (iInfo && !multiIInfo)
 		{
-			profiler.start();
-			normalInfo = new SparseNodeData<Point<Real, Dim>, NormalSigs>();
-			if (ConfidenceBias.value > 0)
-				*normalInfo = tree.setNormalField(NormalSigs(), *samples, *sampleData, density, pointWeightSum, [&](Real conf)
-												  { return (Real)(log(conf) * ConfidenceBias.value / log(1 << (Dim - 1))); });
+			const Real targetValue = (Real)0.5;
+			if (params.exactInterpolation)
+				multiIInfo = FEMTree<Dim, Real>::template InitializeExactPointInterpolationInfo<Point<Real, MULTI_RHS_WIDTH>, 0>(tree, samples, MultiConstraintDual<Dim, Real, MULTI_RHS_WIDTH>(targetValue, screeningWeight), MultiSystemDual<Dim, Real, MULTI_RHS_WIDTH>(screeningWeight), true, false);
 			else
-				*normalInfo = tree.setNormalField(NormalSigs(), *samples, *sampleData, density, pointWeightSum);
-#pragma omp parallel for
-			for (int i = 0; i < normalInfo->size(); i++)
-				(*normalInfo)[i] *= (Real)-1.;
-			profiler.dumpOutput2(comments, "#     Got normal field:");
-			messageWriter("Point weight / Estimated Area: %g / %g\n", pointWeightSum, pointCount * pointWeightSum);
+				multiIInfo = FEMTree<Dim, Real>::template InitializeApproximatePointInterpolationInfo<Point<Real, MULTI_RHS_WIDTH>, 0>(tree, samples, MultiConstraintDual<Dim, Real, MULTI_RHS_WIDTH>(targetValue, screeningWeight), MultiSystemDual<Dim, Real, MULTI_RHS_WIDTH>(screeningWeight), true, 1);
 		}
 
-		if (!Density.set)
-			delete density, density = NULL;
-		if (DataX.value <= 0 || (!Colors.set && !Normals.set))
-			delete sampleData, sampleData = NULL;
+		std::vector<Mesh> meshes;
+		meshes.reserve(normal_fields.size());
+		for (size_t first = 0; first < normal_fields.size(); first += MULTI_RHS_WIDTH)
+		{
+			// The fields of a batch share every sweep over the matrices; the lanes of a partial batch solve a zero system
+			size_t count = std::min<size_t>(MULTI_RHS_WIDTH, normal_fields.size() - first);
+			DenseNodeData<Real, Sigs> constraints[MULTI_RHS_WIDTH], solutions[MULTI_RHS_WIDTH];
+			for (size_t k = 0; k < MULTI_RHS_WIDTH; k++)
+				constraints[k] = k < count ? setConstraints(*normal_fields[first + k], profiler) : tree.initDenseNodeData(Sigs());
 
-		// Trim the tree and prepare for multigrid
+			{
+				profiler.start();
+				typename FEMTree<Dim, Real>::SolverInfo sInfo = solverInfo();
+				typename FEMIntegrator::template System<Sigs, IsotropicUIntPack<Dim, 1>> F({0., 1.});
+				tree.template solveSystems<MULTI_RHS_WIDTH>(Sigs(), F, constraints, solutions, solveDepth, sInfo, multiIInfo);
+				profiler.dumpOutput("# Linear systems solved:");
+			}
+
+			for (size_t k = 0; k < count; k++)
+				meshes.push_back(extract(solutions[k], profiler));
+		}
+		messageWriter("#          Total Solve: %9.1f (s), %9.1f (MB)\n", Time() - startTime, FEMTree<Dim, Real>::MaxMemoryUsage());
+		return meshes;
+	}
+
+protected:
+	// Splats the normals into the finalized tree and returns the constraints of the system
+	DenseNodeData<Real, Sigs> setConstraints(const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &points_normals, FEMTreeProfiler<Dim, Real> &profiler)
+	{
+		// Re-splat the new normals into the nodes of the finalized tree
 		{
 			profiler.start();
-			constexpr int MAX_DEGREE = NORMAL_DEGREE > Degrees::Max() ? NORMAL_DEGREE : Degrees::Max();
-			tree.template finalizeForMultigrid<MAX_DEGREE>(FullDepth.value, typename FEMTree<Dim, Real>::template HasNormalDataFunctor<NormalSigs>(*normalInfo), normalInfo, density);
-			profiler.dumpOutput2(comments, "#       Finalized tree:");
+#pragma omp parallel for
+			for (int i = 0; i < (int)sampleNormals.size(); i++)
+				sampleNormals[i] = points_normals[i].second;
+			if (params.scheduledSplats)
+				tree.resetNormalField(NormalSigs(), samples, sampleNormals, splats, splatSchedule, normalInfo);
+			else
+				tree.resetNormalField(NormalSigs(), samples, sampleNormals, splats, normalInfo);
+#pragma omp parallel for
+			for (int i = 0; i < normalInfo.size(); i++)
+				normalInfo[i] *= (Real)-1.;
+			profiler.dumpOutput("#     Got normal field:");
 		}
+
 		// Add the FEM constraints
+		DenseNodeData<Real, Sigs> constraints;
 		{
 			profiler.start();
 			constraints = tree.initDenseNodeData(Sigs());
@@ -539,415 +533,206 @@ std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>> Execute(
 					derivatives1[dd] = dd == d ? 1 : 0;
 				F.weights[d][TensorDerivatives<Derivatives1>::Index(derivatives1)][TensorDerivatives<Derivatives2>::Index(derivatives2)] = 1;
 			}
-			tree.addFEMConstraints(F, *normalInfo, constraints, solveDepth);
-			profiler.dumpOutput2(comments, "#  Set FEM constraints:");
-		}
-
-		// Free up the normal info
-		delete normalInfo, normalInfo = NULL;
-
-		// Add the interpolation constraints
-		if (PointWeight.value > 0)
-		{
-			// printf("PointWeight: %f")
-			profiler.start();
-			if (ExactInterpolation.set)
-				iInfo = FEMTree<Dim, Real>::template InitializeExactPointInterpolationInfo<Real, 0>(tree, *samples, ConstraintDual<Dim, Real>(targetValue, (Real)PointWeight.value * pointWeightSum), SystemDual<Dim, Real>((Real)PointWeight.value * pointWeightSum), true, false);
-			else
-				iInfo = FEMTree<Dim, Real>::template InitializeApproximatePointInterpolationInfo<Real, 0>(tree, *samples, ConstraintDual<Dim, Real>(targetValue, (Real)PointWeight.value * pointWeightSum), SystemDual<Dim, Real>((Real)PointWeight.value * pointWeightSum), true, 1);
-			tree.addInterpolationConstraints(constraints, solveDepth, *iInfo);
-			profiler.dumpOutput2(comments, "#Set point constraints:");
-		}
-
-		messageWriter("Leaf Nodes / Active Nodes / Ghost Nodes: %d / %d / %d\n", (int)tree.leaves(), (int)tree.nodes(), (int)tree.ghostNodes());
-		messageWriter("Memory Usage: %.3f MB\n", float(MemoryInfo::Usage()) / (1 << 20));
-
-		// Solve the linear system
-		{
-			profiler.start();
-			typename FEMTree<Dim, Real>::SolverInfo sInfo;
-			sInfo.cgDepth = 0, sInfo.cascadic = true, sInfo.vCycles = 1, sInfo.iters = Iters.value, sInfo.cgAccuracy = CGSolverAccuracy.value, sInfo.verbose = Verbose.set, sInfo.showResidual = ShowResidual.set, sInfo.showGlobalResidual = SHOW_GLOBAL_RESIDUAL_NONE, sInfo.sliceBlockSize = 1;
-			sInfo.baseDepth = BaseDepth.value, sInfo.baseVCycles = BaseVCycles.value;
-			typename FEMIntegrator::template System<Sigs, IsotropicUIntPack<Dim, 1>> F({0., 1.});
-			solution = tree.solveSystem(Sigs(), F, constraints, solveDepth, sInfo, iInfo);
-			profiler.dumpOutput2(comments, "# Linear system solved:");
+			tree.addFEMConstraints(F, normalInfo, constraints, solveDepth);
 			if (iInfo)
-				delete iInfo, iInfo = NULL;
+			{
+#pragma omp parallel for
+				for (int i = 0; i < (int)constraints.size(); i++)
+					constraints[i] += pointConstraints[i];
+			}
+			profiler.dumpOutput("#  Set FEM constraints:");
 		}
-	}
 
-	{
-		profiler.start();
-		double valueSum = 0, weightSum = 0;
-		typename FEMTree<Dim, Real>::template MultiThreadedEvaluator<Sigs, 0> evaluator(&tree, solution);
-#pragma omp parallel for reduction(+ \
-								   : valueSum, weightSum)
-		for (int j = 0; j < samples->size(); j++)
-		{
-			ProjectiveData<Point<Real, Dim>, Real> &sample = (*samples)[j].sample;
-			Real w = sample.weight;
-			if (w > 0)
-				weightSum += w, valueSum += evaluator.values(sample.data / sample.weight, omp_get_thread_num(), (*samples)[j].node)[0] * w;
-		}
-		isoValue = (Real)(valueSum / weightSum);
-		if (DataX.value <= 0 || (!Colors.set && !Normals.set))
-			delete samples, samples = NULL;
-		profiler.dumpOutput("Got average:");
-		messageWriter("Iso-Value: %e = %g / %g\n", isoValue, valueSum, weightSum);
+		return constraints;
 	}
-	if (Tree.set)
+
+	typename FEMTree<Dim, Real>::SolverInfo solverInfo(void)
 	{
-		FILE *fp = fopen(Tree.value, "wb");
-		if (!fp)
-			fprintf(stderr, "[ERROR] Failed to open file for writing: %s\n", Tree.value), exit(0);
-		FEMTree<Dim, Real>::WriteParameter(fp);
-		DenseNodeData<Real, Sigs>::WriteSignatures(fp);
-		tree.write(fp);
-		solution.write(fp);
-		fclose(fp);
+		typename FEMTree<Dim, Real>::SolverInfo sInfo;
+		sInfo.cgDepth = 0, sInfo.cascadic = true, sInfo.vCycles = 1, sInfo.iters = params.iters, sInfo.cgAccuracy = params.cgAccuracy, sInfo.verbose = params.verbose, sInfo.showResidual = params.showResidual, sInfo.showGlobalResidual = SHOW_GLOBAL_RESIDUAL_NONE, sInfo.sliceBlockSize = 1;
+		sInfo.baseDepth = params.coarseSolverDepth(), sInfo.baseVCycles = params.baseVCycles, sInfo.matrixFree = params.matrixFree, sInfo.mixedPrecision = params.mixedPrecision, sInfo.systemCache = &systemCache;
+		sInfo.concurrentSliceBlocks = params.concurrentSlices, sInfo.telemetry = params.telemetry, sInfo.solveId = solveCount++;
+		if (params.pcgIters > 0)
+			sInfo.pcgIters = params.pcgIters, sInfo.residualTolerance = params.residualTolerance;
+		return sInfo;
 	}
 
-	if (VoxelGrid.set)
+	// Extracts the iso-surface of a solution through the average value at the samples
+	Mesh extract(const DenseNodeData<Real, Sigs> &solution, FEMTreeProfiler<Dim, Real> &profiler)
 	{
-		FILE *fp = fopen(VoxelGrid.value, "wb");
-		if (!fp)
-			fprintf(stderr, "Failed to open voxel file for writing: %s\n", VoxelGrid.value);
-		else
+		Real isoValue = 0;
 		{
-			int res = 0;
 			profiler.start();
-			Pointer(Real) values = tree.template regularGridEvaluate<true>(solution, res, -1, PrimalVoxel.set);
-#pragma omp parallel for
-			for (int i = 0; i < res * res * res; i++)
-				values[i] -= isoValue;
-			profiler.dumpOutput("Got voxel grid:");
-			fwrite(&res, sizeof(int), 1, fp);
-			if (typeid(Real) == typeid(float))
-				fwrite(values, sizeof(float), res * res * res, fp);
-			else
+			double valueSum = 0, weightSum = 0;
+			typename FEMTree<Dim, Real>::template MultiThreadedEvaluator<Sigs, 0> evaluator(&tree, solution);
+#pragma omp parallel for reduction(+ \
+								   : valueSum, weightSum)
+			for (int j = 0; j < samples.size(); j++)
 			{
-				float *fValues = new float[res * res * res];
-				for (int i = 0; i < res * res * res; i++)
-					fValues[i] = float(values[i]);
-				fwrite(fValues, sizeof(float), res * res * res, fp);
-				delete[] fValues;
+				ProjectiveData<Point<Real, Dim>, Real> &sample = samples[j].sample;
+				Real w = sample.weight;
+				if (w > 0)
+					weightSum += w, valueSum += evaluator.values(sample.data / sample.weight, omp_get_thread_num(), samples[j].node)[0] * w;
 			}
-			fclose(fp);
-			DeletePointer(values);
+			isoValue = (Real)(valueSum / weightSum);
+			profiler.dumpOutput("Got average:");
+			messageWriter("Iso-Value: %e = %g / %g\n", isoValue, valueSum, weightSum);
 		}
-	}
-
-	std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>> mesh_model;
-	if (Out.set)
-	{
-		/*char tempHeader[1024];
-		{
-			char tempPath[1024];
-			tempPath[0] = 0;
-			if(TempDir.set ) strcpy( tempPath , TempDir.value );
-			else SetTempDirectory( tempPath , sizeof(tempPath) );
-			if( strlen(tempPath)==0 ) sprintf( tempPath , ".%c" , FileSeparator );
-			if( tempPath[ strlen( tempPath )-1 ]==FileSeparator ) sprintf( tempHeader , "%sPR_" , tempPath );
-			else                                                  sprintf( tempHeader , "%s%cPR_" , tempPath , FileSeparator );
-		}*/
 
 		CoredVectorMeshData<Vertex> mesh;
-
-		profiler.start();
-		typename IsoSurfaceExtractor<Dim, Real, Vertex>::IsoStats isoStats;
-		if (sampleData)
 		{
-			SparseNodeData<ProjectiveData<typename StreamDataInfo::Type, Real>, IsotropicUIntPack<Dim, DataSig>> _sampleData = tree.template setDataField<DataSig, false>(*samples, *sampleData, (DensityEstimator *)NULL);
-			for (const RegularTreeNode<Dim, FEMTreeNodeData> *n = tree.tree().nextNode(); n; n = tree.tree().nextNode(n))
-			{
-				ProjectiveData<typename StreamDataInfo::Type, Real> *clr = _sampleData(n);
-				if (clr)
-					(*clr) *= (Real)pow(DataX.value, tree.depth(n));
-			}
-			delete sampleData, sampleData = NULL;
-
-			isoStats = IsoSurfaceExtractor<Dim, Real, Vertex>::template Extract<typename StreamDataInfo::Type>(Sigs(), UIntPack<WEIGHT_DEGREE>(), UIntPack<DataSig>(), tree, density, &_sampleData, solution, isoValue, mesh, StreamDataInfo::template VertexSetter<Vertex>::SetValue, StreamDataInfo::template VertexSetter<Vertex>::SetData, !LinearFit.set, !NonManifold.set, PolygonMesh.set, false);
+			profiler.start();
+			typename IsoSurfaceExtractor<Dim, Real, Vertex>::IsoStats isoStats;
+			isoStats = IsoSurfaceExtractor<Dim, Real, Vertex>::template Extract<Normal<Real, Dim>>(Sigs(), UIntPack<WEIGHT_DEGREE>(), UIntPack<DataSig>(), tree, density, NULL, solution, isoValue, mesh, NormalInfo<Real, Dim>::template VertexSetter<Vertex>::SetValue, NormalInfo<Real, Dim>::template VertexSetter<Vertex>::SetData, !params.linearFit, !params.nonManifold, params.polygonMesh, false);
+			messageWriter("Vertices / Polygons: %d / %d\n", mesh.outOfCorePointCount() + mesh.inCorePoints.size(), mesh.polygonCount());
+			if (params.polygonMesh)
+				profiler.dumpOutput("#         Got polygons:");
+			else
+				profiler.dumpOutput("#        Got triangles:");
 		}
-		else
-			isoStats = IsoSurfaceExtractor<Dim, Real, Vertex>::template Extract<typename StreamDataInfo::Type>(Sigs(), UIntPack<WEIGHT_DEGREE>(), UIntPack<DataSig>(), tree, density, NULL, solution, isoValue, mesh, StreamDataInfo::template VertexSetter<Vertex>::SetValue, StreamDataInfo::template VertexSetter<Vertex>::SetData, !LinearFit.set, !NonManifold.set, PolygonMesh.set, false);
-		messageWriter("Vertices / Polygons: %d / %d\n", mesh.outOfCorePointCount() + mesh.inCorePoints.size(), mesh.polygonCount());
-		messageWriter("Corners / Vertices / Edges / Surface / Set Table / Copy Finer: %.1f / %.1f / %.1f / %.1f / %.1f / %.1f (s)\n", isoStats.cornersTime, isoStats.verticesTime, isoStats.edgesTime, isoStats.surfaceTime, isoStats.setTableTime, isoStats.copyFinerTime);
-		if (PolygonMesh.set)
-			profiler.dumpOutput2(comments, "#         Got polygons:");
-		else
-			profiler.dumpOutput2(comments, "#        Got triangles:");
-
-		mesh_model = export_mesh<Vertex, Real, Dim>(&mesh);
+		return export_mesh<Vertex, Real, Dim>(&mesh);
 	}
-	if (density)
-		delete density, density = NULL;
-	messageWriter(comments, "#          Total Solve: %9.1f (s), %9.1f (MB)\n", Time() - startTime, FEMTree<Dim, Real>::MaxMemoryUsage());
+};
 
-	return mesh_model;
+template <class Real, unsigned int Dim, class Vertex, unsigned int... FEMSigs>
+ReconstructionSession<Real, Dim> *_new_reconstruction_session(const PoissonParameters &params, const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &points_normals, const std::vector<double> &weight_samples, UIntPack<FEMSigs...>)
+{
+	return new _ReconstructionSession<Real, Dim, Vertex, FEMSigs...>(params, points_normals, weight_samples);
 }
 
-#ifndef FAST_COMPILE
-template <class Real, unsigned int Dim, class InfoType, class Vertex>
-std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>> Execute(const std::vector<double> *weight_samples, int argc, char *argv[], const std::vector<std::pair<Point<Real, Dim>, typename InfoType::Type>> &points_normals)
+// Creates a session for the samples returned by sample_points. The caller owns (and deletes) the returned session.
+// Returns NULL if the parameters are not supported, e.g. a positive confidenceBias.
+template <class Real, unsigned int Dim>
+ReconstructionSession<Real, Dim> *new_reconstruction_session(const PoissonParameters &params, const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &points_normals, const std::vector<double> &weight_samples)
 {
-	switch (BType.value)
+	typedef FullPlyVertex<float, Dim, false, false, false> Vertex;
+#ifdef ARRAY_DEBUG
+	fprintf(stderr, "[WARNING] Array debugging enabled\n");
+#endif // ARRAY_DEBUG
+
+	if (params.kernelDepth > params.depth)
+		fprintf(stderr, "[WARNING] Kernel depth can't be greater than depth: %d <= %d\n", params.kernelDepth, params.depth);
+	if (params.baseDepth > params.fullDepth)
+		fprintf(stderr, "[WARNING] Base depth must be smaller than full depth: %d <= %d\n", params.baseDepth, params.fullDepth);
+	// The splat depths are recorded once for all the normal fields, while a confidence bias would make them depend on the normals
+	if (params.confidenceBias > 0)
 	{
-	case BOUNDARY_FREE + 1:
+		fprintf(stderr, "[ERROR] Reconstruction sessions do not support a confidence bias: %g\n", params.confidenceBias);
+		return NULL;
+	}
+
+#ifdef FAST_COMPILE
+	static const int Degree = DEFAULT_FEM_DEGREE;
+	static const BoundaryType BType = DEFAULT_FEM_BOUNDARY;
+	if (params.degree != Degree || params.boundary != BType)
+		fprintf(stderr, "[WARNING] Compiled for degree-%d, boundary-%s _only_\n", Degree, BoundaryNames[BType]);
+	return _new_reconstruction_session<Real, Dim, Vertex>(params, points_normals, weight_samples, IsotropicUIntPack<Dim, FEMDegreeAndBType<Degree, BType>::Signature>());
+#else  // !FAST_COMPILE
+	switch (params.boundary)
 	{
-		switch (Degree.value)
+	case BOUNDARY_FREE:
+		switch (params.degree)
 		{
 		case 1:
-			return Execute<Real, Dim, InfoType, Vertex>(weight_samples, argc, argv, points_normals, IsotropicUIntPack<Dim, FEMDegreeAndBType<1, BOUNDARY_FREE>::Signature>());
+			return _new_reconstruction_session<Real, Dim, Vertex>(params, points_normals, weight_samples, IsotropicUIntPack<Dim, FEMDegreeAndBType<1, BOUNDARY_FREE>::Signature>());
 		case 2:
-			return Execute<Real, Dim, InfoType, Vertex>(weight_samples, argc, argv, points_normals, IsotropicUIntPack<Dim, FEMDegreeAndBType<2, BOUNDARY_FREE>::Signature>());
-			//			case 3: return Execute< Real , InfoType , Vertex >( weight_samples, argc , argv , points_normals,IsotropicUIntPack< Dim , FEMDegreeAndBType< 3 , BOUNDARY_FREE >::Signature >() );
-			//			case 4: return Execute< Real , InfoType , Vertex >(weight_samples,  argc , argv , points_normals,IsotropicUIntPack< Dim , FEMDegreeAndBType< 4 , BOUNDARY_FREE >::Signature >() );
+			return _new_reconstruction_session<Real, Dim, Vertex>(params, points_normals, weight_samples, IsotropicUIntPack<Dim, FEMDegreeAndBType<2, BOUNDARY_FREE>::Signature>());
 		default:
-			fprintf(stderr, "[ERROR] Only B-Splines of degree 1 - 2 are supported"); // return EXIT_FAILURE;
-			return std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>>();
+			fprintf(stderr, "[ERROR] Only B-Splines of degree 1 - 2 are supported");
+			return NULL;
 		}
-	}
-	case BOUNDARY_NEUMANN + 1:
-	{
-		switch (Degree.value)
+	case BOUNDARY_NEUMANN:
+		switch (params.degree)
 		{
 		case 1:
-			return Execute<Real, Dim, InfoType, Vertex>(weight_samples, argc, argv, points_normals, IsotropicUIntPack<Dim, FEMDegreeAndBType<1, BOUNDARY_NEUMANN>::Signature>());
+			return _new_reconstruction_session<Real, Dim, Vertex>(params, points_normals, weight_samples, IsotropicUIntPack<Dim, FEMDegreeAndBType<1, BOUNDARY_NEUMANN>::Signature>());
 		case 2:
-			return Execute<Real, Dim, InfoType, Vertex>(weight_samples, argc, argv, points_normals, IsotropicUIntPack<Dim, FEMDegreeAndBType<2, BOUNDARY_NEUMANN>::Signature>());
-			//			case 3: return Execute< Real , InfoType , Vertex >(weight_samples,  argc , argv , points_normals,IsotropicUIntPack< Dim , FEMDegreeAndBType< 3 , BOUNDARY_NEUMANN >::Signature >() );
-			//			case 4: return Execute< Real , InfoType , Vertex >(weight_samples,  argc , argv , points_normals,IsotropicUIntPack< Dim , FEMDegreeAndBType< 4 , BOUNDARY_NEUMANN >::Signature >() );
+			return _new_reconstruction_session<Real, Dim, Vertex>(params, points_normals, weight_samples, IsotropicUIntPack<Dim, FEMDegreeAndBType<2, BOUNDARY_NEUMANN>::Signature>());
 		default:
-			fprintf(stderr, "[ERROR] Only B-Splines of degree 1 - 2 are supported"); // return EXIT_FAILURE;
-			return std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>>();
+			fprintf(stderr, "[ERROR] Only B-Splines of degree 1 - 2 are supported");
+			return NULL;
 		}
-	}
-	case BOUNDARY_DIRICHLET + 1:
-	{
-		switch (Degree.value)
+	case BOUNDARY_DIRICHLET:
+		switch (params.degree)
 		{
 		case 1:
-			return Execute<Real, Dim, InfoType, Vertex>(weight_samples, argc, argv, points_normals, IsotropicUIntPack<Dim, FEMDegreeAndBType<1, BOUNDARY_DIRICHLET>::Signature>());
+			return _new_reconstruction_session<Real, Dim, Vertex>(params, points_normals, weight_samples, IsotropicUIntPack<Dim, FEMDegreeAndBType<1, BOUNDARY_DIRICHLET>::Signature>());
 		case 2:
-			return Execute<Real, Dim, InfoType, Vertex>(weight_samples, argc, argv, points_normals, IsotropicUIntPack<Dim, FEMDegreeAndBType<2, BOUNDARY_DIRICHLET>::Signature>());
-			//			case 3: return Execute< Real , InfoType , Vertex >(weight_samples, argc , argv , points_normals,IsotropicUIntPack< Dim , FEMDegreeAndBType< 3 , BOUNDARY_DIRICHLET >::Signature >() );
-			//			case 4: return Execute< Real , InfoType , Vertex >(weight_samples, argc , argv , points_normals,IsotropicUIntPack< Dim , FEMDegreeAndBType< 4 , BOUNDARY_DIRICHLET >::Signature >() );
+			return _new_reconstruction_session<Real, Dim, Vertex>(params, points_normals, weight_samples, IsotropicUIntPack<Dim, FEMDegreeAndBType<2, BOUNDARY_DIRICHLET>::Signature>());
 		default:
-			fprintf(stderr, "[ERROR] Only B-Splines of degree 1 - 2 are supported"); // return EXIT_FAILURE;
-			return std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>>();
+			fprintf(stderr, "[ERROR] Only B-Splines of degree 1 - 2 are supported");
+			return NULL;
 		}
-	}
 	default:
-		fprintf(stderr, "[ERROR] Not a valid boundary type: %d\n", BType.value); // return EXIT_FAILURE;
-		return std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>>();
-	}
-}
-#endif // !FAST_COMPILE
-
-template <class Real, unsigned int Dim>
-std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>> poisson_reconstruction(int argc, char *argv[], const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &points_normals, const std::vector<double> *weight_samples)
-{
-	Timer timer;
-#ifdef ARRAY_DEBUG
-	fprintf(stderr, "[WARNING] Array debugging enabled\n");
-#endif // ARRAY_DEBUG
-
-	cmdLineParse(argc - 1, &argv[1], params);
-	if (MaxMemoryGB.value > 0)
-		SetPeakMemoryMB(MaxMemoryGB.value << 10);
-	omp_set_num_threads(Threads.value > 1 ? Threads.value : 1);
-	messageWriter.echoSTDOUT = Verbose.set;
-
-	if (!In.set)
-	{
-		ShowUsage(argv[0]);
-		return std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>>();
+		fprintf(stderr, "[ERROR] Not a valid boundary type: %d\n", (int)params.boundary);
+		return NULL;
 	}
-	if (DataX.value <= 0)
-		Normals.set = Colors.set = false;
-	if (BaseDepth.value > FullDepth.value)
-	{
-		if (BaseDepth.set)
-			fprintf(stderr, "[WARNING] Base depth must be smaller than full depth: %d <= %d\n", BaseDepth.value, FullDepth.value);
-		BaseDepth.value = FullDepth.value;
-	}
-
-	std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>> mesh;
-
-#ifdef FAST_COMPILE
-	static const int Degree = DEFAULT_FEM_DEGREE;
-	static const BoundaryType BType = DEFAULT_FEM_BOUNDARY;
-	typedef IsotropicUIntPack<Dim, FEMDegreeAndBType<Degree, BType>::Signature> FEMSigs;
-	fprintf(stderr, "[WARNING] Compiled for degree-%d, boundary-%s, %s-precision _only_\n", Degree, BoundaryNames[BType], sizeof(Real) == 4 ? "single" : "double");
-	if (!PointWeight.set)
-		PointWeight.value = DefaultPointWeightMultiplier * Degree;
-	if (Normals.set)
-		if (Colors.set)
-			if (Density.set)
-				Execute<Real, NormalAndColorInfo<Real, Dim>, FullPlyVertex<float, Dim, true, true, true>>(argc, argv, FEMSigs());
-			else
-				Execute<Real, NormalAndColorInfo<Real, Dim>, FullPlyVertex<float, Dim, true, false, true>>(argc, argv, FEMSigs());
-		else if (Density.set)
-			Execute<Real, NormalInfo<Real, Dim>, FullPlyVertex<float, Dim, true, true, false>>(argc, argv, FEMSigs());
-		else
-			Execute<Real, NormalInfo<Real, Dim>, FullPlyVertex<float, Dim, true, false, false>>(argc, argv, FEMSigs());
-	else if (Colors.set)
-		if (Density.set)
-			Execute<Real, NormalAndColorInfo<Real, Dim>, FullPlyVertex<float, Dim, false, true, true>>(argc, argv, FEMSigs());
-		else
-			Execute<Real, NormalAndColorInfo<Real, Dim>, FullPlyVertex<float, Dim, false, false, true>>(argc, argv, FEMSigs());
-	else if (Density.set)
-		Execute<Real, NormalInfo<Real, Dim>, FullPlyVertex<float, DIMENSION, false, true, false>>(argc, argv, FEMSigs());
-	else
-		Execute<Real, NormalInfo<Real, Dim>, FullPlyVertex<float, DIMENSION, false, false, false>>(argc, argv, FEMSigs());
-#else  // !FAST_COMPILE
-	if (!PointWeight.set)
-		PointWeight.value = DefaultPointWeightMultiplier * Degree.value;
-	mesh = Execute<Real, Dim, NormalInfo<Real, Dim>, FullPlyVertex<float, Dim, false, false, false>>(weight_samples, argc, argv, points_normals);
 #endif // FAST_COMPILE
-	if (Performance.set)
-	{
-		printf("Time (Wall/CPU): %.2f / %.2f\n", timer.wallTime(), timer.cpuTime());
-		printf("Peak Memory (MB): %d\n", MemoryInfo::PeakMemoryUsageMB());
-	}
-	return mesh;
 }
 
+// Samples the points by the octree (one sample per occupied finest node, weighted by the points it merges),
+// in the unit cube given by the bounding cube of the points scaled by params.scale; iXForm maps the unit cube back.
 template <class Real, unsigned int Dim, class StreamDataInfo>
-std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> _sample_points(int argc, char *argv[], const std::vector<std::pair<Point<Real, Dim>, typename StreamDataInfo::Type>> &points_normals, XForm<Real, Dim + 1> &iXForm, std::vector<double> *weight_samples)
+std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> _sample_points(const PoissonParameters &params, const std::vector<std::pair<Point<Real, Dim>, typename StreamDataInfo::Type>> &points_normals, XForm<Real, Dim + 1> &iXForm, std::vector<double> &weight_samples)
 {
-	typedef typename FEMTree<Dim, Real>::template DensityEstimator<WEIGHT_DEGREE> DensityEstimator;
-	typedef typename FEMTree<Dim, Real>::template InterpolationInfo<Real, 0> InterpolationInfo;
-	typedef InputPointStreamWithData<Real, Dim, typename StreamDataInfo::Type> InputPointStream;
 	typedef TransformedInputPointStreamWithData<Real, Dim, typename StreamDataInfo::Type> XInputPointStream;
-	std::vector<char *> comments;
-
-	XForm<Real, Dim + 1> xForm;
-	if (Transform.set)
-	{
-		FILE *fp = fopen(Transform.value, "r");
-		if (!fp)
-		{
-			fprintf(stderr, "[WARNING] Could not read x-form from: %s\n", Transform.value);
-			xForm = XForm<Real, Dim + 1>::Identity();
-		}
-		else
-		{
-			for (int i = 0; i < Dim + 1; i++)
-				for (int j = 0; j < Dim + 1; j++)
-				{
-					float f;
-					if (fscanf(fp, " %f ", &f) != 1)
-						fprintf(stderr, "[ERROR] Execute: Failed to read xform\n"), exit(0);
-					xForm(i, j) = (Real)f;
-				}
-			fclose(fp);
-		}
-	}
-	else
-		xForm = XForm<Real, Dim + 1>::Identity();
-
-	char str[1024];
-	for (int i = 0; params[i]; i++)
-		if (params[i]->set)
-		{
-			params[i]->writeValue(str);
-			if (strlen(str))
-				messageWriter(comments, "\t--%s %s\n", params[i]->name, str);
-			else
-				messageWriter(comments, "\t--%s\n", params[i]->name);
-		}
-
-	double startTime = Time();
-	Real isoValue = 0;
 
+	MessageWriter messageWriter;
+	messageWriter.echoSTDOUT = params.verbose;
 	FEMTree<Dim, Real> tree(MEMORY_ALLOCATOR_BLOCK_SIZE);
-	FEMTreeProfiler<Dim, Real> profiler(tree);
+	FEMTreeProfiler<Dim, Real> profiler(tree, messageWriter);
 
-	if (Depth.set && Width.value > 0)
+	std::vector<typename FEMTree<Dim, Real>::PointSample> samples;
+	std::vector<typename StreamDataInfo::Type> sampleData;
+
+	profiler.start();
+	MemoryInputPointStreamWithData<Real, Dim, typename StreamDataInfo::Type> pointStream(points_normals.size(), points_normals.data());
+	XForm<Real, Dim + 1> xForm = XForm<Real, Dim + 1>::Identity();
+	if (params.scale > 0)
 	{
-		fprintf(stderr, "[WARNING] Both --%s and --%s set, ignoring --%s\n", Depth.name, Width.name, Width.name);
-		Width.value = 0;
+		XInputPointStream _pointStream(typename StreamDataInfo::Transform(xForm), pointStream);
+		xForm = GetPointXForm<Real, Dim>(_pointStream, (Real)params.scale) * xForm;
 	}
-
 	int pointCount;
-
-	std::vector<typename FEMTree<Dim, Real>::PointSample> *samples = new std::vector<typename FEMTree<Dim, Real>::PointSample>();
-	std::vector<typename StreamDataInfo::Type> *sampleData = NULL;
-
-	// Read in the samples (and color data)
 	{
-		profiler.start();
-		InputPointStream *pointStream = new MemoryInputPointStreamWithData<Real, Dim, typename StreamDataInfo::Type>(points_normals.size(), points_normals.data());
-		sampleData = new std::vector<typename StreamDataInfo::Type>();
-
-		XInputPointStream _pointStream(typename StreamDataInfo::Transform(xForm), *pointStream);
-		if (Width.value > 0)
-			xForm = GetPointXForm<Real, Dim>(_pointStream, Width.value, (Real)(Scale.value > 0 ? Scale.value : 1.), Depth.value) * xForm;
+		XInputPointStream _pointStream(typename StreamDataInfo::Transform(xForm), pointStream);
+		const float confidence = params.confidence;
+		std::function<Real(const Point<Real, Dim> &, typename StreamDataInfo::Type &)> processData = StreamDataInfo::ProcessData;
+		if (confidence > 0)
+			processData = [confidence](const Point<Real, Dim> &p, typename StreamDataInfo::Type &d)
+			{ return (Real)pow(StreamDataInfo::ProcessDataWithConfidence(p, d), confidence); };
+		if (params.mortonOrder)
+			pointCount = FEMTreeInitializer<Dim, Real>::template MortonInitialize<typename StreamDataInfo::Type>(tree.spaceRoot(), _pointStream, params.depth, samples, sampleData, true, tree.nodeAllocator, tree.initializer(), processData);
 		else
-			xForm = Scale.value > 0 ? GetPointXForm<Real, Dim>(_pointStream, (Real)Scale.value) * xForm : xForm;
-		{
-			XInputPointStream _pointStream(typename StreamDataInfo::Transform(xForm), *pointStream);
-			if (Confidence.value > 0)
-				pointCount = FEMTreeInitializer<Dim, Real>::template Initialize<typename StreamDataInfo::Type>(tree.spaceRoot(), _pointStream, Depth.value, *samples, *sampleData, true, tree.nodeAllocator, tree.initializer(), [&](const Point<Real, Dim> &p, typename StreamDataInfo::Type &d)
-																											   { return (Real)pow(StreamDataInfo::ProcessDataWithConfidence(p, d), Confidence.value); });
-			else
-				pointCount = FEMTreeInitializer<Dim, Real>::template Initialize<typename StreamDataInfo::Type>(tree.spaceRoot(), _pointStream, Depth.value, *samples, *sampleData, true, tree.nodeAllocator, tree.initializer(), StreamDataInfo::ProcessData);
-		}
-		iXForm = xForm.inverse();
-		delete pointStream;
-
-		std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> sample_points(samples->size());
+			pointCount = FEMTreeInitializer<Dim, Real>::template Initialize<typename StreamDataInfo::Type>(tree.spaceRoot(), _pointStream, params.depth, samples, sampleData, true, tree.nodeAllocator, tree.initializer(), processData);
+	}
+	iXForm = xForm.inverse();
+	messageWriter("Input Points / Samples: %d / %d\n", pointCount, samples.size());
+	profiler.dumpOutput("# Read input into tree:");
 
-		weight_samples->resize(samples->size());
-		for (size_t i = 0; i < samples->size(); i++)
-		{
-			double weight_sample = (*samples)[i].sample.weight;
-			Point<Real, Dim> p;
-			p[0] = (*samples)[i].sample.data.coords[0] / weight_sample;
-			p[1] = (*samples)[i].sample.data.coords[1] / weight_sample;
-			p[2] = (*samples)[i].sample.data.coords[2] / weight_sample;
-			Normal<Real, Dim> n;
-			n.normal[0] = (*sampleData)[i].normal[0] / weight_sample;
-			n.normal[1] = (*sampleData)[i].normal[1] / weight_sample;
-			n.normal[2] = (*sampleData)[i].normal[2] / weight_sample;
-			sample_points[i] = std::make_pair(p, n);
-			(*weight_samples)[i] = weight_sample;
-		}
-		delete samples;
-		delete sampleData;
-		return sample_points;
+	std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> sample_points(samples.size());
+	weight_samples.resize(samples.size());
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		double weight_sample = samples[i].sample.weight;
+		Point<Real, Dim> p;
+		p[0] = samples[i].sample.data.coords[0] / weight_sample;
+		p[1] = samples[i].sample.data.coords[1] / weight_sample;
+		p[2] = samples[i].sample.data.coords[2] / weight_sample;
+		Normal<Real, Dim> n;
+		n.normal[0] = sampleData[i].normal[0] / weight_sample;
+		n.normal[1] = sampleData[i].normal[1] / weight_sample;
+		n.normal[2] = sampleData[i].normal[2] / weight_sample;
+		sample_points[i] = std::make_pair(p, n);
+		weight_samples[i] = weight_sample;
 	}
+	return sample_points;
 }
 template <class Real, unsigned int Dim>
-std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> sample_points(int argc, char *argv[], const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &points_normals, XForm<Real, Dim + 1> &iXForm, std::vector<double> *weight_samples)
+std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> sample_points(const PoissonParameters &params, const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &points_normals, XForm<Real, Dim + 1> &iXForm, std::vector<double> &weight_samples)
 {
 #ifdef ARRAY_DEBUG
 	fprintf(stderr, "[WARNING] Array debugging enabled\n");
 #endif // ARRAY_DEBUG
-
-	cmdLineParse(argc - 1, &argv[1], params);
-	if (MaxMemoryGB.value > 0)
-		SetPeakMemoryMB(MaxMemoryGB.value << 10);
-	omp_set_num_threads(Threads.value > 1 ? Threads.value : 1);
-	messageWriter.echoSTDOUT = Verbose.set;
-
-	if (!In.set)
-	{
-		ShowUsage(argv[0]);
-		return std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>>();
-	}
-	if (DataX.value <= 0)
-		Normals.set = Colors.set = false;
-	if (BaseDepth.value > FullDepth.value)
-	{
-		if (BaseDepth.set)
-			fprintf(stderr, "[WARNING] Base depth must be smaller than full depth: %d <= %d\n", BaseDepth.value, FullDepth.value);
-		BaseDepth.value = FullDepth.value;
-	}
-
-	if (!PointWeight.set)
-		PointWeight.value = DefaultPointWeightMultiplier * Degree.value;
-
-	return _sample_points<Real, Dim, NormalInfo<Real, Dim>>(argc, argv, points_normals, iXForm, weight_samples);
+	return _sample_points<Real, Dim, NormalInfo<Real, Dim>>(params, points_normals, iXForm, weight_samples);
 }
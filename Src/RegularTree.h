@@ -33,6 +33,9 @@ DAMAGE.
 #include "BinaryNode.h"
 #include "Window.h"
 #include <functional>
+#if defined(_WIN32) || defined(_WIN64)
+#include <intrin.h>
+#endif // _WIN32 || _WIN64
 
 #ifdef USE_DEEP_TREE_NODES
 template< unsigned int Dim , class NodeData , class DepthAndOffsetType=unsigned int >
@@ -53,6 +56,12 @@ public:
 	static RegularTreeNode* NewBrood( Allocator< RegularTreeNode >* nodeAllocator , std::function< void ( RegularTreeNode& ) > Initializer=std::function< void ( RegularTreeNode& ) >() );
 	static void ResetDepthAndOffset( RegularTreeNode* root , int d , int off[Dim] );
 	int initChildren( Allocator< RegularTreeNode >* nodeAllocator , std::function< void ( RegularTreeNode& ) > Initializer=std::function< void ( RegularTreeNode& ) >() );
+	// If ThreadSafe, the children are built privately and published with a compare-and-swap, so that threads can refine the tree concurrently without locking.
+	// Returns whether this call created the children. A brood that loses the race to another thread is abandoned.
+	template< bool ThreadSafe >
+	int initChildren( Allocator< RegularTreeNode >* nodeAllocator , std::function< void ( RegularTreeNode& ) > Initializer=std::function< void ( RegularTreeNode& ) >() );
+	// Loads the children with acquire semantics, so that a brood published by another thread through initChildren< true > is seen initialized.
+	RegularTreeNode* acquireChildren( void ) const;
 
 	void cleanChildren( Allocator< RegularTreeNode >* nodeAllocator );
 	~RegularTreeNode( void );
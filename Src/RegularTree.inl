@@ -146,6 +146,46 @@ int RegularTreeNode< Dim , NodeData , DepthAndOffsetType >::initChildren( Alloca
 	return 1;
 }
 template< unsigned int Dim , class NodeData , class DepthAndOffsetType >
+template< bool ThreadSafe >
+int RegularTreeNode< Dim , NodeData , DepthAndOffsetType >::initChildren( Allocator< RegularTreeNode >* nodeAllocator , std::function< void ( RegularTreeNode& ) > Initializer )
+{
+	if( !ThreadSafe ) return initChildren( nodeAllocator , Initializer );
+	if( acquireChildren() ) return 0;
+
+	// The allocator hands out per-thread blocks, so the brood can be built without synchronization
+	RegularTreeNode* brood = nodeAllocator ? nodeAllocator->newElements( 1<<Dim ) : new RegularTreeNode[ 1<<Dim ];
+	if( !brood ) fprintf( stderr , "[ERROR] RegularTreeNode::initChildren: Failed to initialize children in RegularTreeNode::initChildren\n" ) , exit(0);
+	for( int idx=0 ; idx<(1<<Dim) ; idx++ )
+	{
+		brood[idx].parent = this;
+		brood[idx].children = NULL;
+		if( Initializer ) Initializer( brood[idx] );
+		brood[idx]._depth = _depth+1;
+		for( int d=0 ; d<Dim ; d++ ) brood[idx]._offset[d] = (_offset[d]<<1) | ( (idx>>d) & 1 );
+	}
+
+	// The compare-and-swap is a full barrier, so the brood is initialized by the time other threads see it
+#if defined(_WIN32) || defined(_WIN64)
+	bool published = _InterlockedCompareExchangePointer( (void* volatile*)&children , brood , NULL )==NULL;
+#else // !_WIN32 && !_WIN64
+	bool published = __sync_bool_compare_and_swap( &children , (RegularTreeNode*)NULL , brood );
+#endif // _WIN32 || _WIN64
+	if( published ) return 1;
+	// Nodes taken from the allocator cannot be returned to it, so a losing brood is simply abandoned
+	if( !nodeAllocator ) delete[] brood;
+	return 0;
+}
+template< unsigned int Dim , class NodeData , class DepthAndOffsetType >
+RegularTreeNode< Dim , NodeData , DepthAndOffsetType >* RegularTreeNode< Dim , NodeData , DepthAndOffsetType >::acquireChildren( void ) const
+{
+#if defined(_WIN32) || defined(_WIN64)
+	// The interlocked functions are full barriers, and a compare-and-swap against NULL with NULL never modifies the pointer
+	return (RegularTreeNode*)_InterlockedCompareExchangePointer( (void* volatile*)&children , NULL , NULL );
+#else // !_WIN32 && !_WIN64
+	return __atomic_load_n( &children , __ATOMIC_ACQUIRE );
+#endif // _WIN32 || _WIN64
+}
+template< unsigned int Dim , class NodeData , class DepthAndOffsetType >
 template< class MergeFunctor >
 void RegularTreeNode< Dim , NodeData , DepthAndOffsetType >::merge( RegularTreeNode* node , MergeFunctor& f )
 {
@@ -490,10 +530,9 @@ unsigned int RegularTreeNode< Dim , NodeData , DepthAndOffsetType >::NeighborKey
 		{
 			if( pNeighbors[pi] )
 			{
-				if( !pNeighbors[pi]->children )
-#pragma omp critical ( RegularTreeNode__NeighborKey__Run )
-					if( !pNeighbors[pi]->children ) pNeighbors[pi]->initChildren( nodeAllocator , Initializer );
-				cNeighbors[ci] = pNeighbors[pi]->children + ( cornerIndex | ( ( _i&1)<<(Dim-1) ) );
+				RegularTreeNode* children = pNeighbors[pi]->acquireChildren();
+				if( !children ) pNeighbors[pi]->template initChildren< true >( nodeAllocator , Initializer ) , children = pNeighbors[pi]->acquireChildren();
+				cNeighbors[ci] = children + ( cornerIndex | ( ( _i&1)<<(Dim-1) ) );
 				count++;
 			}
 			else cNeighbors[ci] = NULL;
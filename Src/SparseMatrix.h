@@ -30,6 +30,11 @@ DAMAGE.
 
 #include "SparseMatrixInterface.h"
 #include "Array.h"
+// The AVX2 kernels are opt-in (-mavx2 or /arch:AVX2); their Gauss-Seidel rows are summed in a different order than the scalar ones
+#if defined( __AVX2__ ) && !defined( ARRAY_DEBUG )
+#include <immintrin.h>
+#define CSR_SPARSE_MATRIX_AVX2
+#endif // __AVX2__ && !ARRAY_DEBUG
 
 template< class T , class IndexType=int > class SparseMatrix : public SparseMatrixInterface< T , ConstPointer( MatrixEntry< T , IndexType > ) >
 {
@@ -100,5 +105,115 @@ public:
 	template< class const_iterator >
 	static SparseMatrix Transpose( const SparseMatrixInterface< T , const_iterator >& At , size_t outRows , T (*TransposeFunction)( const T& )=NULL );
 };
+
+// Iterates over the entries of a row of a CSRSparseMatrix, exposing each entry through "->N" and "->Value" like a MatrixEntry pointer
+template< class T , class IndexType >
+class CSRSparseMatrixIterator
+{
+	ConstPointer( IndexType ) _columns;
+	ConstPointer( T ) _values;
+public:
+	struct EntryReference
+	{
+		MatrixEntry< T , IndexType > entry;
+		const MatrixEntry< T , IndexType >* operator -> ( void ) const { return &entry; }
+	};
+	CSRSparseMatrixIterator( void ) : _columns( NullPointer( IndexType ) ) , _values( NullPointer( T ) ) {}
+	CSRSparseMatrixIterator( ConstPointer( IndexType ) columns , ConstPointer( T ) values ) : _columns( columns ) , _values( values ) {}
+	MatrixEntry< T , IndexType > operator * ( void ) const { return MatrixEntry< T , IndexType >( *_columns , *_values ); }
+	EntryReference operator -> ( void ) const { EntryReference r ; r.entry = **this ; return r; }
+	CSRSparseMatrixIterator& operator ++ ( void ){ _columns++ , _values++ ; return *this; }
+	CSRSparseMatrixIterator  operator ++ ( int ){ CSRSparseMatrixIterator temp = *this ; _columns++ , _values++ ; return temp; }
+	bool operator == ( const CSRSparseMatrixIterator& iter ) const { return _values==iter._values; }
+	bool operator != ( const CSRSparseMatrixIterator& iter ) const { return _values!=iter._values; }
+};
+
+// A sparse matrix in compressed-row form: the entries of all rows are stored contiguously in one column-index array and one value array,
+// and the entries of row r are those in [ rowOffsets[r] , rowOffsets[r+1] ).
+template< class T , class IndexType=int > class CSRSparseMatrix : public SparseMatrixInterface< T , CSRSparseMatrixIterator< T , IndexType > >
+{
+public:
+	typedef SparseMatrixInterface< T , CSRSparseMatrixIterator< T , IndexType > > Interface;
+	typedef CSRSparseMatrixIterator< T , IndexType > RowIterator;
+
+	size_t rowNum;
+	Pointer( size_t ) rowOffsets;
+	Pointer( IndexType ) columns;
+	Pointer( T ) values;
+
+	static void Swap( CSRSparseMatrix& M1 , CSRSparseMatrix& M2 )
+	{
+		std::swap( M1.rowNum , M2.rowNum );
+		std::swap( M1.rowOffsets , M2.rowOffsets );
+		std::swap( M1.columns , M2.columns );
+		std::swap( M1.values , M2.values );
+	}
+
+	CSRSparseMatrix( void );
+	CSRSparseMatrix( const CSRSparseMatrix& M );
+	CSRSparseMatrix( CSRSparseMatrix&& M );
+	template< class T2 , class IndexType2 >
+	CSRSparseMatrix( const SparseMatrix< T2 , IndexType2 >& M );
+	~CSRSparseMatrix();
+	CSRSparseMatrix& operator = ( CSRSparseMatrix&& M );
+	CSRSparseMatrix& operator = ( const CSRSparseMatrix& M );
+	template< class T2 , class IndexType2 >
+	CSRSparseMatrix& operator = ( const SparseMatrix< T2 , IndexType2 >& M );
+
+	// The product A * B, with the entries of each row in the order in which their columns are first reached
+	template< class A_const_iterator , class B_const_iterator >
+	static CSRSparseMatrix Multiply( const SparseMatrixInterface< T , A_const_iterator >& A , const SparseMatrixInterface< T , B_const_iterator >& B );
+	// The transpose, with outRows rows and the entries of each row sorted by column
+	CSRSparseMatrix transpose( size_t outRows ) const;
+
+	template< class T2 > void operator()( const T2* in , T2* out ) const { multiply( in , out ); }
+
+	inline RowIterator begin( size_t row ) const { return RowIterator( columns + rowOffsets[row] , values + rowOffsets[row] ); }
+	inline RowIterator end  ( size_t row ) const { return RowIterator( columns + rowOffsets[row+1] , values + rowOffsets[row+1] ); }
+	inline size_t rows   ( void )       const { return rowNum; }
+	inline size_t rowSize( size_t idx ) const { return rowOffsets[idx+1] - rowOffsets[idx]; }
+	inline size_t entries( void )       const { return rowNum ? rowOffsets[rowNum] : 0; }
+
+	// Writes the entries of a row in place: row[e] = MatrixEntry( N , Value ) sets the e-th column index and value, converting the value to T
+	struct RowWriter
+	{
+		struct EntryReference
+		{
+			IndexType& N;
+			T& Value;
+			template< class T2 , class IndexType2 >
+			EntryReference& operator = ( const MatrixEntry< T2 , IndexType2 >& e ){ N = (IndexType)e.N , Value = (T)e.Value ; return *this; }
+		};
+		Pointer( IndexType ) columns;
+		Pointer( T ) values;
+		EntryReference operator[] ( size_t e ) const { return EntryReference{ columns[e] , values[e] }; }
+	};
+	inline RowWriter rowWriter( size_t row ){ RowWriter w ; w.columns = columns + rowOffsets[row] , w.values = values + rowOffsets[row] ; return w; }
+
+	// Allocates the row offsets (set to zero) and, if entries is positive, the entries
+	void resize( size_t rowNum , size_t entries=0 );
+	// Turns the row sizes stored in rowOffsets[1..rowNum] into offsets and allocates the entries
+	void setRowOffsetsFromSizes( void );
+
+	// The sum of the products of the entries in the row with the corresponding entries of x
+	template< class T2 > T2 rowDot( size_t row , ConstPointer( T2 ) x ) const { return _RowDot( columns , values , rowOffsets[row] , rowOffsets[row+1] , x ); }
+
+	template< class T2 > void multiply( ConstPointer( T2 ) In , Pointer( T2 ) Out , int multiplyFlag=0 ) const;
+	template< class T2 > void multiply(      Pointer( T2 ) In , Pointer( T2 ) Out , int multiplyFlag=0 ) const { multiply( ( ConstPointer( T2 ) )In , Out , multiplyFlag ); }
+	void setDiagonalR( Pointer( T ) diagonal ) const;
+	// Relaxes the unknown of a single row
+	template< class T2 > void gsRow( size_t row , ConstPointer( T ) diagonal , ConstPointer( T2 ) b , Pointer( T2 ) x , bool dReciprocal ) const;
+	template< class T2 > void gsIteration( const std::vector< std::vector< int > >& multiColorIndices , ConstPointer( T ) diagonal , ConstPointer( T2 ) b , Pointer( T2 ) x , bool forward , bool dReciprocal ) const;
+	// The Gauss-Seidel iteration for rows stored in color-contiguous order: the rows of the c-th color are those in [ colorStarts[c] , colorStarts[c+1] )
+	template< class T2 > void gsColorIteration( const std::vector< int >& colorStarts , ConstPointer( T ) diagonal , ConstPointer( T2 ) b , Pointer( T2 ) x , bool forward , bool dReciprocal ) const;
+protected:
+	template< class T2 >
+	static T2 _RowDot( ConstPointer( IndexType ) columns , ConstPointer( T ) values , size_t begin , size_t end , ConstPointer( T2 ) x );
+#ifdef CSR_SPARSE_MATRIX_AVX2
+	// Gather-based kernels for the common case of int indices and matching scalar types
+	static float  _RowDot( const int* columns , const float*  values , size_t begin , size_t end , const float*  x );
+	static double _RowDot( const int* columns , const double* values , size_t begin , size_t end , const double* x );
+#endif // CSR_SPARSE_MATRIX_AVX2
+};
 #include "SparseMatrix.inl"
 #endif /* __SPARSEMATRIX_HPP */
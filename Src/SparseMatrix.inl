@@ -29,6 +29,7 @@ DAMAGE.
 #include <float.h>
 #include <complex>
 #include <unordered_map>
+#include <algorithm>
 
 ///////////////////
 //  SparseMatrix //
@@ -250,8 +251,10 @@ SparseMatrix< T , IndexType > SparseMatrix< T , IndexType >::operator * ( const
 	const SparseMatrix& A = *this;
 	size_t aCols = 0 , aRows = A.rowNum;
 	size_t bCols = 0 , bRows = B.rowNum;
-	for( int i=0 ; i<A.rowNum ; i++ ) for( int j=0 ; j<A.rowSizes[i] ; j++ ) if( aCols<=A[i][j].N ) aCols = A[i][j].N+1;
-	for( int i=0 ; i<B.rowNum ; i++ ) for( int j=0 ; j<B.rowSizes[i] ; j++ ) if( bCols<=B[i][j].N ) bCols = B[i][j].N+1;
+#pragma omp parallel for reduction( max : aCols )
+	for( long long i=0 ; i<(long long)A.rowNum ; i++ ) for( size_t j=0 ; j<A.rowSizes[i] ; j++ ) if( aCols<=(size_t)A[i][j].N ) aCols = A[i][j].N+1;
+#pragma omp parallel for reduction( max : bCols )
+	for( long long i=0 ; i<(long long)B.rowNum ; i++ ) for( size_t j=0 ; j<B.rowSizes[i] ; j++ ) if( bCols<=(size_t)B[i][j].N ) bCols = B[i][j].N+1;
 	if( bRows<aCols ) fprintf( stderr , "[Error] SparseMatrix::operator *: Matrix sizes do not support multiplication %lld x %lld * %lld x %lld\n" , (unsigned long long)aRows , (unsigned long long)aCols , (unsigned long long)bRows , (unsigned long long)bCols ) , exit( 0 );
 
 	out.resize( (int)aRows );
@@ -350,44 +353,20 @@ SparseMatrix< T , IndexType > SparseMatrix< T , IndexType >::operator - ( const
 template< class T , class IndexType >
 SparseMatrix< T , IndexType > SparseMatrix< T , IndexType >::transpose( T (*TransposeFunction)( const T& ) ) const
 {
-	SparseMatrix A;
 	const SparseMatrix& At = *this;
-	size_t aRows = 0 , aCols = At.rowNum;
-	for( int i=0 ; i<At.rowNum ; i++ ) for( int j=0 ; j<At.rowSizes[i] ; j++ ) if( aRows<=At[i][j].N ) aRows = At[i][j].N+1;
-
-	A.resize( aRows );
-	for( int i=0 ; i<aRows ; i++ ) A.rowSizes[i] = 0;
-#pragma omp parallel for
-	for( int i=0 ; i<At.rowNum ; i++ ) for( int j=0 ; j<At.rowSizes[i] ; j++ )
-#pragma omp atomic
-		A.rowSizes[ At[i][j].N ]++;
-#pragma omp parallel for
-	for( int i=0 ; i<A.rowNum ; i++ )
-	{
-		size_t t = A.rowSizes[i];
-		A.rowSizes[i] = 0;
-		A.setRowSize( i , t );
-		A.rowSizes[i] = 0;
-	}
-	if( TransposeFunction ) for( int i=0 ; i<At.rowNum ; i++ ) for( int j=0 ; j<At.rowSizes[i] ; j++ )
-	{
-		int ii = At[i][j].N;
-		A[ii][ A.rowSizes[ii]++ ] = MatrixEntry< T , IndexType >( i , TransposeFunction( At[i][j].Value ) );
-	}
-	else for( int i=0 ; i<At.rowNum ; i++ ) for( int j=0 ; j<At.rowSizes[i] ; j++ )
-	{
-		int ii = At[i][j].N;
-		A[ii][ A.rowSizes[ii]++ ] = MatrixEntry< T , IndexType >( i , At[i][j].Value );
-	}
-	return A;
+	size_t aRows = 0;
+#pragma omp parallel for reduction( max : aRows )
+	for( long long i=0 ; i<(long long)At.rowNum ; i++ ) for( size_t j=0 ; j<At.rowSizes[i] ; j++ ) if( aRows<=(size_t)At[i][j].N ) aRows = At[i][j].N+1;
+	return transpose( aRows , TransposeFunction );
 }
 template< class T , class IndexType >
 SparseMatrix< T , IndexType > SparseMatrix< T , IndexType >::transpose( size_t aRows , T (*TransposeFunction)( const T& ) ) const
 {
 	SparseMatrix A;
 	const SparseMatrix& At = *this;
-	size_t _aRows = 0 , aCols = At.rowNum;
-	for( int i=0 ; i<At.rowNum ; i++ ) for( int j=0 ; j<At.rowSizes[i] ; j++ ) if( aCols<=At[i][j].N ) _aRows = At[i][j].N+1;
+	size_t _aRows = 0;
+#pragma omp parallel for reduction( max : _aRows )
+	for( long long i=0 ; i<(long long)At.rowNum ; i++ ) for( size_t j=0 ; j<At.rowSizes[i] ; j++ ) if( _aRows<=(size_t)At[i][j].N ) _aRows = At[i][j].N+1;
 	if( _aRows>aRows )
 	{
 		fprintf( stderr , "[Error] SparseMatrix::transpose: prescribed output dimension too low: %d < %zu\n" , (int)aRows , _aRows );
@@ -408,18 +387,22 @@ SparseMatrix< T , IndexType > SparseMatrix< T , IndexType >::transpose( size_t a
 		A.setRowSize( i , t );
 		A.rowSizes[i] = 0;
 	}
-	if( TransposeFunction )
-		for( int i=0 ; i<At.rowNum ; i++ ) for( int j=0 ; j<At.rowSizes[i] ; j++ )
-		{
-			int ii = At[i][j].N;
-			A[ii][ A.rowSizes[ii]++ ] = MatrixEntry< T , IndexType >( i , TransposeFunction( At[i][j].Value ) );
-		}
-	else
-		for( int i=0 ; i<At.rowNum ; i++ ) for( int j=0 ; j<At.rowSizes[i] ; j++ )
-		{
-			int ii = At[i][j].N;
-			A[ii][ A.rowSizes[ii]++ ] = MatrixEntry< T , IndexType >( i , At[i][j].Value );
-		}
+	// Scatter the entries in parallel and then sort every row by column, which is the order in which a serial scatter would have stored them
+#pragma omp parallel for
+	for( int i=0 ; i<At.rowNum ; i++ ) for( int j=0 ; j<At.rowSizes[i] ; j++ )
+	{
+		int ii = At[i][j].N;
+		size_t idx;
+#pragma omp atomic capture
+		idx = A.rowSizes[ii]++;
+		A[ii][idx] = MatrixEntry< T , IndexType >( i , TransposeFunction ? TransposeFunction( At[i][j].Value ) : At[i][j].Value );
+	}
+#pragma omp parallel for
+	for( int i=0 ; i<A.rowNum ; i++ ) if( A.rowSizes[i] )
+	{
+		MatrixEntry< T , IndexType >* row = &A[i][0];
+		std::sort( row , row+A.rowSizes[i] , []( const MatrixEntry< T , IndexType >& e1 , const MatrixEntry< T , IndexType >& e2 ){ return e1.N<e2.N; } );
+	}
 	return A;
 }
 
@@ -529,3 +512,313 @@ SparseMatrix< T , IndexType > SparseMatrix< T , IndexType >::Transpose( const Sp
 		}
 	return true;
 }
+
+//////////////////////
+//  CSRSparseMatrix //
+//////////////////////
+template< class T , class IndexType >
+CSRSparseMatrix< T , IndexType >::CSRSparseMatrix( void )
+{
+	rowNum = 0;
+	rowOffsets = NullPointer( size_t );
+	columns = NullPointer( IndexType );
+	values = NullPointer( T );
+}
+template< class T , class IndexType >
+CSRSparseMatrix< T , IndexType >::CSRSparseMatrix( const CSRSparseMatrix& M )
+{
+	rowNum = 0;
+	rowOffsets = NullPointer( size_t );
+	columns = NullPointer( IndexType );
+	values = NullPointer( T );
+	*this = M;
+}
+template< class T , class IndexType >
+CSRSparseMatrix< T , IndexType >::CSRSparseMatrix( CSRSparseMatrix&& M )
+{
+	rowNum = 0;
+	rowOffsets = NullPointer( size_t );
+	columns = NullPointer( IndexType );
+	values = NullPointer( T );
+	Swap( *this , M );
+}
+template< class T , class IndexType >
+template< class T2 , class IndexType2 >
+CSRSparseMatrix< T , IndexType >::CSRSparseMatrix( const SparseMatrix< T2 , IndexType2 >& M )
+{
+	rowNum = 0;
+	rowOffsets = NullPointer( size_t );
+	columns = NullPointer( IndexType );
+	values = NullPointer( T );
+	*this = M;
+}
+template< class T , class IndexType >
+CSRSparseMatrix< T , IndexType >::~CSRSparseMatrix( void ){ resize( 0 ); }
+
+template< class T , class IndexType >
+CSRSparseMatrix< T , IndexType >& CSRSparseMatrix< T , IndexType >::operator = ( CSRSparseMatrix&& M )
+{
+	Swap( *this , M );
+	return *this;
+}
+template< class T , class IndexType >
+CSRSparseMatrix< T , IndexType >& CSRSparseMatrix< T , IndexType >::operator = ( const CSRSparseMatrix& M )
+{
+	if( &M==this ) return *this;
+	resize( M.rowNum , M.entries() );
+	if( rowNum )
+	{
+		memcpy( rowOffsets , M.rowOffsets , sizeof( size_t ) * ( rowNum+1 ) );
+		memcpy( columns , M.columns , sizeof( IndexType ) * entries() );
+		memcpy( values , M.values , sizeof( T ) * entries() );
+	}
+	return *this;
+}
+template< class T , class IndexType >
+template< class T2 , class IndexType2 >
+CSRSparseMatrix< T , IndexType >& CSRSparseMatrix< T , IndexType >::operator = ( const SparseMatrix< T2 , IndexType2 >& M )
+{
+	resize( M.rowNum );
+	for( size_t i=0 ; i<rowNum ; i++ ) rowOffsets[i+1] = M.rowSizes[i];
+	setRowOffsetsFromSizes();
+#pragma omp parallel for
+	for( long long i=0 ; i<(long long)rowNum ; i++ ) for( size_t j=0 ; j<M.rowSizes[i] ; j++ )
+	{
+		columns[ rowOffsets[i]+j ] = (IndexType)M[i][j].N;
+		values [ rowOffsets[i]+j ] = (T)M[i][j].Value;
+	}
+	return *this;
+}
+
+template< class T , class IndexType >
+template< class A_const_iterator , class B_const_iterator >
+CSRSparseMatrix< T , IndexType > CSRSparseMatrix< T , IndexType >::Multiply( const SparseMatrixInterface< T , A_const_iterator >& A , const SparseMatrixInterface< T , B_const_iterator >& B )
+{
+	CSRSparseMatrix M;
+	size_t aCols = 0 , aRows = A.rows();
+	size_t bCols = 0 , bRows = B.rows();
+	for( size_t i=0 ; i<A.rows() ; i++ ) for( A_const_iterator iter=A.begin(i) ; iter!=A.end(i) ; iter++ ) if( aCols<=(size_t)iter->N ) aCols = iter->N+1;
+	for( size_t i=0 ; i<B.rows() ; i++ ) for( B_const_iterator iter=B.begin(i) ; iter!=B.end(i) ; iter++ ) if( bCols<=(size_t)iter->N ) bCols = iter->N+1;
+	if( bRows<aCols )
+	{
+		fprintf( stderr , "[ERROR] CSRSparseMatrix::Multiply: Matrix sizes do not support multiplication %lld x %lld * %lld x %lld\n" , (unsigned long long)aRows , (unsigned long long)aCols , (unsigned long long)bRows , (unsigned long long)bCols );
+		exit( 0 );
+	}
+
+	// The rows are accumulated separately, since their sizes are only known once they are.
+	// Every thread gathers its rows in a dense array indexed by column, with the entries of a row in the order in which their columns are first reached.
+	std::vector< std::vector< MatrixEntry< T , IndexType > > > rows( aRows );
+	M.resize( aRows );
+#pragma omp parallel
+	{
+		std::vector< long long > position( bCols , -1 );
+#pragma omp for
+		for( long long i=0 ; i<(long long)aRows ; i++ )
+		{
+			std::vector< MatrixEntry< T , IndexType > >& row = rows[i];
+			for( A_const_iterator iterA=A.begin(i) ; iterA!=A.end(i) ; iterA++ )
+			{
+				IndexType idx1 = iterA->N;
+				T AValue = iterA->Value;
+				for( B_const_iterator iterB=B.begin(idx1) ; iterB!=B.end(idx1) ; iterB++ )
+				{
+					IndexType idx2 = iterB->N;
+					T temp = iterB->Value * AValue;
+					if( position[idx2]<0 ) position[idx2] = (long long)row.size() , row.push_back( MatrixEntry< T , IndexType >( idx2 , temp ) );
+					else row[ position[idx2] ].Value += temp;
+				}
+			}
+			for( size_t j=0 ; j<row.size() ; j++ ) position[ row[j].N ] = -1;
+			M.rowOffsets[i+1] = row.size();
+		}
+	}
+	M.setRowOffsetsFromSizes();
+#pragma omp parallel for
+	for( long long i=0 ; i<(long long)aRows ; i++ )
+	{
+		for( size_t j=0 ; j<rows[i].size() ; j++ ) M.columns[ M.rowOffsets[i]+j ] = rows[i][j].N , M.values[ M.rowOffsets[i]+j ] = rows[i][j].Value;
+		std::vector< MatrixEntry< T , IndexType > >().swap( rows[i] );
+	}
+	return M;
+}
+template< class T , class IndexType >
+CSRSparseMatrix< T , IndexType > CSRSparseMatrix< T , IndexType >::transpose( size_t outRows ) const
+{
+	CSRSparseMatrix A;
+	size_t _outRows = 0;
+#pragma omp parallel for reduction( max : _outRows )
+	for( long long i=0 ; i<(long long)entries() ; i++ ) if( _outRows<=(size_t)columns[i] ) _outRows = columns[i]+1;
+	if( _outRows>outRows )
+	{
+		fprintf( stderr , "[ERROR] CSRSparseMatrix::transpose: prescribed output dimension too low: %llu < %llu\n" , (unsigned long long)outRows , (unsigned long long)_outRows );
+		exit( 0 );
+	}
+
+	A.resize( outRows );
+	for( size_t i=0 ; i<entries() ; i++ ) A.rowOffsets[ columns[i]+1 ]++;
+	A.setRowOffsetsFromSizes();
+	// Scatter the entries in parallel and then sort every row by column, which is the order in which a serial scatter would have stored them
+	std::vector< size_t > next( outRows );
+	for( size_t i=0 ; i<outRows ; i++ ) next[i] = A.rowOffsets[i];
+#pragma omp parallel for
+	for( long long i=0 ; i<(long long)rowNum ; i++ ) for( size_t j=rowOffsets[i] ; j<rowOffsets[i+1] ; j++ )
+	{
+		size_t idx;
+#pragma omp atomic capture
+		idx = next[ columns[j] ]++;
+		A.columns[idx] = (IndexType)i , A.values[idx] = values[j];
+	}
+#pragma omp parallel for
+	for( long long i=0 ; i<(long long)outRows ; i++ ) if( A.rowSize(i)>1 )
+	{
+		std::vector< MatrixEntry< T , IndexType > > row( A.rowSize(i) );
+		for( size_t j=0 ; j<row.size() ; j++ ) row[j] = MatrixEntry< T , IndexType >( A.columns[ A.rowOffsets[i]+j ] , A.values[ A.rowOffsets[i]+j ] );
+		std::sort( row.begin() , row.end() , []( const MatrixEntry< T , IndexType >& e1 , const MatrixEntry< T , IndexType >& e2 ){ return e1.N<e2.N; } );
+		for( size_t j=0 ; j<row.size() ; j++ ) A.columns[ A.rowOffsets[i]+j ] = row[j].N , A.values[ A.rowOffsets[i]+j ] = row[j].Value;
+	}
+	return A;
+}
+
+template< class T , class IndexType >
+void CSRSparseMatrix< T , IndexType >::resize( size_t r , size_t e )
+{
+	FreePointer( rowOffsets );
+	FreePointer( columns );
+	FreePointer( values );
+	rowNum = r;
+	if( r )
+	{
+		rowOffsets = AllocPointer< size_t >( r+1 );
+		memset( rowOffsets , 0 , sizeof( size_t ) * ( r+1 ) );
+	}
+	if( e )
+	{
+		columns = AllocPointer< IndexType >( e );
+		values = AllocPointer< T >( e );
+	}
+}
+template< class T , class IndexType >
+void CSRSparseMatrix< T , IndexType >::setRowOffsetsFromSizes( void )
+{
+	if( !rowNum ) return;
+	rowOffsets[0] = 0;
+	for( size_t i=0 ; i<rowNum ; i++ ) rowOffsets[i+1] += rowOffsets[i];
+	FreePointer( columns );
+	FreePointer( values );
+	if( rowOffsets[rowNum] )
+	{
+		columns = AllocPointer< IndexType >( rowOffsets[rowNum] );
+		values = AllocPointer< T >( rowOffsets[rowNum] );
+	}
+}
+
+template< class T , class IndexType >
+template< class T2 >
+T2 CSRSparseMatrix< T , IndexType >::_RowDot( ConstPointer( IndexType ) columns , ConstPointer( T ) values , size_t begin , size_t end , ConstPointer( T2 ) x )
+{
+	T2 temp;
+	memset( &temp , 0 , sizeof(T2) );
+	for( size_t e=begin ; e<end ; e++ ) temp += (T2)( x[ columns[e] ] * values[e] );
+	return temp;
+}
+#ifdef CSR_SPARSE_MATRIX_AVX2
+template< class T , class IndexType >
+float CSRSparseMatrix< T , IndexType >::_RowDot( const int* columns , const float* values , size_t begin , size_t end , const float* x )
+{
+	__m256 sum = _mm256_setzero_ps();
+	size_t e = begin;
+	for( ; e+8<=end ; e+=8 )
+	{
+		__m256i idx = _mm256_loadu_si256( (const __m256i*)( columns+e ) );
+		sum = _mm256_add_ps( sum , _mm256_mul_ps( _mm256_i32gather_ps( x , idx , 4 ) , _mm256_loadu_ps( values+e ) ) );
+	}
+	__m128 s = _mm_add_ps( _mm256_castps256_ps128( sum ) , _mm256_extractf128_ps( sum , 1 ) );
+	s = _mm_add_ps( s , _mm_movehl_ps( s , s ) );
+	s = _mm_add_ss( s , _mm_shuffle_ps( s , s , 1 ) );
+	float temp = _mm_cvtss_f32( s );
+	for( ; e<end ; e++ ) temp += x[ columns[e] ] * values[e];
+	return temp;
+}
+template< class T , class IndexType >
+double CSRSparseMatrix< T , IndexType >::_RowDot( const int* columns , const double* values , size_t begin , size_t end , const double* x )
+{
+	__m256d sum = _mm256_setzero_pd();
+	size_t e = begin;
+	for( ; e+4<=end ; e+=4 )
+	{
+		__m128i idx = _mm_loadu_si128( (const __m128i*)( columns+e ) );
+		sum = _mm256_add_pd( sum , _mm256_mul_pd( _mm256_i32gather_pd( x , idx , 8 ) , _mm256_loadu_pd( values+e ) ) );
+	}
+	__m128d s = _mm_add_pd( _mm256_castpd256_pd128( sum ) , _mm256_extractf128_pd( sum , 1 ) );
+	s = _mm_add_sd( s , _mm_unpackhi_pd( s , s ) );
+	double temp = _mm_cvtsd_f64( s );
+	for( ; e<end ; e++ ) temp += x[ columns[e] ] * values[e];
+	return temp;
+}
+#endif // CSR_SPARSE_MATRIX_AVX2
+
+template< class T , class IndexType >
+template< class T2 >
+void CSRSparseMatrix< T , IndexType >::multiply( ConstPointer( T2 ) In , Pointer( T2 ) Out , int multiplyFlag ) const
+{
+#pragma omp parallel for
+	for( long long i=0 ; i<(long long)rowNum ; i++ )
+	{
+		T2 temp = rowDot( (size_t)i , In );
+		if( multiplyFlag & MULTIPLY_NEGATE ) temp = -temp;
+		if( multiplyFlag & MULTIPLY_ADD ) Out[i] += temp;
+		else                              Out[i]  = temp;
+	}
+}
+
+template< class T , class IndexType >
+void CSRSparseMatrix< T , IndexType >::setDiagonalR( Pointer( T ) diagonal ) const
+{
+#pragma omp parallel for
+	for( long long i=0 ; i<(long long)rowNum ; i++ )
+	{
+		diagonal[i] = (T)0;
+		for( size_t e=rowOffsets[i] ; e<rowOffsets[i+1] ; e++ ) if( columns[e]==i ) diagonal[i] += values[e];
+		if( diagonal[i] ) diagonal[i] = (T)( 1./diagonal[i] );
+	}
+}
+
+template< class T , class IndexType >
+template< class T2 >
+void CSRSparseMatrix< T , IndexType >::gsRow( size_t row , ConstPointer( T ) diagonal , ConstPointer( T2 ) b , Pointer( T2 ) x , bool dReciprocal ) const
+{
+#ifdef CSR_SPARSE_MATRIX_AVX2
+	T2 _b = b[row] - rowDot( row , ( ConstPointer( T2 ) )x );
+#else // !CSR_SPARSE_MATRIX_AVX2
+	// Subtract in the order of the entries so that the result matches the row-array SparseMatrix exactly
+	T2 _b = b[row];
+	for( size_t e=rowOffsets[row] ; e<rowOffsets[row+1] ; e++ ) _b -= x[ columns[e] ] * values[e];
+#endif // CSR_SPARSE_MATRIX_AVX2
+	if( dReciprocal ) x[row] += _b * diagonal[row];
+	else              x[row] += _b / diagonal[row];
+}
+
+template< class T , class IndexType >
+template< class T2 >
+void CSRSparseMatrix< T , IndexType >::gsIteration( const std::vector< std::vector< int > >& multiColorIndices , ConstPointer( T ) diagonal , ConstPointer( T2 ) b , Pointer( T2 ) x , bool forward , bool dReciprocal ) const
+{
+	for( int c=0 ; c<(int)multiColorIndices.size() ; c++ )
+	{
+		const std::vector< int >& indices = multiColorIndices[ forward ? c : (int)multiColorIndices.size()-1-c ];
+#pragma omp parallel for
+		for( int k=0 ; k<(int)indices.size() ; k++ ) gsRow( indices[k] , diagonal , b , x , dReciprocal );
+	}
+}
+
+template< class T , class IndexType >
+template< class T2 >
+void CSRSparseMatrix< T , IndexType >::gsColorIteration( const std::vector< int >& colorStarts , ConstPointer( T ) diagonal , ConstPointer( T2 ) b , Pointer( T2 ) x , bool forward , bool dReciprocal ) const
+{
+	int colors = (int)colorStarts.size()-1;
+	for( int c=0 ; c<colors ; c++ )
+	{
+		int cc = forward ? c : colors-1-c;
+#pragma omp parallel for
+		for( int jj=colorStarts[cc] ; jj<colorStarts[cc+1] ; jj++ ) gsRow( jj , diagonal , b , x , dReciprocal );
+	}
+}
@@ -55,10 +55,56 @@ public:
 	template< class T2 > void gsIteration( const std::vector< std::vector< int > >& multiColorIndices , ConstPointer( T ) diagonal , ConstPointer( T2 ) b , Pointer( T2 ) x , bool forward , bool dReciprocal ) const;
 };
 
+// The work vectors of the conjugate-gradients solvers, which can be kept between solves of the same size
+template< class Real >
+struct CGScratch
+{
+	Real *r , *d , *q;
+	CGScratch( void ) : r(NULL) , d(NULL) , q(NULL) , _dim(0){ ; }
+	CGScratch( int dim ) : r(NULL) , d(NULL) , q(NULL) , _dim(0){ resize(dim); }
+	~CGScratch( void ){ resize(0); }
+	void resize( int dim )
+	{
+		if( dim!=_dim )
+		{
+			if( r ) delete[] r ; r = NULL;
+			if( d ) delete[] d ; d = NULL;
+			if( q ) delete[] q ; q = NULL;
+			if( dim ) r = new Real[dim] , d = new Real[dim] , q = new Real[dim];
+			_dim = dim;
+		}
+	}
+protected:
+	int _dim;
+};
+template< class Real >
+struct PreconditionedCGScratch : public CGScratch< Real >
+{
+	Real *s;
+	PreconditionedCGScratch( void ) : CGScratch< Real >() , s(NULL){ ; }
+	PreconditionedCGScratch( int dim ) : CGScratch< Real >() , s(NULL){ resize(dim); }
+	~PreconditionedCGScratch( void ){ resize(0); }
+	void resize( int dim )
+	{
+		if( dim!=CGScratch< Real >::_dim )
+		{
+			if( s ) delete[] s; s = NULL;
+			if( dim ) s = new Real[dim];
+		}
+		CGScratch< Real >::resize( dim );
+	}
+};
+
 // Assuming that the SPDOperator class defines:
 //		auto SPDOperator::()( ConstPointer( T ) , Pointer( T ) ) const
 template< class SPDFunctor , class T , typename Real , class TDotTFunctor > int SolveCG( const SPDFunctor& M , int dim , ConstPointer( T ) b , int iters , Pointer( T ) x , double eps , TDotTFunctor Dot );
 template< class SPDFunctor , class Preconditioner , class T , typename Real , class TDotTFunctor > int SolveCG( const SPDFunctor& M , const Preconditioner& P , int dim , ConstPointer( T ) b , int iters , Pointer( T ) x , double eps , TDotTFunctor Dot );
+// Conjugate-gradients preconditioned with the SPD operator P, stopping once the relative residual |b-Mx|/|b| drops below eps
+// The work vectors are taken from the scratch if one is given
+template< class SPDFunctor , class Preconditioner , class T , typename Real , class TDotTFunctor > int SolvePCG( const SPDFunctor& M , const Preconditioner& P , int dim , ConstPointer( T ) b , int iters , Pointer( T ) x , double eps , TDotTFunctor Dot , PreconditionedCGScratch< T >* scratch=NULL );
+// The same for K independent systems with the same matrix, stored in the K lanes of T (accessed as t[k]) and solved together:
+// every lane has its own step sizes and stopping test, and the iterations end once all the lanes have converged
+template< unsigned int K , class SPDFunctor , class Preconditioner , class T , typename Real > int SolvePCGLanes( const SPDFunctor& M , const Preconditioner& P , int dim , ConstPointer( T ) b , int iters , Pointer( T ) x , double eps , PreconditionedCGScratch< T >* scratch=NULL );
 
 #include "SparseMatrixInterface.inl"
 #endif // SPARSE_MATRIX_INTERFACE_INCLUDED
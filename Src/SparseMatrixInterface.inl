@@ -361,3 +361,148 @@ template< class SPDFunctor , class Preconditioner , class T , typename Real , cl
 	FreePointer( temp );
 	return ii;
 }
+template< class SPDFunctor , class Preconditioner , class T , typename Real , class TDotTFunctor > int SolvePCG( const SPDFunctor& M , const Preconditioner& P , int dim , ConstPointer( T ) b , int iters , Pointer( T ) x , double eps , TDotTFunctor Dot , PreconditionedCGScratch< T >* scratch )
+{
+	eps *= eps;
+	Pointer( T ) r ; Pointer( T ) d ; Pointer( T ) q ; Pointer( T ) s;
+	if( scratch )
+	{
+		scratch->resize( dim );
+		r = GetPointer( scratch->r , dim ) , d = GetPointer( scratch->d , dim ) , q = GetPointer( scratch->q , dim ) , s = GetPointer( scratch->s , dim );
+	}
+	else r = AllocPointer< T >( dim ) , d = AllocPointer< T >( dim ) , q = AllocPointer< T >( dim ) , s = AllocPointer< T >( dim );
+
+	double delta_new = 0 , rNorm2 = 0 , bNorm2 = 0;
+	M( ( ConstPointer( T ) )x , r );
+#pragma omp parallel for reduction( + : rNorm2 , bNorm2 )
+	for( int i=0 ; i<dim ; i++ ) r[i] = b[i] - r[i] , rNorm2 += Dot( r[i] , r[i] ) , bNorm2 += Dot( b[i] , b[i] );
+	P( ( ConstPointer( T ) )r , d );
+#pragma omp parallel for reduction( + : delta_new )
+	for( int i=0 ; i<dim ; i++ ) delta_new += Dot( r[i] , d[i] );
+
+	int ii;
+	for( ii=0 ; ii<iters && rNorm2>eps*bNorm2 && delta_new>0 ; ii++ )
+	{
+		M( ( ConstPointer( T ) )d , q );
+		double dDotQ = 0;
+#pragma omp parallel for reduction( + : dDotQ )
+		for( int i=0 ; i<dim ; i++ ) dDotQ += Dot( d[i] , q[i] );
+		if( !dDotQ ) break;
+
+		Real alpha = Real( delta_new / dDotQ );
+		rNorm2 = 0;
+		if( (ii%50)==(50-1) )
+		{
+#pragma omp parallel for
+			for( int i=0 ; i<dim ; i++ ) x[i] += (T)( d[i] * alpha );
+			M( ( ConstPointer( T ) )x , r );
+#pragma omp parallel for reduction( + : rNorm2 )
+			for( int i=0 ; i<dim ; i++ ) r[i] = b[i] - r[i] , rNorm2 += Dot( r[i] , r[i] );
+		}
+		else
+#pragma omp parallel for reduction( + : rNorm2 )
+			for( int i=0 ; i<dim ; i++ ) r[i] -= (T)( q[i] * alpha ) , rNorm2 += Dot( r[i] , r[i] ) , x[i] += (T)( d[i] * alpha );
+		P( ( ConstPointer( T ) )r , s );
+
+		double delta_old = delta_new;
+		delta_new = 0;
+#pragma omp parallel for reduction( + : delta_new )
+		for( int i=0 ; i<dim ; i++ ) delta_new += Dot( r[i] , s[i] );
+
+		Real beta = Real( delta_new / delta_old );
+#pragma omp parallel for
+		for( int i=0 ; i<dim ; i++ ) d[i] = s[i] + (T)( d[i] * beta );
+	}
+	if( !scratch )
+	{
+		FreePointer( r );
+		FreePointer( d );
+		FreePointer( q );
+		FreePointer( s );
+	}
+	return ii;
+}
+template< unsigned int K , class SPDFunctor , class Preconditioner , class T , typename Real > int SolvePCGLanes( const SPDFunctor& M , const Preconditioner& P , int dim , ConstPointer( T ) b , int iters , Pointer( T ) x , double eps , PreconditionedCGScratch< T >* scratch )
+{
+	eps *= eps;
+	Pointer( T ) r ; Pointer( T ) d ; Pointer( T ) q ; Pointer( T ) s;
+	if( scratch )
+	{
+		scratch->resize( dim );
+		r = GetPointer( scratch->r , dim ) , d = GetPointer( scratch->d , dim ) , q = GetPointer( scratch->q , dim ) , s = GetPointer( scratch->s , dim );
+	}
+	else r = AllocPointer< T >( dim ) , d = AllocPointer< T >( dim ) , q = AllocPointer< T >( dim ) , s = AllocPointer< T >( dim );
+
+	// The dot-products of every lane, summed per thread
+	std::vector< double > threadDots( omp_get_max_threads() * K );
+	auto LaneDots = [&]( ConstPointer( T ) u , ConstPointer( T ) v , double dots[K] )
+	{
+		for( size_t i=0 ; i<threadDots.size() ; i++ ) threadDots[i] = 0;
+#pragma omp parallel
+		{
+			double* _dots = &threadDots[ omp_get_thread_num() * K ];
+#pragma omp for
+			for( int i=0 ; i<dim ; i++ ) for( unsigned int k=0 ; k<K ; k++ ) _dots[k] += (double)u[i][k] * (double)v[i][k];
+		}
+		for( unsigned int k=0 ; k<K ; k++ ) dots[k] = 0;
+		for( size_t t=0 ; t<threadDots.size()/K ; t++ ) for( unsigned int k=0 ; k<K ; k++ ) dots[k] += threadDots[ t*K+k ];
+	};
+
+	double delta_new[K] , delta_old[K] , dDotQ[K] , rNorm2[K] , bNorm2[K];
+	Real alpha[K] , beta[K];
+	bool active[K];
+	M( ( ConstPointer( T ) )x , r );
+#pragma omp parallel for
+	for( int i=0 ; i<dim ; i++ ) r[i] = b[i] - r[i];
+	P( ( ConstPointer( T ) )r , d );
+	LaneDots( ( ConstPointer( T ) )r , ( ConstPointer( T ) )r , rNorm2 );
+	LaneDots( b , b , bNorm2 );
+	LaneDots( ( ConstPointer( T ) )r , ( ConstPointer( T ) )d , delta_new );
+	for( unsigned int k=0 ; k<K ; k++ ) active[k] = rNorm2[k]>eps*bNorm2[k] && delta_new[k]>0;
+
+	auto Active = [&]( void ){ for( unsigned int k=0 ; k<K ; k++ ) if( active[k] ) return true ; return false; };
+	int ii;
+	for( ii=0 ; ii<iters && Active() ; ii++ )
+	{
+		M( ( ConstPointer( T ) )d , q );
+		LaneDots( ( ConstPointer( T ) )d , ( ConstPointer( T ) )q , dDotQ );
+		// A lane that has converged (or broken down) is no longer updated
+		for( unsigned int k=0 ; k<K ; k++ )
+		{
+			if( !dDotQ[k] ) active[k] = false;
+			alpha[k] = active[k] ? Real( delta_new[k] / dDotQ[k] ) : 0;
+		}
+
+		if( (ii%50)==(50-1) )
+		{
+#pragma omp parallel for
+			for( int i=0 ; i<dim ; i++ ) for( unsigned int k=0 ; k<K ; k++ ) x[i][k] += d[i][k] * alpha[k];
+			M( ( ConstPointer( T ) )x , r );
+#pragma omp parallel for
+			for( int i=0 ; i<dim ; i++ ) r[i] = b[i] - r[i];
+		}
+		else
+#pragma omp parallel for
+			for( int i=0 ; i<dim ; i++ ) for( unsigned int k=0 ; k<K ; k++ ) r[i][k] -= q[i][k] * alpha[k] , x[i][k] += d[i][k] * alpha[k];
+		LaneDots( ( ConstPointer( T ) )r , ( ConstPointer( T ) )r , rNorm2 );
+		P( ( ConstPointer( T ) )r , s );
+
+		for( unsigned int k=0 ; k<K ; k++ ) delta_old[k] = delta_new[k];
+		LaneDots( ( ConstPointer( T ) )r , ( ConstPointer( T ) )s , delta_new );
+		for( unsigned int k=0 ; k<K ; k++ )
+		{
+			beta[k] = active[k] ? Real( delta_new[k] / delta_old[k] ) : 0;
+			active[k] = active[k] && rNorm2[k]>eps*bNorm2[k] && delta_new[k]>0;
+		}
+#pragma omp parallel for
+		for( int i=0 ; i<dim ; i++ ) for( unsigned int k=0 ; k<K ; k++ ) d[i][k] = s[i][k] + d[i][k] * beta[k];
+	}
+	if( !scratch )
+	{
+		FreePointer( r );
+		FreePointer( d );
+		FreePointer( q );
+		FreePointer( s );
+	}
+	return ii;
+}
@@ -10,6 +10,15 @@
 #include <algorithm>
 #include <exception>
 #include <functional>
+#include <unordered_map>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KDTREE_SSE2
+#endif
 
 namespace kdt
 {
@@ -38,20 +47,30 @@ namespace kdt
 	};
 
 	/** @brief k-d tree class.
-	https://github.com/gishi523/kd-tree
+	The interface follows https://github.com/gishi523/kd-tree, but the nodes are stored in one contiguous array
+	and the points are kept in leaf buckets of at most BUCKET_SIZE points in structure-of-arrays layout,
+	so that a leaf is scanned with SIMD distance kernels instead of chasing one pointer per point.
+	All comparisons are made on squared distances.
 	*/
+	template <class PointT>
+	class KnnCache;
+
 	template <class PointT>
 	class KDTree
 	{
+		template <class> friend class KnnCache;
+
 	public:
-		/** @brief The constructors.
+		static_assert(PointT::DIM == 3, "kdt::KDTree stores its points as x/y/z arrays");
+
+		/** @brief Maximum number of points in a leaf bucket.
 		*/
-		KDTree() : root_(nullptr) {};
-		KDTree(const std::vector<PointT>& points) : root_(nullptr) { build(points); }
+		static const int BUCKET_SIZE = 16;
 
-		/** @brief The destructor.
+		/** @brief The constructors.
 		*/
-		~KDTree() { clear(); }
+		KDTree() {};
+		KDTree(const std::vector<PointT>& points) { build(points); }
 
 		/** @brief Re-builds k-d tree.
 		*/
@@ -59,21 +78,33 @@ namespace kdt
 		{
 			clear();
 
-			points_ = points;
+			if (points.empty())
+				return;
+
+			const int npoints = (int)points.size();
+			indices_.resize(npoints);
+			std::iota(std::begin(indices_), std::end(indices_), 0);
 
-			std::vector<int> indices(points.size());
-			std::iota(std::begin(indices), std::end(indices), 0);
+			nodes_.reserve(2 * (npoints / BUCKET_SIZE + 1));
+			buildRecursive(points, 0, npoints);
 
-			root_ = buildRecursive(indices.data(), (int)points.size(), 0);
+			// lay the points out in leaf order
+			for (int d = 0; d < 3; d++)
+			{
+				coords_[d].resize(npoints);
+				for (int i = 0; i < npoints; i++)
+					coords_[d][i] = points[indices_[i]][d];
+			}
 		}
 
 		/** @brief Clears k-d tree.
 		*/
 		void clear()
-		{ 
-			clearRecursive(root_);
-			root_ = nullptr;
-			points_.clear();
+		{
+			std::vector<Node>().swap(nodes_);
+			std::vector<int>().swap(indices_);
+			for (int d = 0; d < 3; d++)
+				std::vector<double>().swap(coords_[d]);
 		}
 
 		/** @brief Validates k-d tree.
@@ -82,7 +113,8 @@ namespace kdt
 		{
 			try
 			{
-				validateRecursive(root_, 0);
+				if (!nodes_.empty())
+					validateRecursive(0);
 			}
 			catch (const Exception&)
 			{
@@ -96,236 +128,648 @@ namespace kdt
 		*/
 		int nnSearch(const PointT& query, double* minDist = nullptr) const
 		{
-			int guess;
-			double _minDist = std::numeric_limits<double>::max();
-
-			nnSearchRecursive(query, root_, &guess, &_minDist);
+			const double q[3] = { query[0], query[1], query[2] };
+			KnnHeap heap(1);
+			knnSearch(q, heap);
 
 			if (minDist)
-				*minDist = _minDist;
+				*minDist = heap.size() ? sqrt(heap[0].first) : std::numeric_limits<double>::max();
 
-			return guess;
+			return heap.size() ? heap[0].second : -1;
 		}
 
 		/** @brief Searches k-nearest neighbors.
+		The indices are sorted by increasing distance.
 		*/
 		std::vector<int> knnSearch(const PointT& query, int k) const
 		{
-			KnnQueue queue(k);
-			knnSearchRecursive(query, root_, queue, k);
-			
-			std::vector<int> indices(queue.size());
-			for (size_t i = 0; i < queue.size(); i++)
-				indices[i] = queue[i].second;
+			if (k <= 0)
+				return std::vector<int>();
+
+			const double q[3] = { query[0], query[1], query[2] };
+			KnnHeap heap(k);
+			knnSearch(q, heap);
+			heap.sort();
+
+			std::vector<int> indices(heap.size());
+			for (size_t i = 0; i < heap.size(); i++)
+				indices[i] = heap[i].second;
 
 			return indices;
 		}
 
+		/** @brief Searches k-nearest neighbors of a batch of queries.
+		@p queries holds @p nqueries points as consecutive x/y/z triples. The neighbors of query i are written,
+		sorted by increasing distance, to indices[i*k] ... indices[i*k+k-1] and, if @p dists is given, their
+		distances to dists[i*k] ... dists[i*k+k-1]. Slots left over when the tree has fewer than k points are set to -1.
+		The queries are processed in Morton order so that consecutive searches touch the same part of the tree,
+		and each thread reuses one heap for all its searches.
+		*/
+		void knnSearch(const double* queries, int nqueries, int k, int* indices, double* dists = nullptr) const
+		{
+			if (nqueries <= 0 || k <= 0)
+				return;
+
+			std::vector<std::pair<unsigned int, int>> order(nqueries);
+			{
+				double lo[3], hi[3];
+				for (int d = 0; d < 3; d++)
+					lo[d] = hi[d] = queries[d];
+				for (int i = 1; i < nqueries; i++)
+					for (int d = 0; d < 3; d++)
+					{
+						lo[d] = std::min(lo[d], queries[3 * i + d]);
+						hi[d] = std::max(hi[d], queries[3 * i + d]);
+					}
+				double extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+				const double scale = extent > 0 ? 1023.0 / extent : 0;
+
+#pragma omp parallel for
+				for (int i = 0; i < nqueries; i++)
+				{
+					unsigned int cell[3];
+					for (int d = 0; d < 3; d++)
+						cell[d] = std::min(1023u, (unsigned int)((queries[3 * i + d] - lo[d]) * scale));
+					order[i] = std::make_pair(mortonCode(cell[0], cell[1], cell[2]), i);
+				}
+			}
+			std::sort(order.begin(), order.end());
+
+#pragma omp parallel
+			{
+				KnnHeap heap(k);
+#pragma omp for schedule(dynamic, 1024)
+				for (int i = 0; i < nqueries; i++)
+				{
+					const int q = order[i].second;
+					heap.clear();
+					knnSearch(queries + 3 * q, heap);
+					heap.sort();
+
+					int* idx = indices + (size_t)q * k;
+					for (int j = 0; j < k; j++)
+						idx[j] = j < (int)heap.size() ? heap[j].second : -1;
+					if (dists)
+					{
+						double* dist = dists + (size_t)q * k;
+						for (int j = 0; j < k; j++)
+							dist[j] = j < (int)heap.size() ? sqrt(heap[j].first) : -1;
+					}
+				}
+			}
+		}
+
 		/** @brief Searches neighbors within radius.
 		*/
 		std::vector<int> radiusSearch(const PointT& query, double radius) const
 		{
+			const double q[3] = { query[0], query[1], query[2] };
 			std::vector<int> indices;
-			radiusSearchRecursive(query, root_, indices, radius);
+			radiusSearch(q, radius, indices);
+			for (size_t i = 0; i < indices.size(); i++)
+				indices[i] = indices_[indices[i]];
 			return indices;
 		}
 
 	private:
 
 		/** @brief k-d tree node.
+		The left child of an internal node is stored right after it, the right child at @p right.
 		*/
 		struct Node
 		{
-			int idx;       //!< index to the original point
-			Node* next[2]; //!< pointers to the child nodes
-			int axis;      //!< dimension's axis
+			int axis;     //!< splitting axis, -1 for a leaf
+			int right;    //!< index of the right child
+			int begin;    //!< first point of the subtree in leaf order
+			int end;      //!< one past the last point of the subtree in leaf order
+			double split; //!< splitting coordinate
 
-			Node() : idx(-1), axis(-1) { next[0] = next[1] = nullptr; }
+			Node() : axis(-1), right(-1), begin(0), end(0), split(0) {}
 		};
 
 		/** @brief k-d tree exception.
 		*/
 		class Exception : public std::exception { using std::exception::exception; };
 
-		/** @brief Bounded priority queue.
+		/** @brief Fixed-capacity max-heap of <squared distance, index> pairs.
 		*/
-		template <class T, class Compare = std::less<T>>
-		class BoundedPriorityQueue
+		class KnnHeap
 		{
 		public:
 
-			BoundedPriorityQueue() = delete;
-			BoundedPriorityQueue(size_t bound) : bound_(bound) { elements_.reserve(bound + 1); };
+			KnnHeap() = delete;
+			KnnHeap(size_t bound) : bound_(bound) { elements_.reserve(bound); };
 
-			void push(const T& val)
+			void push(double dist2, int idx)
 			{
-				auto it = std::find_if(std::begin(elements_), std::end(elements_),
-					[&](const T& element){ return Compare()(val, element); });
-				elements_.insert(it, val);
-
-				if (elements_.size() > bound_)
-					elements_.resize(bound_);
+				if (bound_ == 0)
+					return;
+				if (elements_.size() < bound_)
+				{
+					elements_.push_back(std::make_pair(dist2, idx));
+					std::push_heap(elements_.begin(), elements_.end());
+				}
+				else if (std::make_pair(dist2, idx) < elements_.front())
+				{
+					std::pop_heap(elements_.begin(), elements_.end());
+					elements_.back() = std::make_pair(dist2, idx);
+					std::push_heap(elements_.begin(), elements_.end());
+				}
 			}
 
-			const T& back() const { return elements_.back(); };
-			const T& operator[](size_t index) const { return elements_[index]; }
+			/** @brief Squared distance a candidate has to beat to enter the heap; nothing beats it in a heap of capacity 0.
+			*/
+			double worst() const { return bound_ == 0 ? 0 : elements_.size() < bound_ ? std::numeric_limits<double>::max() : elements_.front().first; }
+
+			void sort() { std::sort_heap(elements_.begin(), elements_.end()); }
+			void clear() { elements_.clear(); }
+
+			const std::pair<double, int>& operator[](size_t index) const { return elements_[index]; }
 			size_t size() const { return elements_.size(); }
 
 		private:
 			size_t bound_;
-			std::vector<T> elements_;
+			std::vector<std::pair<double, int>> elements_;
 		};
 
-		/** @brief Priority queue of <distance, index> pair.
-		*/
-		using KnnQueue = BoundedPriorityQueue<std::pair<double, int>>;
-
-		/** @brief Builds k-d tree recursively.
+		/** @brief Pending subtree and the squared distance from the query to its splitting plane.
 		*/
-		Node* buildRecursive(int* indices, int npoints, int depth)
+		struct StackEntry
 		{
-			if (npoints <= 0)
-				return nullptr;
-
-			const int axis = depth % PointT::DIM;
-			const int mid = (npoints - 1) / 2;
-
-			std::nth_element(indices, indices + mid, indices + npoints, [&](int lhs, int rhs)
-			{
-				return points_[lhs][axis] < points_[rhs][axis];
-			});
+			int node;
+			double bound;
 
-			Node* node = new Node();
-			node->idx = indices[mid];
-			node->axis = axis;
+			StackEntry() : node(-1), bound(0) {}
+			StackEntry(int n, double b) : node(n), bound(b) {}
+		};
 
-			node->next[0] = buildRecursive(indices, mid, depth + 1);
-			node->next[1] = buildRecursive(indices + mid + 1, npoints - mid - 1, depth + 1);
+		// every internal node halves its point count, so the depth is bounded by the bit width of int
+		static const int MAX_STACK = 64;
 
-			return node;
+		/** @brief Interleaves the bits of three 10-bit cell coordinates.
+		*/
+		static unsigned int mortonCode(unsigned int x, unsigned int y, unsigned int z)
+		{
+			unsigned int code = 0;
+			for (int b = 0; b < 10; b++)
+				code |= (((x >> b) & 1u) << (3 * b)) | (((y >> b) & 1u) << (3 * b + 1)) | (((z >> b) & 1u) << (3 * b + 2));
+			return code;
 		}
 
-		/** @brief Clears k-d tree recursively.
+		/** @brief Builds k-d tree recursively, splitting at the median of the widest axis.
 		*/
-		void clearRecursive(Node* node)
+		int buildRecursive(const std::vector<PointT>& points, int begin, int end)
 		{
-			if (node == nullptr)
-				return;
+			const int idx = (int)nodes_.size();
+			nodes_.push_back(Node());
+			nodes_[idx].begin = begin;
+			nodes_[idx].end = end;
+
+			const int npoints = end - begin;
+			if (npoints <= BUCKET_SIZE)
+				return idx;
+
+			double lo[3], hi[3];
+			for (int d = 0; d < 3; d++)
+				lo[d] = hi[d] = points[indices_[begin]][d];
+			for (int i = begin + 1; i < end; i++)
+				for (int d = 0; d < 3; d++)
+				{
+					const double c = points[indices_[i]][d];
+					lo[d] = std::min(lo[d], c);
+					hi[d] = std::max(hi[d], c);
+				}
+
+			int axis = 0;
+			for (int d = 1; d < 3; d++)
+				if (hi[d] - lo[d] > hi[axis] - lo[axis])
+					axis = d;
+
+			const int mid = begin + npoints / 2;
+			std::nth_element(indices_.begin() + begin, indices_.begin() + mid, indices_.begin() + end, [&](int lhs, int rhs)
+			{
+				return points[lhs][axis] < points[rhs][axis];
+			});
 
-			if (node->next[0])
-				clearRecursive(node->next[0]);
+			nodes_[idx].axis = axis;
+			nodes_[idx].split = points[indices_[mid]][axis];
 
-			if (node->next[1])
-				clearRecursive(node->next[1]);
+			buildRecursive(points, begin, mid);
+			const int right = buildRecursive(points, mid, end);
+			nodes_[idx].right = right;
 
-			delete node;
+			return idx;
 		}
 
 		/** @brief Validates k-d tree recursively.
 		*/
-		void validateRecursive(const Node* node, int depth) const
+		void validateRecursive(int n) const
 		{
-			if (node == nullptr)
+			const Node& node = nodes_[n];
+			if (node.axis < 0)
 				return;
 
-			const int axis = node->axis;
-			const Node* node0 = node->next[0];
-			const Node* node1 = node->next[1];
+			const Node& left = nodes_[n + 1];
+			const Node& right = nodes_[node.right];
+			if (left.begin != node.begin || left.end != right.begin || right.end != node.end)
+				throw Exception();
 
-			if (node0 && node1)
-			{
-				if (points_[node->idx][axis] < points_[node0->idx][axis])
+			for (int i = left.begin; i < left.end; i++)
+				if (coords_[node.axis][i] > node.split)
 					throw Exception();
 
-				if (points_[node->idx][axis] > points_[node1->idx][axis])
+			for (int i = right.begin; i < right.end; i++)
+				if (coords_[node.axis][i] < node.split)
 					throw Exception();
-			}
-
-			if (node0)
-				validateRecursive(node0, depth + 1);
 
-			if (node1)
-				validateRecursive(node1, depth + 1);
+			validateRecursive(n + 1);
+			validateRecursive(node.right);
 		}
 
-		static double distance(const PointT& p, const PointT& q)
+		/** @brief Squared distances from @p q to the @p count points starting at @p begin in leaf order.
+		*/
+		void squaredDistances(int begin, int count, const double q[3], double* dist2) const
 		{
-			double dist = 0;
-			for (size_t i = 0; i < PointT::DIM; i++)
-				dist += (p[i] - q[i]) * (p[i] - q[i]);
-			return sqrt(dist);
+			const double* x = coords_[0].data() + begin;
+			const double* y = coords_[1].data() + begin;
+			const double* z = coords_[2].data() + begin;
+
+			int i = 0;
+#if defined(__AVX__)
+			{
+				const __m256d qx = _mm256_set1_pd(q[0]), qy = _mm256_set1_pd(q[1]), qz = _mm256_set1_pd(q[2]);
+				for (; i + 4 <= count; i += 4)
+				{
+					const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + i), qx);
+					const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + i), qy);
+					const __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z + i), qz);
+					__m256d d = _mm256_mul_pd(dx, dx);
+					d = _mm256_add_pd(d, _mm256_mul_pd(dy, dy));
+					d = _mm256_add_pd(d, _mm256_mul_pd(dz, dz));
+					_mm256_storeu_pd(dist2 + i, d);
+				}
+			}
+#endif
+#if defined(KDTREE_SSE2)
+			{
+				const __m128d qx = _mm_set1_pd(q[0]), qy = _mm_set1_pd(q[1]), qz = _mm_set1_pd(q[2]);
+				for (; i + 2 <= count; i += 2)
+				{
+					const __m128d dx = _mm_sub_pd(_mm_loadu_pd(x + i), qx);
+					const __m128d dy = _mm_sub_pd(_mm_loadu_pd(y + i), qy);
+					const __m128d dz = _mm_sub_pd(_mm_loadu_pd(z + i), qz);
+					__m128d d = _mm_mul_pd(dx, dx);
+					d = _mm_add_pd(d, _mm_mul_pd(dy, dy));
+					d = _mm_add_pd(d, _mm_mul_pd(dz, dz));
+					_mm_storeu_pd(dist2 + i, d);
+				}
+			}
+#endif
+			for (; i < count; i++)
+			{
+				const double dx = x[i] - q[0], dy = y[i] - q[1], dz = z[i] - q[2];
+				dist2[i] = dx * dx + dy * dy + dz * dz;
+			}
 		}
 
-		/** @brief Searches the nearest neighbor recursively.
+		/** @brief Appends the leaf-order positions of the points closer than @p radius to @p q.
 		*/
-		void nnSearchRecursive(const PointT& query, const Node* node, int *guess, double *minDist) const
+		void radiusSearch(const double q[3], double radius, std::vector<int>& positions) const
 		{
-			if (node == nullptr)
+			if (nodes_.empty())
 				return;
 
-			const PointT& train = points_[node->idx];
+			const double radius2 = radius * radius;
+			double dist2[BUCKET_SIZE];
 
-			const double dist = distance(query, train);
-			if (dist < *minDist)
+			StackEntry stack[MAX_STACK];
+			int top = 0;
+			stack[top++] = StackEntry(0, 0);
+			while (top)
 			{
-				*minDist = dist;
-				*guess = node->idx;
+				const StackEntry entry = stack[--top];
+				if (entry.bound >= radius2)
+					continue;
+
+				int n = entry.node;
+				while (nodes_[n].axis >= 0)
+				{
+					const Node& node = nodes_[n];
+					const double diff = q[node.axis] - node.split;
+					const int near = diff < 0 ? n + 1 : node.right;
+					const int far = diff < 0 ? node.right : n + 1;
+					if (diff * diff < radius2)
+						stack[top++] = StackEntry(far, diff * diff);
+					n = near;
+				}
+
+				const Node& leaf = nodes_[n];
+				const int count = leaf.end - leaf.begin;
+				squaredDistances(leaf.begin, count, q, dist2);
+				for (int i = 0; i < count; i++)
+					if (dist2[i] < radius2)
+						positions.push_back(leaf.begin + i);
 			}
+		}
+
+		/** @brief Searches the nearest neighbors into @p heap.
+		*/
+		void knnSearch(const double q[3], KnnHeap& heap) const
+		{
+			if (nodes_.empty())
+				return;
 
-			const int axis = node->axis;
-			const int dir = query[axis] < train[axis] ? 0 : 1;
-			nnSearchRecursive(query, node->next[dir], guess, minDist);
+			double dist2[BUCKET_SIZE];
 
-			const double diff = fabs(query[axis] - train[axis]);
-			if (diff < *minDist)
-				nnSearchRecursive(query, node->next[!dir], guess, minDist);
+			StackEntry stack[MAX_STACK];
+			int top = 0;
+			stack[top++] = StackEntry(0, 0);
+			while (top)
+			{
+				const StackEntry entry = stack[--top];
+				if (entry.bound >= heap.worst())
+					continue;
+
+				int n = entry.node;
+				while (nodes_[n].axis >= 0)
+				{
+					const Node& node = nodes_[n];
+					const double diff = q[node.axis] - node.split;
+					const int near = diff < 0 ? n + 1 : node.right;
+					const int far = diff < 0 ? node.right : n + 1;
+					stack[top++] = StackEntry(far, diff * diff);
+					n = near;
+				}
+
+				const Node& leaf = nodes_[n];
+				const int count = leaf.end - leaf.begin;
+				squaredDistances(leaf.begin, count, q, dist2);
+				for (int i = 0; i < count; i++)
+					if (dist2[i] < heap.worst())
+						heap.push(dist2[i], indices_[leaf.begin + i]);
+			}
 		}
 
-		/** @brief Searches k-nearest neighbors recursively.
+		std::vector<Node> nodes_;          //!< nodes, in depth-first order
+		std::vector<int> indices_;         //!< original index of each point, in leaf order
+		std::array<std::vector<double>, 3> coords_; //!< point coordinates, in leaf order
+	};
+
+	/** @brief k-nearest neighbor cache on a regular grid.
+	For every grid cell that received a query, the cache keeps the points of the tree within d_k(c) + 2r of the
+	cell center c, where d_k(c) is the distance from c to its k-th nearest point and r is the half-diagonal of a cell.
+	By the triangle inequality this set contains the k nearest points of any query inside the cell, so a query is
+	answered exactly by scanning the candidates of its cell. When the queries stay in the same region, as the mesh
+	centroids do between iPSR iterations, only the cells entered for the first time go through the tree.
+	The cache is bounded: a cell that no query of the last maxIdleSearches searches fell into is dropped, and a cell
+	whose candidate set would exceed MAX_CANDIDATES_PER_NEIGHBOR * k points, as it does far from the samples,
+	keeps none and answers its queries from the tree.
+	*/
+	template <class PointT>
+	class KnnCache
+	{
+	public:
+
+		/** @brief The constructor.
+		The tree must outlive the cache and must not be rebuilt while the cache is in use.
 		*/
-		void knnSearchRecursive(const PointT& query, const Node* node, KnnQueue& queue, int k) const
+		KnnCache(const KDTree<PointT>& tree, int k, double cellWidth, int maxIdleSearches = 1) : tree_(tree), k_(k), cellWidth_(cellWidth), maxIdleSearches_(std::max(maxIdleSearches, 1)), searches_(0) {}
+
+		/** @brief Searches k-nearest neighbors of a batch of queries.
+		Same layout and results as KDTree::knnSearch(queries, nqueries, k, indices, dists).
+		*/
+		void knnSearch(const double* queries, int nqueries, int* indices, double* dists = nullptr)
 		{
-			if (node == nullptr)
+			if (nqueries <= 0 || k_ <= 0)
 				return;
+			++searches_;
+			evict();
+
+			// find the cell of every query and create the missing ones
+			std::vector<std::pair<int, int>> order(nqueries);
+			std::vector<unsigned long long> keys(nqueries);
+#pragma omp parallel for
+			for (int i = 0; i < nqueries; i++)
+				keys[i] = cellKey(queries + 3 * i);
+
+			// look the cells up concurrently; the map is only read here
+			const int ncells = (int)cells_.size();
+#pragma omp parallel for
+			for (int i = 0; i < nqueries; i++)
+			{
+				auto it = cellIndices_.find(keys[i]);
+				order[i] = std::make_pair(it == cellIndices_.end() ? -1 : it->second, i);
+			}
 
-			const PointT& train = points_[node->idx];
+			// insert every new cell once, in key order
+			std::vector<unsigned long long> newKeys;
+			for (int i = 0; i < nqueries; i++)
+				if (order[i].first < 0)
+					newKeys.push_back(keys[i]);
+			if (!newKeys.empty())
+			{
+				std::sort(newKeys.begin(), newKeys.end());
+				newKeys.erase(std::unique(newKeys.begin(), newKeys.end()), newKeys.end());
+				cellIndices_.reserve(cellIndices_.size() + newKeys.size());
+				for (size_t j = 0; j < newKeys.size(); j++)
+				{
+					cellIndices_.insert(std::make_pair(newKeys[j], (int)cells_.size()));
+					cells_.push_back(Cell());
+					cellKeys_.push_back(newKeys[j]);
+				}
+#pragma omp parallel for
+				for (int i = 0; i < nqueries; i++)
+					if (order[i].first < 0)
+						order[i].first = cellIndices_.find(keys[i])->second;
+			}
 
-			const double dist = distance(query, train);
-			queue.push(std::make_pair(dist, node->idx));
+#pragma omp parallel for schedule(dynamic)
+			for (int c = ncells; c < (int)cells_.size(); c++)
+				buildCell(c);
 
-			const int axis = node->axis;
-			const int dir = query[axis] < train[axis] ? 0 : 1;
-			knnSearchRecursive(query, node->next[dir], queue, k);
+			// answer the queries cell by cell
+			std::sort(order.begin(), order.end());
+			for (int i = 0; i < nqueries; i++)
+				if (i == 0 || order[i].first != order[i - 1].first)
+					cells_[order[i].first].lastSearch = searches_;
 
-			const double diff = fabs(query[axis] - train[axis]);
-			if ((int)queue.size() < k || diff < queue.back().first)
-				knnSearchRecursive(query, node->next[!dir], queue, k);
+#pragma omp parallel
+			{
+				typename KDTree<PointT>::KnnHeap heap(k_);
+#pragma omp for schedule(dynamic, 1024)
+				for (int i = 0; i < nqueries; i++)
+				{
+					const int q = order[i].second;
+					const double* p = queries + 3 * q;
+					const Cell& cell = cells_[order[i].first];
+
+					// a candidate at distance r from the cell center is at least r - |p - center| away from p
+					double offset2 = 0;
+					for (int d = 0; d < 3; d++)
+						offset2 += (p[d] - cell.center[d]) * (p[d] - cell.center[d]);
+					const double offset = sqrt(offset2);
+
+					heap.clear();
+					if (!cell.cached)
+						tree_.knnSearch(p, heap);
+					else for (size_t j = 0; j < cell.candidates.size(); j++)
+					{
+						const Candidate& candidate = cell.candidates[j];
+						const double dx = candidate.p[0] - p[0], dy = candidate.p[1] - p[1], dz = candidate.p[2] - p[2];
+						const double dist2 = dx * dx + dy * dy + dz * dz;
+						const double worst = heap.worst();
+						if (dist2 < worst)
+							heap.push(dist2, candidate.index);
+						else if (candidate.r > offset)
+						{
+							// the candidates are sorted by r, so no later one can enter the heap either
+							const double bound = candidate.r - offset;
+							if (bound * bound > worst * (1 + 1e-9))
+								break;
+						}
+					}
+					heap.sort();
+
+					int* idx = indices + (size_t)q * k_;
+					for (int j = 0; j < k_; j++)
+						idx[j] = j < (int)heap.size() ? heap[j].second : -1;
+					if (dists)
+					{
+						double* dist = dists + (size_t)q * k_;
+						for (int j = 0; j < k_; j++)
+							dist[j] = j < (int)heap.size() ? sqrt(heap[j].first) : -1;
+					}
+				}
+			}
 		}
 
-		/** @brief Searches neighbors within radius.
+		/** @brief Drops all cached cells.
 		*/
-		void radiusSearchRecursive(const PointT& query, const Node* node, std::vector<int>& indices, double radius) const
+		void clear()
 		{
-			if (node == nullptr)
+			std::vector<Cell>().swap(cells_);
+			std::vector<unsigned long long>().swap(cellKeys_);
+			cellIndices_.clear();
+		}
+
+		/** @brief Number of cached cells.
+		*/
+		size_t size() const { return cells_.size(); }
+
+	private:
+
+		static const int KEY_BITS = 21;
+		static const int MAX_CANDIDATES_PER_NEIGHBOR = 8;
+
+		/** @brief Drops the cells that no query fell into during the last maxIdleSearches searches.
+		*/
+		void evict()
+		{
+			size_t kept = 0;
+			for (size_t c = 0; c < cells_.size(); c++)
+				if (cells_[c].lastSearch + maxIdleSearches_ >= searches_)
+				{
+					if (kept != c)
+					{
+						std::swap(cells_[kept], cells_[c]);
+						cellKeys_[kept] = cellKeys_[c];
+					}
+					kept++;
+				}
+			if (kept == cells_.size())
 				return;
+			cells_.resize(kept);
+			cellKeys_.resize(kept);
+			cellIndices_.clear();
+			for (size_t c = 0; c < kept; c++)
+				cellIndices_.insert(std::make_pair(cellKeys_[c], (int)c));
+		}
 
-			const PointT& train = points_[node->idx];
+		unsigned long long cellKey(const double* p) const
+		{
+			unsigned long long key = 0;
+			for (int d = 0; d < 3; d++)
+			{
+				long long c = (long long)floor(p[d] / cellWidth_) + (1LL << (KEY_BITS - 1));
+				c = std::min(std::max(c, 0LL), (1LL << KEY_BITS) - 1);
+				key |= (unsigned long long)c << (KEY_BITS * d);
+			}
+			return key;
+		}
 
-			const double dist = distance(query, train);
-			if (dist < radius)
-				indices.push_back(node->idx);
+		/** @brief Collects the candidates of cell @p c, sorted by increasing distance to its center.
+		*/
+		void buildCell(int c)
+		{
+			Cell& cell = cells_[c];
+			for (int d = 0; d < 3; d++)
+			{
+				const long long i = (long long)((cellKeys_[c] >> (KEY_BITS * d)) & ((1ULL << KEY_BITS) - 1)) - (1LL << (KEY_BITS - 1));
+				cell.center[d] = (i + 0.5) * cellWidth_;
+			}
 
-			const int axis = node->axis;
-			const int dir = query[axis] < train[axis] ? 0 : 1;
-			radiusSearchRecursive(query, node->next[dir], indices, radius);
+			std::vector<int> positions;
+			typename KDTree<PointT>::KnnHeap heap(k_);
+			tree_.knnSearch(cell.center, heap);
+			if ((int)heap.size() < k_)
+			{
+				positions.resize(tree_.indices_.size());
+				std::iota(positions.begin(), positions.end(), 0);
+			}
+			else
+			{
+				// the small relative slack keeps points exactly on the bounding sphere
+				const double radius = (sqrt(heap.worst()) + cellWidth_ * sqrt(3.0)) * (1 + 1e-9);
+				tree_.radiusSearch(cell.center, radius, positions);
+			}
+			cell.cached = positions.size() <= (size_t)MAX_CANDIDATES_PER_NEIGHBOR * k_;
+			if (!cell.cached)
+				return;
 
-			const double diff = fabs(query[axis] - train[axis]);
-			if (diff < radius)
-				radiusSearchRecursive(query, node->next[!dir], indices, radius);
+			cell.candidates.resize(positions.size());
+			for (size_t j = 0; j < positions.size(); j++)
+			{
+				Candidate& candidate = cell.candidates[j];
+				double r2 = 0;
+				for (int d = 0; d < 3; d++)
+				{
+					candidate.p[d] = tree_.coords_[d][positions[j]];
+					r2 += (candidate.p[d] - cell.center[d]) * (candidate.p[d] - cell.center[d]);
+				}
+				candidate.r = sqrt(r2);
+				candidate.index = tree_.indices_[positions[j]];
+			}
+			std::sort(cell.candidates.begin(), cell.candidates.end(), [](const Candidate& lhs, const Candidate& rhs)
+			{
+				return lhs.r < rhs.r;
+			});
 		}
 
-		Node* root_;                 //!< root node
-		std::vector<PointT> points_; //!< points
+		/** @brief Cached point, with its distance to the center of the cell.
+		*/
+		struct Candidate
+		{
+			double p[3];
+			double r;
+			int index;
+		};
+
+		struct Cell
+		{
+			double center[3];
+			std::vector<Candidate> candidates;
+			bool cached;        //!< false if the candidates would be too many, the queries then go to the tree
+			int lastSearch;     //!< the last search with a query in the cell
+		};
+
+		const KDTree<PointT>& tree_;
+		int k_;
+		double cellWidth_;
+		int maxIdleSearches_;                                        //!< searches a cell is kept without queries
+		int searches_;                                               //!< searches so far
+		std::vector<Cell> cells_;                                    //!< cached cells
+		std::vector<unsigned long long> cellKeys_;                   //!< grid key of each cell
+		std::unordered_map<unsigned long long, int> cellIndices_;    //!< grid key to cell
 	};
 } // kdt
 
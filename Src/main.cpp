@@ -23,154 +23,31 @@ SOFTWARE.
 
 #include <vector>
 #include <string>
-#include <queue>
 #include <algorithm>
-#include "kdtree.h"
-#include "utility.h"
-#include "PoissonRecon.h"
+#include "IPSR.h"
 
 using namespace std;
 
-void ipsr(const string &input_name, const string &output_name, int iters, double pointweight, int depth, int k_neighbors)
+void ipsr(const string &input_name, const string &output_name, const IPSRParameters &parameters, bool ascii)
 {
 	typedef double REAL;
 	const unsigned int DIM = 3U;
 
-	vector<pair<Point<REAL, DIM>, Normal<REAL, DIM>>> points_normals;
-	ply_reader<REAL, DIM>(input_name, points_normals);
+	vector<Point<REAL, DIM>> points;
+	if (!ply_reader<REAL, DIM>(input_name, points))
+		return;
 
-	string command = "PoissonRecon --in i.ply --out o.ply --bType 2 --depth " + to_string(depth) + " --pointWeight " + to_string(pointweight);
-	vector<string> cmd = split(command);
-	vector<char *> argv_str(cmd.size());
-	for (size_t i = 0; i < cmd.size(); ++i)
-		argv_str[i] = &cmd[i][0];
+	IPSR<REAL> reconstructor(parameters);
+	IPSR<REAL>::Mesh mesh = reconstructor.reconstruct(points.data(), points.size());
 
-	XForm<REAL, DIM + 1> iXForm;
-	vector<double> weight_samples;
-	// sample points by the octree
-	points_normals = sample_points<REAL, DIM>((int)argv_str.size(), argv_str.data(), points_normals, iXForm, &weight_samples);
-
-	// initialize normals randomly
-	printf("random initialization...\n");
-	Normal<REAL, DIM> zero_normal(Point<REAL, DIM>(0, 0, 0));
-	srand(0);
-	for (size_t i = 0; i < points_normals.size(); ++i)
-	{
-		do
-		{
-			points_normals[i].second = Point<REAL, DIM>(rand() % 1001 - 500.0, rand() % 1001 - 500.0, rand() % 1001 - 500.0);
-		} while (points_normals[i].second == zero_normal);
-		normalize<REAL, DIM>(points_normals[i].second);
-	}
-
-	// construct the Kd-Tree
-	kdt::KDTree<kdt::KDTreePoint> tree;
-	{
-		vector<kdt::KDTreePoint> vertices;
-		vertices.reserve(points_normals.size());
-		for (size_t i = 0; i < points_normals.size(); ++i)
-		{
-			array<double, 3> p{points_normals[i].first[0], points_normals[i].first[1], points_normals[i].first[2]};
-			vertices.push_back(kdt::KDTreePoint(p));
-		}
-		tree.build(vertices);
-	}
-
-	pair<vector<Point<REAL, DIM>>, vector<vector<int>>> mesh;
-
-	// iterations
-	int epoch = 0;
-	while (epoch < iters)
-	{
-		++epoch;
-		printf("Iter: %d\n", epoch);
-
-		vector<Point<REAL, DIM>>().swap(mesh.first);
-		vector<vector<int>>().swap(mesh.second);
-
-		// Poisson reconstruction
-		mesh = poisson_reconstruction<REAL, DIM>((int)argv_str.size(), argv_str.data(), points_normals, &weight_samples);
-
-		vector<vector<int>> nearestSamples(mesh.second.size());
-		vector<Point<REAL, DIM>> normals(mesh.second.size());
-
-		// compute face normals and map them to sample points
-#pragma omp parallel for
-		for (int i = 0; i < (int)nearestSamples.size(); i++)
-		{
-			if (mesh.second[i].size() == 3)
-			{
-				Point<REAL, DIM> c = mesh.first[mesh.second[i][0]] + mesh.first[mesh.second[i][1]] + mesh.first[mesh.second[i][2]];
-				c /= 3;
-				array<REAL, DIM> a{c[0], c[1], c[2]};
-				nearestSamples[i] = tree.knnSearch(kdt::KDTreePoint(a), k_neighbors);
-				normals[i] = Point<REAL, DIM>::CrossProduct(mesh.first[mesh.second[i][1]] - mesh.first[mesh.second[i][0]], mesh.first[mesh.second[i][2]] - mesh.first[mesh.second[i][0]]);
-			}
-		}
-
-		// update sample point normals
-		vector<Normal<REAL, DIM>> projective_normals(points_normals.size(), zero_normal);
-		for (size_t i = 0; i < nearestSamples.size(); i++)
-		{
-			for (size_t j = 0; j < nearestSamples[i].size(); ++j)
-			{
-				projective_normals[nearestSamples[i][j]].normal[0] += normals[i][0];
-				projective_normals[nearestSamples[i][j]].normal[1] += normals[i][1];
-				projective_normals[nearestSamples[i][j]].normal[2] += normals[i][2];
-			}
-		}
-
-#pragma omp parallel for
-		for (int i = 0; i < (int)projective_normals.size(); ++i)
-			normalize<REAL, DIM>(projective_normals[i]);
-
-		// compute the average normal variation of the top 1/1000 points
-		size_t heap_size = static_cast<size_t>(ceil(points_normals.size() / 1000.0));
-		priority_queue<double, vector<double>, greater<double>> min_heap;
-		for (size_t i = 0; i < points_normals.size(); ++i)
-		{
-			if (!(projective_normals[i] == zero_normal))
-			{
-				double diff = Point<REAL, DIM>::SquareNorm((projective_normals[i] - points_normals[i].second).normal);
-				if (min_heap.size() < heap_size)
-					min_heap.push(diff);
-				else if (diff > min_heap.top())
-				{
-					min_heap.pop();
-					min_heap.push(diff);
-				}
-
-				points_normals[i].second = projective_normals[i];
-			}
-		}
-
-		heap_size = min_heap.size();
-		double ave_max_diff = 0;
-		while (!min_heap.empty())
-		{
-			ave_max_diff += sqrt(min_heap.top());
-			min_heap.pop();
-		}
-		ave_max_diff /= heap_size;
-		printf("normals variation %f\n", ave_max_diff);
-		if (ave_max_diff < 0.175)
-			break;
-	}
-
-	mesh = poisson_reconstruction<REAL, DIM>((int)argv_str.size(), argv_str.data(), points_normals, &weight_samples);
-
-	output_ply(output_name, mesh, iXForm);
-	// output_sample_points_and_normals<REAL, DIM>("points_normals_samples.ply", points_normals, iXForm);
-	// output_all_points_and_normals<REAL, DIM>("points_normals_all.ply", input_name, points_normals, tree, iXForm);
+	output_ply(output_name, mesh, XForm<REAL, DIM + 1>::Identity(), ascii);
 }
 
 int main(int argc, char *argv[])
 {
 	string input_name, output_name;
-	int iters = 30;
-	double pointweight = 10;
-	int depth = 10;
-	int k_neighbors = 10;
+	IPSRParameters parameters;
+	bool ascii = false;
 	for (int i = 1; i < argc; i += 2)
 	{
 		if (strcmp(argv[i], "--in") == 0)
@@ -205,12 +82,12 @@ int main(int argc, char *argv[])
 				printf("invalid value of --iters");
 				return 0;
 			}
-			iters = static_cast<int>(v);
+			parameters.iters = static_cast<int>(v);
 		}
 		else if (strcmp(argv[i], "--pointWeight") == 0)
 		{
-			pointweight = strtod(argv[i + 1], nullptr);
-			if (pointweight < 0.0 || pointweight == HUGE_VAL || pointweight == -HUGE_VAL)
+			parameters.point_weight = strtod(argv[i + 1], nullptr);
+			if (parameters.point_weight < 0.0 || parameters.point_weight == HUGE_VAL || parameters.point_weight == -HUGE_VAL)
 			{
 				printf("invalid value of --pointWeight");
 				return 0;
@@ -224,7 +101,7 @@ int main(int argc, char *argv[])
 				printf("invalid value of --depth");
 				return 0;
 			}
-			depth = static_cast<int>(v);
+			parameters.depth = static_cast<int>(v);
 		}
 		else if (strcmp(argv[i], "--neighbors") == 0)
 		{
@@ -234,7 +111,90 @@ int main(int argc, char *argv[])
 				printf("invalid value of --neighbors");
 				return 0;
 			}
-			k_neighbors = static_cast<int>(v);
+			parameters.neighbors = static_cast<int>(v);
+		}
+		else if (strcmp(argv[i], "--initializations") == 0)
+		{
+			long v = strtol(argv[i + 1], nullptr, 10);
+			if (!valid_parameter(v))
+			{
+				printf("invalid value of --initializations");
+				return 0;
+			}
+			parameters.initializations = static_cast<int>(v);
+		}
+		else if (strcmp(argv[i], "--pcgIters") == 0)
+		{
+			long v = strtol(argv[i + 1], nullptr, 10);
+			// 0 is the default and keeps the Gauss-Seidel relaxation of the finest depth
+			if (v < 0 || v >= INT_MAX)
+			{
+				printf("invalid value of --pcgIters");
+				return 0;
+			}
+			parameters.pcg_iters = static_cast<int>(v);
+		}
+		else if (strcmp(argv[i], "--residualTolerance") == 0)
+		{
+			parameters.residual_tolerance = strtod(argv[i + 1], nullptr);
+			if (!(parameters.residual_tolerance >= 0.0) || parameters.residual_tolerance == HUGE_VAL)
+			{
+				printf("invalid value of --residualTolerance");
+				return 0;
+			}
+		}
+		else if (strcmp(argv[i], "--telemetry") == 0)
+		{
+			parameters.telemetry = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "--variationFraction") == 0)
+		{
+			parameters.variation_fraction = strtod(argv[i + 1], nullptr);
+			if (!(parameters.variation_fraction > 0.0 && parameters.variation_fraction <= 1.0))
+			{
+				printf("invalid value of --variationFraction");
+				return 0;
+			}
+		}
+		else if (strcmp(argv[i], "--variationThreshold") == 0)
+		{
+			parameters.variation_threshold = strtod(argv[i + 1], nullptr);
+			if (parameters.variation_threshold < 0.0 || parameters.variation_threshold == HUGE_VAL)
+			{
+				printf("invalid value of --variationThreshold");
+				return 0;
+			}
+		}
+		else if (strcmp(argv[i], "--ascii") == 0)
+		{
+			// a flag without a value
+			ascii = true;
+			--i;
+		}
+		else if (strcmp(argv[i], "--matrixFree") == 0)
+		{
+			parameters.matrix_free = true;
+			--i;
+		}
+		else if (strcmp(argv[i], "--mixedPrecision") == 0)
+		{
+			parameters.mixed_precision = true;
+			--i;
+		}
+		else if (strcmp(argv[i], "--cacheMatrices") == 0)
+		{
+			parameters.cache_matrices = true;
+			--i;
+		}
+		else if (strcmp(argv[i], "--concurrentSlices") == 0)
+		{
+			parameters.concurrent_slices = true;
+			--i;
+		}
+		else if (strcmp(argv[i], "--mortonOrder") == 0)
+		{
+			parameters.morton_order = true;
+			--i;
 		}
 		else
 		{
@@ -252,6 +212,18 @@ int main(int argc, char *argv[])
 		printf("--pointWeight (optional)  screened weight of SPSR, default 10\n");
 		printf("--depth (optional)        maximum depth of the octree, default 10\n");
 		printf("--neighbors (optional)    number of the nearest neighbors to search, default 10\n");
+		printf("--initializations (optional)  number of random initializations iterated together, the best converged one is output, default 1\n");
+		printf("--variationFraction (optional)   fraction of the samples with the largest normal change that measures convergence, default 0.001\n");
+		printf("--variationThreshold (optional)  stop when their average normal change is below this value, default 0.175\n");
+		printf("--ascii (optional)        write the output in ascii instead of binary .ply\n");
+		printf("--matrixFree (optional)   apply the Poisson stencil on the fly where possible to save memory\n");
+		printf("--mixedPrecision (optional)  store the solver matrices in single precision to speed up the relaxations\n");
+		printf("--cacheMatrices (optional)   keep the solver matrices for all the iterations, faster but takes more memory\n");
+		printf("--concurrentSlices (optional)  relax the slice blocks of a solver step in parallel, keeps more blocks in memory\n");
+		printf("--mortonOrder (optional)  sort the points along a Z-curve of the octree before sampling them, faster on unordered scans\n");
+		printf("--pcgIters (optional)     solve the finest depth with preconditioned conjugate gradients, running at most this many iterations, default 0 (Gauss-Seidel)\n");
+		printf("--residualTolerance (optional) the --pcgIters iterations stop once the relative residual is below this value, default 0.001\n");
+		printf("--telemetry (optional)    append the size, timings, residuals and estimated memory traffic of the solve of every depth to this file as JSON lines\n");
 		return 0;
 	}
 
@@ -259,12 +231,24 @@ int main(int argc, char *argv[])
 	printf("Parameters:\n");
 	printf("--in          %s\n", input_name.c_str());
 	printf("--out         %s\n", output_name.c_str());
-	printf("--iters       %d\n", iters);
-	printf("--pointWeight %f\n", pointweight);
-	printf("--depth       %d\n", depth);
-	printf("--neighbors   %d\n\n", k_neighbors);
-
-	ipsr(input_name, output_name, iters, pointweight, depth, k_neighbors);
+	printf("--iters       %d\n", parameters.iters);
+	printf("--pointWeight %f\n", parameters.point_weight);
+	printf("--depth       %d\n", parameters.depth);
+	printf("--neighbors   %d\n", parameters.neighbors);
+	printf("--initializations %d\n", parameters.initializations);
+	printf("--variationFraction  %f\n", parameters.variation_fraction);
+	printf("--variationThreshold %f\n", parameters.variation_threshold);
+	printf("--ascii       %s\n", ascii ? "true" : "false");
+	printf("--matrixFree  %s\n", parameters.matrix_free ? "true" : "false");
+	printf("--mixedPrecision %s\n", parameters.mixed_precision ? "true" : "false");
+	printf("--cacheMatrices  %s\n", parameters.cache_matrices ? "true" : "false");
+	printf("--concurrentSlices %s\n", parameters.concurrent_slices ? "true" : "false");
+	printf("--mortonOrder %s\n", parameters.morton_order ? "true" : "false");
+	printf("--pcgIters    %d\n", parameters.pcg_iters);
+	printf("--residualTolerance %f\n", parameters.residual_tolerance);
+	printf("--telemetry   %s\n\n", parameters.telemetry.empty() ? "none" : parameters.telemetry.c_str());
+
+	ipsr(input_name, output_name, parameters, ascii);
 
 	return 0;
 }
@@ -27,7 +27,19 @@ SOFTWARE.
 #include <vector>
 #include <string>
 #include <climits>
-#include <fstream>
+#include <limits>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define IPSR_USE_MMAP
+#endif
 #include "kdtree.h"
 #include "PointStream.h"
 #include "PointStreamData.h"
@@ -41,24 +53,505 @@ void transform(std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &poin
 	}
 }
 
+// invert the map from faces to their k nearest samples (nearest[f * k + j], -1 for none) into a CSR map from samples to faces:
+// the faces of sample s are faces[offsets[s]] ... faces[offsets[s + 1] - 1], in increasing order
+inline void invert_nearest_samples(const std::vector<int> &nearest, int k, size_t sample_count, std::vector<int> &offsets, std::vector<int> &faces)
+{
+	const int face_count = k > 0 ? (int)(nearest.size() / k) : 0;
+
+	// count the faces of every sample
+	offsets.assign(sample_count + 1, 0);
+#pragma omp parallel for
+	for (int i = 0; i < (int)nearest.size(); ++i)
+	{
+		if (nearest[i] >= 0)
+		{
+#pragma omp atomic
+			++offsets[nearest[i] + 1];
+		}
+	}
+	for (size_t s = 0; s < sample_count; ++s)
+		offsets[s + 1] += offsets[s];
+
+	// scatter the faces, then restore the face order inside every sample
+	faces.resize(offsets[sample_count]);
+	std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+#pragma omp parallel for
+	for (int f = 0; f < face_count; ++f)
+	{
+		for (int j = 0; j < k; ++j)
+		{
+			int s = nearest[(size_t)f * k + j];
+			if (s < 0)
+				continue;
+			int slot;
+#pragma omp atomic capture
+			slot = cursor[s]++;
+			faces[slot] = f;
+		}
+	}
+#pragma omp parallel for schedule(dynamic, 1024)
+	for (int s = 0; s < (int)sample_count; ++s)
+		std::sort(faces.begin() + offsets[s], faces.begin() + offsets[s + 1]);
+}
+
+// average normal change of the given fraction of the samples that change the most (at least one sample);
+// samples whose new normal is zero did not receive any face and are ignored, and if no sample received
+// a face the variation is infinite, so that a degenerate mesh is never taken for convergence
+template <class Real, unsigned int Dim>
+double normal_variation(const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &points_normals, const std::vector<Normal<Real, Dim>> &new_normals, double fraction)
+{
+	const Normal<Real, Dim> zero_normal(Point<Real, Dim>(0, 0, 0));
+	std::vector<double> diffs(points_normals.size());
+	size_t changed = 0;
+#pragma omp parallel for reduction(+ : changed)
+	for (int i = 0; i < (int)points_normals.size(); ++i)
+	{
+		if (new_normals[i] == zero_normal)
+			diffs[i] = -1;
+		else
+		{
+			diffs[i] = Point<Real, Dim>::SquareNorm((new_normals[i] - points_normals[i].second).normal);
+			++changed;
+		}
+	}
+
+	size_t count = std::min(changed, std::max<size_t>(1, static_cast<size_t>(ceil(points_normals.size() * fraction))));
+	if (count == 0)
+		return std::numeric_limits<double>::infinity();
+	std::nth_element(diffs.begin(), diffs.begin() + (count - 1), diffs.end(), std::greater<double>());
+	std::sort(diffs.begin(), diffs.begin() + count);
+
+	double variation = 0;
+	for (size_t i = 0; i < count; ++i)
+		variation += sqrt(diffs[i]);
+	return variation / count;
+}
+
+// read-only image of a whole file, memory mapped where the platform allows it and read into memory otherwise
+class mapped_file
+{
+public:
+	mapped_file() : data_(nullptr), size_(0), mapped_(false) {}
+	~mapped_file() { close(); }
+
+	bool open(const std::string &file)
+	{
+		close();
+#ifdef IPSR_USE_MMAP
+		int fd = ::open(file.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED)
+			{
+				madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+				data_ = (const char *)p;
+				size_ = (size_t)st.st_size;
+				mapped_ = true;
+			}
+		}
+		::close(fd);
+		if (mapped_)
+			return true;
+#endif
+		FILE *fp = fopen(file.c_str(), "rb");
+		if (!fp)
+			return false;
+		const size_t block = 1 << 24;
+		size_t read = 0;
+		do
+		{
+			buffer_.resize(read + block);
+			read += fread(&buffer_[read], 1, block, fp);
+		} while (read == buffer_.size());
+		fclose(fp);
+		buffer_.resize(read);
+		data_ = buffer_.data();
+		size_ = read;
+		return true;
+	}
+
+	void close()
+	{
+#ifdef IPSR_USE_MMAP
+		if (mapped_)
+			munmap((void *)data_, size_);
+#endif
+		std::vector<char>().swap(buffer_);
+		data_ = nullptr;
+		size_ = 0;
+		mapped_ = false;
+	}
+
+	const char *data() const { return data_; }
+	size_t size() const { return size_; }
+
+private:
+	mapped_file(const mapped_file &) = delete;
+	mapped_file &operator=(const mapped_file &) = delete;
+
+	const char *data_;
+	size_t size_;
+	bool mapped_;
+	std::vector<char> buffer_;
+};
+
+enum ply_scalar_type
+{
+	PLY_UNKNOWN,
+	PLY_INT8,
+	PLY_UINT8,
+	PLY_INT16,
+	PLY_UINT16,
+	PLY_INT32,
+	PLY_UINT32,
+	PLY_FLOAT32,
+	PLY_FLOAT64
+};
+
+inline ply_scalar_type ply_type(const std::string &type)
+{
+	if (type == "char" || type == "int8")
+		return PLY_INT8;
+	if (type == "uchar" || type == "uint8")
+		return PLY_UINT8;
+	if (type == "short" || type == "int16")
+		return PLY_INT16;
+	if (type == "ushort" || type == "uint16")
+		return PLY_UINT16;
+	if (type == "int" || type == "int32")
+		return PLY_INT32;
+	if (type == "uint" || type == "uint32")
+		return PLY_UINT32;
+	if (type == "float" || type == "float32")
+		return PLY_FLOAT32;
+	if (type == "double" || type == "float64")
+		return PLY_FLOAT64;
+	return PLY_UNKNOWN;
+}
+
+// size in bytes of a scalar .ply property type, 0 if the type is unknown
+inline size_t ply_type_size(ply_scalar_type type)
+{
+	static const size_t sizes[] = {0, 1, 1, 2, 2, 4, 4, 4, 8};
+	return sizes[type];
+}
+
+// convert one binary .ply scalar to double, swapping its bytes if the file and the machine disagree on endianness
+inline double ply_binary_value(const char *src, ply_scalar_type type, bool swap)
+{
+	unsigned char bytes[8];
+	const size_t size = ply_type_size(type);
+	if (swap)
+		for (size_t i = 0; i < size; ++i)
+			bytes[i] = (unsigned char)src[size - 1 - i];
+	else
+		memcpy(bytes, src, size);
+
+	switch (type)
+	{
+	case PLY_INT8:
+		return (double)(int8_t)bytes[0];
+	case PLY_UINT8:
+		return (double)bytes[0];
+	case PLY_INT16:
+	{
+		int16_t v;
+		memcpy(&v, bytes, 2);
+		return v;
+	}
+	case PLY_UINT16:
+	{
+		uint16_t v;
+		memcpy(&v, bytes, 2);
+		return v;
+	}
+	case PLY_INT32:
+	{
+		int32_t v;
+		memcpy(&v, bytes, 4);
+		return v;
+	}
+	case PLY_UINT32:
+	{
+		uint32_t v;
+		memcpy(&v, bytes, 4);
+		return v;
+	}
+	case PLY_FLOAT32:
+	{
+		float v;
+		memcpy(&v, bytes, 4);
+		return v;
+	}
+	case PLY_FLOAT64:
+	{
+		double v;
+		memcpy(&v, bytes, 8);
+		return v;
+	}
+	default:
+		return 0;
+	}
+}
+
+// read the vertex positions of a .ply file in place from its mapped image, converting them in parallel;
+// returns false for layouts it does not handle (e.g. list properties on or before the vertices), which are left to the generic parser,
+// and also when an ascii vertex line has too few values, in which case malformed is set and the file should not be parsed further
+template <class Real, unsigned int Dim>
+bool ply_reader_mapped(const std::string &file, std::vector<Point<Real, Dim>> &points, bool &malformed)
+{
+	malformed = false;
+	if (Dim != 3)
+		return false;
+
+	mapped_file image;
+	if (!image.open(file))
+		return false;
+	const char *data = image.data();
+	const size_t size = image.size();
+
+	// parse the header
+	const char *end_header = nullptr;
+	for (const char *line = data; line < data + size;)
+	{
+		const char *eol = (const char *)memchr(line, '\n', data + size - line);
+		if (!eol)
+			return false;
+		if (eol - line >= 10 && strncmp(line, "end_header", 10) == 0)
+		{
+			end_header = eol + 1;
+			break;
+		}
+		line = eol + 1;
+	}
+	if (!end_header)
+		return false;
+
+	struct element
+	{
+		std::string name;
+		size_t count;
+		std::vector<std::pair<std::string, std::string>> properties; // type and name
+		bool has_list;
+	};
+	std::vector<element> elements;
+	std::string format;
+	{
+		std::istringstream header(std::string(data, end_header));
+		std::string line;
+		while (std::getline(header, line))
+		{
+			std::istringstream words(line);
+			std::string keyword;
+			words >> keyword;
+			if (keyword == "format")
+				words >> format;
+			else if (keyword == "element")
+			{
+				element e;
+				words >> e.name >> e.count;
+				e.has_list = false;
+				elements.push_back(e);
+			}
+			else if (keyword == "property" && !elements.empty())
+			{
+				std::string type, name;
+				words >> type;
+				if (type == "list")
+				{
+					elements.back().has_list = true;
+					std::string count_type;
+					words >> count_type >> type;
+				}
+				words >> name;
+				elements.back().properties.push_back(std::make_pair(type, name));
+			}
+		}
+	}
+
+	size_t vertex_element = elements.size();
+	for (size_t i = 0; i < elements.size(); ++i)
+		if (elements[i].name == "vertex")
+		{
+			vertex_element = i;
+			break;
+		}
+	if (vertex_element == elements.size() || elements[vertex_element].has_list)
+		return false;
+	const element &vertices = elements[vertex_element];
+
+	// column and byte offset of x, y and z in a vertex record
+	const char *axis_names[3] = {"x", "y", "z"};
+	int columns[3];
+	size_t offsets[3], stride = 0;
+	ply_scalar_type types[3];
+	for (int d = 0; d < 3; ++d)
+		columns[d] = -1;
+	for (size_t j = 0; j < vertices.properties.size(); ++j)
+	{
+		size_t type_size = ply_type_size(ply_type(vertices.properties[j].first));
+		if (!type_size)
+			return false;
+		for (int d = 0; d < 3; ++d)
+			if (vertices.properties[j].second == axis_names[d])
+			{
+				columns[d] = (int)j;
+				offsets[d] = stride;
+				types[d] = ply_type(vertices.properties[j].first);
+			}
+		stride += type_size;
+	}
+	for (int d = 0; d < 3; ++d)
+		if (columns[d] < 0)
+			return false;
+
+	const size_t first = points.size();
+	const long long count = (long long)vertices.count;
+
+	if (format == "binary_little_endian" || format == "binary_big_endian")
+	{
+		// skip the elements stored before the vertices
+		size_t begin = end_header - data;
+		for (size_t i = 0; i < vertex_element; ++i)
+		{
+			if (elements[i].has_list)
+				return false;
+			size_t element_stride = 0;
+			for (size_t j = 0; j < elements[i].properties.size(); ++j)
+			{
+				size_t type_size = ply_type_size(ply_type(elements[i].properties[j].first));
+				if (!type_size)
+					return false;
+				element_stride += type_size;
+			}
+			begin += element_stride * elements[i].count;
+		}
+		if (begin > size || (size - begin) / stride < vertices.count)
+			return false;
+
+		const uint16_t one = 1;
+		const bool little_endian_host = *(const unsigned char *)&one == 1;
+		const bool swap = (format == "binary_little_endian") != little_endian_host;
+
+		points.resize(first + count);
+		const char *records = data + begin;
+#pragma omp parallel for
+		for (long long i = 0; i < count; ++i)
+		{
+			const char *record = records + i * stride;
+			Point<Real, Dim> p;
+			for (int d = 0; d < 3; ++d)
+				p[d] = (Real)ply_binary_value(record + offsets[d], types[d], swap);
+			points[first + i] = p;
+		}
+		return true;
+	}
+
+	if (format != "ascii" || vertex_element != 0)
+		return false;
+
+	// split the body into chunks starting at line boundaries and count the lines of each chunk
+	const char *body = end_header, *body_end = data + size;
+	const size_t chunk_size = 1 << 20;
+	std::vector<const char *> chunks(1, body);
+	while (body_end - chunks.back() > (std::ptrdiff_t)chunk_size)
+	{
+		const char *eol = (const char *)memchr(chunks.back() + chunk_size, '\n', body_end - chunks.back() - chunk_size);
+		if (!eol || eol + 1 == body_end)
+			break;
+		chunks.push_back(eol + 1);
+	}
+	chunks.push_back(body_end);
+
+	const int chunk_count = (int)chunks.size() - 1;
+	std::vector<long long> first_lines(chunk_count + 1, 0);
+#pragma omp parallel for
+	for (int c = 0; c < chunk_count; ++c)
+		first_lines[c + 1] = std::count(chunks[c], chunks[c + 1], '\n') + (chunks[c + 1] == body_end && chunks[c + 1] > chunks[c] && chunks[c + 1][-1] != '\n');
+	for (int c = 0; c < chunk_count; ++c)
+		first_lines[c + 1] += first_lines[c];
+	if (first_lines[chunk_count] < count)
+		return false;
+
+	const int last_column = std::max(columns[0], std::max(columns[1], columns[2]));
+	bool valid = true;
+	points.resize(first + count);
+#pragma omp parallel for schedule(dynamic) reduction(&& : valid)
+	for (int c = 0; c < chunk_count; ++c)
+	{
+		// every line is parsed from a NUL-terminated copy, so that strtod can neither run past the end of the file
+		// nor skip the line break and take missing values from the next line
+		std::string line;
+		const char *cursor = chunks[c];
+		for (long long i = first_lines[c]; i < first_lines[c + 1] && i < count && valid; ++i)
+		{
+			const char *eol = (const char *)memchr(cursor, '\n', chunks[c + 1] - cursor);
+			if (!eol)
+				eol = chunks[c + 1];
+			line.assign(cursor, eol);
+			cursor = eol < chunks[c + 1] ? eol + 1 : eol;
+
+			Point<Real, Dim> p;
+			const char *value = line.c_str();
+			char *next;
+			for (int j = 0; j <= last_column; ++j)
+			{
+				double v = strtod(value, &next);
+				if (next == value)
+				{
+					valid = false;
+					break;
+				}
+				value = next;
+				for (int d = 0; d < 3; ++d)
+					if (columns[d] == j)
+						p[d] = (Real)v;
+			}
+			points[first + i] = p;
+		}
+	}
+	if (!valid)
+	{
+		points.resize(first);
+		malformed = true;
+	}
+	return valid;
+}
+
+// read the vertex positions of a .ply file; returns false if the file is malformed
 template <class Real, unsigned int Dim>
-void ply_reader(const std::string &file, std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &points_normals)
+bool ply_reader(const std::string &file, std::vector<Point<Real, Dim>> &points)
 {
+	bool malformed;
+	if (ply_reader_mapped<Real, Dim>(file, points, malformed))
+		return true;
+	if (malformed)
+	{
+		printf("A vertex line of %s has too few values\n", file.c_str());
+		return false;
+	}
+
 	PLYInputPointStream<Real, Dim> ply(file.c_str());
-	Normal<Real, Dim> n(Point<Real, Dim>(1, 0, 0));
 	Point<Real, Dim> p;
 	while (ply.nextPoint(p))
-		points_normals.push_back(std::make_pair(p, n));
+		points.push_back(p);
+	return true;
 }
 
-template <class Real, unsigned int Dim>
-bool output_ply(const std::string &outFile, const std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>> &mesh, const XForm<Real, Dim + 1> &iXForm)
+// write a .ply file whose vertices have the given float properties, stored consecutively in vertex_data, and whose faces are vertex index lists;
+// the binary format is little endian and is assembled in memory in parallel, then written in one block
+template <class Real>
+bool write_ply(const std::string &outFile, const std::vector<std::string> &vertex_properties, const std::vector<Real> &vertex_data, const std::vector<std::vector<int>> &faces, bool ascii)
 {
-	const std::vector<Point<Real, Dim>> &points = mesh.first;
-	const std::vector<std::vector<int>> &faces = mesh.second;
+	const size_t property_count = vertex_properties.size();
+	const size_t vertex_count = property_count ? vertex_data.size() / property_count : 0;
 
-	std::ofstream plyfile;
-	plyfile.open(outFile, std::ofstream::out);
+	FILE *plyfile = fopen(outFile.c_str(), ascii ? "w" : "wb");
 	if (!plyfile)
 	{
 		printf("Cannot save result file %s\n", outFile.c_str());
@@ -66,109 +559,138 @@ bool output_ply(const std::string &outFile, const std::pair<std::vector<Point<Re
 	}
 	printf("writing to %s\n", outFile.c_str());
 
-	plyfile << "ply\nformat ascii 1.0\n";
-	plyfile << "element vertex " << points.size() << std::endl;
-	plyfile << "property float x" << std::endl
-		<< "property float y" << std::endl
-		<< "property float z" << std::endl;
-	plyfile << "element face " << faces.size() << std::endl;
-	plyfile << "property list uchar int vertex_indices" << std::endl;
-	plyfile << "end_header" << std::endl;
+	std::ostringstream header;
+	header << "ply\nformat " << (ascii ? "ascii" : "binary_little_endian") << " 1.0\n";
+	header << "element vertex " << vertex_count << "\n";
+	for (size_t i = 0; i < property_count; ++i)
+		header << "property float " << vertex_properties[i] << "\n";
+	header << "element face " << faces.size() << "\n";
+	header << "property list uchar int vertex_indices\n";
+	header << "end_header\n";
+	std::string text = header.str();
 
-	for (size_t i = 0; i < points.size(); ++i)
+	if (ascii)
 	{
-		Point<Real, Dim> p = iXForm * points[i];
-		plyfile << p[0] << " " << p[1] << " " << p[2] << std::endl;
+		std::ostringstream body;
+		for (size_t i = 0; i < vertex_count; ++i)
+		{
+			body << vertex_data[i * property_count];
+			for (size_t j = 1; j < property_count; ++j)
+				body << " " << vertex_data[i * property_count + j];
+			body << "\n";
+		}
+		for (size_t i = 0; i < faces.size(); ++i)
+		{
+			body << faces[i].size();
+			for (size_t j = 0; j < faces[i].size(); ++j)
+				body << " " << faces[i][j];
+			body << "\n";
+		}
+		text += body.str();
+		bool ok = fwrite(text.data(), 1, text.size(), plyfile) == text.size();
+		return fclose(plyfile) == 0 && ok;
 	}
 
+	auto put_le32 = [](unsigned char *dst, uint32_t v)
+	{
+		dst[0] = (unsigned char)(v);
+		dst[1] = (unsigned char)(v >> 8);
+		dst[2] = (unsigned char)(v >> 16);
+		dst[3] = (unsigned char)(v >> 24);
+	};
+
+	// every face takes one count byte and 4 bytes per index
+	std::vector<size_t> face_offsets(faces.size() + 1, 0);
 	for (size_t i = 0; i < faces.size(); ++i)
+		face_offsets[i + 1] = face_offsets[i] + 1 + 4 * faces[i].size();
+
+	const size_t vertex_bytes = vertex_count * property_count * 4;
+	std::vector<unsigned char> body(vertex_bytes + face_offsets[faces.size()]);
+#pragma omp parallel for
+	for (long long i = 0; i < (long long)(vertex_count * property_count); ++i)
 	{
-		plyfile << faces[i].size();
-		for (size_t j = 0; j < faces[i].size(); ++j)
-			plyfile << " " << faces[i][j];
-		plyfile << std::endl;
+		float f = (float)vertex_data[i];
+		uint32_t v;
+		memcpy(&v, &f, sizeof(v));
+		put_le32(&body[i * 4], v);
 	}
-	plyfile.close();
-	return true;
+#pragma omp parallel for
+	for (long long i = 0; i < (long long)faces.size(); ++i)
+	{
+		unsigned char *dst = &body[vertex_bytes + face_offsets[i]];
+		*dst++ = (unsigned char)faces[i].size();
+		for (size_t j = 0; j < faces[i].size(); ++j, dst += 4)
+			put_le32(dst, (uint32_t)faces[i][j]);
+	}
+
+	bool ok = fwrite(text.data(), 1, text.size(), plyfile) == text.size();
+	ok = ok && fwrite(body.data(), 1, body.size(), plyfile) == body.size();
+	return fclose(plyfile) == 0 && ok;
 }
 
 template <class Real, unsigned int Dim>
-bool output_sample_points_and_normals(const std::string &outFile, const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &points_normals, const XForm<Real, Dim + 1> &iXForm)
+bool output_ply(const std::string &outFile, const std::pair<std::vector<Point<Real, Dim>>, std::vector<std::vector<int>>> &mesh, const XForm<Real, Dim + 1> &iXForm, bool ascii = false)
 {
-	std::ofstream plyfile;
-	plyfile.open(outFile, std::ofstream::out);
-	if (!plyfile)
+	const std::vector<Point<Real, Dim>> &points = mesh.first;
+	std::vector<Real> vertex_data(points.size() * 3);
+#pragma omp parallel for
+	for (long long i = 0; i < (long long)points.size(); ++i)
 	{
-		printf("Cannot save result file %s\n", outFile.c_str());
-		return false;
+		Point<Real, Dim> p = iXForm * points[i];
+		for (int j = 0; j < 3; ++j)
+			vertex_data[i * 3 + j] = p[j];
 	}
-	printf("writing to %s\n", outFile.c_str());
 
-	plyfile << "ply\nformat ascii 1.0\n";
-	plyfile << "element vertex " << points_normals.size() << std::endl;
-	plyfile << "property float x" << std::endl
-		<< "property float y" << std::endl
-		<< "property float z" << std::endl;
-	plyfile << "property float nx" << std::endl
-		<< "property float ny" << std::endl
-		<< "property float nz" << std::endl;
-	plyfile << "element face 0" << std::endl;
-	plyfile << "property list uchar int vertex_indices" << std::endl;
-	plyfile << "end_header" << std::endl;
+	return write_ply(outFile, {"x", "y", "z"}, vertex_data, mesh.second, ascii);
+}
 
-	for (size_t i = 0; i < points_normals.size(); ++i)
+template <class Real, unsigned int Dim>
+bool output_sample_points_and_normals(const std::string &outFile, const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &points_normals, const XForm<Real, Dim + 1> &iXForm, bool ascii = false)
+{
+	std::vector<Real> vertex_data(points_normals.size() * 6);
+#pragma omp parallel for
+	for (long long i = 0; i < (long long)points_normals.size(); ++i)
 	{
 		auto p = iXForm * points_normals[i].first;
-		plyfile << p[0] << " " << p[1] << " " << p[2] << " ";
-		plyfile << points_normals[i].second.normal[0] << " " << points_normals[i].second.normal[1] << " " << points_normals[i].second.normal[2] << std::endl;
+		for (int j = 0; j < 3; ++j)
+		{
+			vertex_data[i * 6 + j] = p[j];
+			vertex_data[i * 6 + 3 + j] = points_normals[i].second.normal[j];
+		}
 	}
-	plyfile.close();
-	return true;
+
+	return write_ply(outFile, {"x", "y", "z", "nx", "ny", "nz"}, vertex_data, std::vector<std::vector<int>>(), ascii);
 }
 
 template <class Real, unsigned int Dim>
-bool output_all_points_and_normals(const std::string &outFile, const std::string &input_name, const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &points_normals, const kdt::KDTree<kdt::KDTreePoint> &tree, const XForm<Real, Dim + 1> &iXForm)
+bool output_all_points_and_normals(const std::string &outFile, const std::string &input_name, const std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> &points_normals, const kdt::KDTree<kdt::KDTreePoint> &tree, const XForm<Real, Dim + 1> &iXForm, bool ascii = false)
 {
-	std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> points_normals_all;
-	ply_reader<Real, Dim>(input_name, points_normals_all);
+	std::vector<Point<Real, Dim>> points_all;
+	if (!ply_reader<Real, Dim>(input_name, points_all))
+		return false;
+	std::vector<std::pair<Point<Real, Dim>, Normal<Real, Dim>>> points_normals_all(points_all.size());
 	auto inv_iXForm = iXForm.inverse();
 	for (size_t i = 0; i < points_normals_all.size(); ++i)
 	{
+		points_normals_all[i].first = points_all[i];
 		auto c = inv_iXForm * points_normals_all[i].first;
 		std::array<Real, Dim> a{ c[0], c[1], c[2] };
 		int n = tree.nnSearch(kdt::KDTreePoint(a));
 		points_normals_all[i].second = points_normals[n].second;
 	}
 
-	std::ofstream plyfile;
-	plyfile.open(outFile, std::ofstream::out);
-	if (!plyfile)
+	std::vector<Real> vertex_data(points_normals_all.size() * 6);
+#pragma omp parallel for
+	for (long long i = 0; i < (long long)points_normals_all.size(); ++i)
 	{
-		printf("Cannot save result file %s\n", outFile.c_str());
-		return false;
+		for (int j = 0; j < 3; ++j)
+		{
+			vertex_data[i * 6 + j] = points_normals_all[i].first[j];
+			vertex_data[i * 6 + 3 + j] = points_normals_all[i].second.normal[j];
+		}
 	}
-	printf("writing to %s\n", outFile.c_str());
-
-	plyfile << "ply\nformat ascii 1.0\n";
-	plyfile << "element vertex " << points_normals_all.size() << std::endl;
-	plyfile << "property float x" << std::endl
-		<< "property float y" << std::endl
-		<< "property float z" << std::endl;
-	plyfile << "property float nx" << std::endl
-		<< "property float ny" << std::endl
-		<< "property float nz" << std::endl;
-	plyfile << "element face 0" << std::endl;
-	plyfile << "property list uchar int vertex_indices" << std::endl;
-	plyfile << "end_header" << std::endl;
 
-	for (size_t i = 0; i < points_normals_all.size(); ++i)
-	{
-		const auto& p =  points_normals_all[i].first;
-		plyfile << p[0] << " " << p[1] << " " << p[2] << " ";
-		plyfile << points_normals_all[i].second.normal[0] << " " << points_normals_all[i].second.normal[1] << " " << points_normals_all[i].second.normal[2] << std::endl;
-	}
-	plyfile.close();
-	return true;
+	return write_ply(outFile, {"x", "y", "z", "nx", "ny", "nz"}, vertex_data, std::vector<std::vector<int>>(), ascii);
 }
 
 template <class Real, int Dim>
@@ -194,30 +716,6 @@ void normalize(Normal<Real, Dim> &n)
 	}
 }
 
-inline std::vector<std::string> split(const std::string &s, char c = ' ')
-{
-	std::vector<std::string> str;
-	unsigned pos = 0;
-	while (pos < s.size())
-	{
-		while (pos < s.size() && s[pos] == c)
-			++pos;
-
-		unsigned int end = pos;
-
-		do
-		{
-			++end;
-		} while (end < s.size() && s[end] != c);
-
-		if (pos < s.size())
-			str.push_back(s.substr(pos, end - pos));
-		pos = end;
-	}
-
-	return str;
-}
-
 inline bool valid_parameter(long v)
 {
 	return v > 0 && v < INT_MAX;